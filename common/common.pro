@@ -21,14 +21,16 @@ MOC_DIR     = tmp
 UI_DIR      = tmp
 
 QMAKE_LIBDIR += $${OPENRPT_LIBDIR}
-LIBS += -lopenrptcommon -lMetaSQL $${LIBDMTX} -lz
+LIBS += -lopenrptcommon -lMetaSQL $${LIBDMTX} -lz $${PGSQLLIB}
 
 SOURCES = applock.cpp              \
           calendarcontrol.cpp      \
           calendargraphicsitem.cpp \
 	  checkForUpdates.cpp      \
+          documenttransfer.cpp     \
           errorReporter.cpp        \
           exporthelper.cpp \
+          imagecache.cpp \
           importhelper.cpp \
           format.cpp \
           graphicstextbuttonitem.cpp \
@@ -39,18 +41,23 @@ SOURCES = applock.cpp              \
           metricsenc.cpp \
           qbase64encode.cpp \
           qmd5.cpp \
+          scriptcache.cpp \
           shortcuts.cpp \
           storedProcErrorLookup.cpp \
           tarfile.cpp \
           xbase32.cpp \
+          xslttransformer.cpp \
+          xsqlthread.cpp \
           xtupleproductkey.cpp \
           xtsettings.cpp
 HEADERS = applock.h              \
           calendarcontrol.h      \
           calendargraphicsitem.h \
           checkForUpdates.h      \
+          documenttransfer.h     \
           errorReporter.h        \
           exporthelper.h \
+          imagecache.h \
           importhelper.h \
           format.h \
           graphicstextbuttonitem.h \
@@ -61,10 +68,13 @@ HEADERS = applock.h              \
           metricsenc.h \
           qbase64encode.h \
           qmd5.h \
+          scriptcache.h \
           shortcuts.h \
           storedProcErrorLookup.h \
           tarfile.h \
           xbase32.h \
+          xslttransformer.h \
+          xsqlthread.h \
           xtupleproductkey.h \
           xtsettings.h
 
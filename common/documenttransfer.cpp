@@ -0,0 +1,307 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "documenttransfer.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlQuery>
+#include <QVariant>
+
+#define DEBUG false
+
+#define DOCCHUNKSIZE   (1024 * 1024)
+#define DOCCACHESIZE   (512 * 1024 * 1024)  // bytes kept in the local cache
+
+DocumentTransfer::DocumentTransfer(QObject *parent)
+  : XSqlThread(parent),
+    _direction(Download),
+    _fromCache(false),
+    _percent(-1),
+    _urlid(-1)
+{
+}
+
+/* copy url_stream for url_id urlid to filename */
+void DocumentTransfer::setDownload(int urlid, const QString &filename)
+{
+  _direction = Download;
+  _urlid     = urlid;
+  _filename  = filename;
+}
+
+/* replace url_stream for url_id urlid with the contents of filename */
+void DocumentTransfer::setUpload(int urlid, const QString &filename)
+{
+  _direction = Upload;
+  _urlid     = urlid;
+  _filename  = filename;
+}
+
+DocumentTransfer::Direction DocumentTransfer::direction() const
+{
+  return _direction;
+}
+
+QString DocumentTransfer::fileName() const
+{
+  return _filename;
+}
+
+int DocumentTransfer::urlId() const
+{
+  return _urlid;
+}
+
+/* true if the last download was satisfied from the local cache */
+bool DocumentTransfer::fromCache() const
+{
+  return _fromCache;
+}
+
+void DocumentTransfer::run()
+{
+  _fromCache = false;
+  _percent   = -1;
+
+  {
+    QSqlDatabase db = openDatabase();
+    if (db.isOpen())
+    {
+      if (_direction == Download)
+        download(db);
+      else
+        upload(db);
+    }
+  }
+
+  closeDatabase();
+  if (DEBUG)
+    qDebug("DocumentTransfer::run() %d %s done, error: %s", _urlid,
+           qPrintable(_filename), qPrintable(lastError().text()));
+}
+
+/* read the size, hash and every chunk in one snapshot so a concurrent
+   update cannot leave us with a file that mixes old and new contents
+   and gets cached under the old md5.
+ */
+void DocumentTransfer::download(QSqlDatabase &db)
+{
+  QSqlQuery txq(db);
+  if (! txq.exec("BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY;"))
+  {
+    setLastError(txq.lastError());
+    return;
+  }
+
+  QSqlQuery sizeq(db);
+  sizeq.prepare("SELECT OCTET_LENGTH(url_stream) AS size,"
+                "       MD5(url_stream) AS hash"
+                "  FROM url WHERE (url_id=:id);");
+  sizeq.bindValue(":id", _urlid);
+  if (! sizeq.exec())
+  {
+    setLastError(sizeq.lastError());
+    txq.exec("ROLLBACK;");
+    return;
+  }
+  if (! sizeq.first())
+  {
+    setLastError(QSqlError(tr("Could not find document %1.").arg(_urlid),
+                           QString(), QSqlError::UnknownError));
+    txq.exec("ROLLBACK;");
+    return;
+  }
+  qint64  size = sizeq.value("size").toLongLong();
+  QString hash = sizeq.value("hash").toString();
+
+  QString cached = cachePath(hash);
+  if (! cached.isEmpty() && QFileInfo(cached).size() == size)
+  {
+    QFile::remove(_filename);
+    if (QFile::copy(cached, _filename))
+    {
+      txq.exec("COMMIT;");
+      _fromCache = true;
+      reportProgress(size, size);
+      return;
+    }
+  }
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    setLastError(QSqlError(tr("Could not create file %1: %2")
+                             .arg(_filename, file.errorString()),
+                           QString(), QSqlError::UnknownError));
+    txq.exec("ROLLBACK;");
+    return;
+  }
+
+  QSqlQuery chunkq(db);
+  chunkq.prepare("SELECT SUBSTRING(url_stream FROM :offset FOR :length) AS chunk"
+                 "  FROM url WHERE (url_id=:id);");
+  chunkq.bindValue(":id",     _urlid);
+  chunkq.bindValue(":length", DOCCHUNKSIZE);
+  for (qint64 offset = 0; offset < size && ! isCancelled(); offset += DOCCHUNKSIZE)
+  {
+    chunkq.bindValue(":offset", offset + 1);    // SUBSTRING counts from 1
+    if (! chunkq.exec() || ! chunkq.first())
+    {
+      if (! isCancelled())
+        setLastError(chunkq.lastError());
+      break;
+    }
+    QByteArray chunk = chunkq.value("chunk").toByteArray();
+    if (file.write(chunk) != chunk.size())
+    {
+      setLastError(QSqlError(tr("Error writing to %1: %2")
+                               .arg(_filename, file.errorString()),
+                             QString(), QSqlError::UnknownError));
+      break;
+    }
+    reportProgress(offset + chunk.size(), size);
+  }
+  file.close();
+
+  if (isCancelled() || lastError().type() != QSqlError::NoError)
+  {
+    txq.exec("ROLLBACK;");
+    QFile::remove(_filename);
+  }
+  else if (! txq.exec("COMMIT;"))
+  {
+    setLastError(txq.lastError());
+    QFile::remove(_filename);
+  }
+  else
+    saveToCache(_filename, hash);
+}
+
+/* stage the chunks in a temporary table and replace url_stream once at
+   the end; appending to a bytea column chunk by chunk would rewrite the
+   whole value every time.
+ */
+void DocumentTransfer::upload(QSqlDatabase &db)
+{
+  QFile file(_filename);
+  if (! file.open(QIODevice::ReadOnly))
+  {
+    setLastError(QSqlError(tr("Could not open %1: %2")
+                             .arg(_filename, file.errorString()),
+                           QString(), QSqlError::UnknownError));
+    return;
+  }
+
+  QSqlQuery q(db);
+  if (! q.exec("BEGIN;") ||
+      ! q.exec("CREATE TEMPORARY TABLE xtdocchunk"
+               " (xtdocchunk_seq INTEGER, xtdocchunk_data BYTEA)"
+               " ON COMMIT DROP;"))
+  {
+    setLastError(q.lastError());
+    q.exec("ROLLBACK;");
+    return;
+  }
+
+  QCryptographicHash md5(QCryptographicHash::Md5);
+  QSqlQuery chunkq(db);
+  chunkq.prepare("INSERT INTO xtdocchunk (xtdocchunk_seq, xtdocchunk_data)"
+                 " VALUES (:seq, :data);");
+  qint64 size = file.size();
+  int    seq  = 0;
+  while (! file.atEnd() && ! isCancelled())
+  {
+    QByteArray chunk = file.read(DOCCHUNKSIZE);
+    md5.addData(chunk);
+    chunkq.bindValue(":seq",  seq++);
+    chunkq.bindValue(":data", chunk);
+    if (! chunkq.exec())
+    {
+      if (! isCancelled())
+        setLastError(chunkq.lastError());
+      break;
+    }
+    reportProgress(file.pos(), size);
+  }
+  file.close();
+
+  if (! isCancelled() && lastError().type() == QSqlError::NoError)
+  {
+    QSqlQuery updateq(db);
+    updateq.prepare("UPDATE url"
+                    "   SET url_stream=COALESCE((SELECT STRING_AGG(xtdocchunk_data, ''"
+                    "                                   ORDER BY xtdocchunk_seq)"
+                    "                              FROM xtdocchunk), '')"
+                    " WHERE (url_id=:id);");
+    updateq.bindValue(":id", _urlid);
+    if (! updateq.exec())
+      setLastError(updateq.lastError());
+  }
+
+  if (isCancelled() || lastError().type() != QSqlError::NoError)
+    q.exec("ROLLBACK;");
+  else if (! q.exec("COMMIT;"))
+    setLastError(q.lastError());
+  else
+    saveToCache(_filename, md5.result().toHex());
+}
+
+/* the cache lives under the user's cache directory, one file per md5 */
+QString DocumentTransfer::cachePath(const QString &hash) const
+{
+  if (hash.isEmpty())
+    return QString();
+
+  QDir dir(QDesktopServices::storageLocation(QDesktopServices::CacheLocation));
+  if (! dir.mkpath("documents"))
+    return QString();
+  return dir.absoluteFilePath("documents") + QDir::separator() + hash;
+}
+
+/* copy source into the cache, then drop the oldest files until the
+   cache is back under DOCCACHESIZE
+ */
+void DocumentTransfer::saveToCache(const QString &source, const QString &hash) const
+{
+  QString cached = cachePath(hash);
+  if (cached.isEmpty() || QFileInfo(source).size() > DOCCACHESIZE)
+    return;
+
+  QFile::remove(cached + ".tmp");
+  if (! QFile::copy(source, cached + ".tmp"))
+    return;
+  QFile::remove(cached);
+  QFile::rename(cached + ".tmp", cached);
+
+  QDir dir(QFileInfo(cached).absolutePath());
+  QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Time);
+  qint64 total = 0;
+  for (int i = 0; i < files.size(); i++)
+  {
+    total += files.at(i).size();
+    if (total > DOCCACHESIZE)
+      QFile::remove(files.at(i).absoluteFilePath());
+  }
+}
+
+void DocumentTransfer::reportProgress(qint64 done, qint64 total)
+{
+  int percent = total > 0 ? int(done * 100 / total) : 100;
+  if (percent != _percent)
+  {
+    _percent = percent;
+    emit progress(percent);
+  }
+}
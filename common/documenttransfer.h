@@ -0,0 +1,60 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __DOCUMENTTRANSFER_H__
+#define __DOCUMENTTRANSFER_H__
+
+#include <QString>
+
+#include "xsqlthread.h"
+
+/* DocumentTransfer copies url_stream between the database and a local
+   file on a worker thread, DOCCHUNKSIZE bytes at a time, so large
+   attachments neither block the GUI nor have to fit in memory.
+   Downloaded and uploaded contents are kept in a local cache named by
+   md5, so opening an unchanged document again only compares checksums.
+*/
+class DocumentTransfer : public XSqlThread
+{
+  Q_OBJECT
+
+  public:
+    enum Direction { Download, Upload };
+
+    DocumentTransfer(QObject *parent = 0);
+
+    void      setDownload(int urlid, const QString &filename);
+    void      setUpload(int urlid, const QString &filename);
+    Direction direction() const;
+    QString   fileName()  const;
+    int       urlId()     const;
+    bool      fromCache() const;
+
+  signals:
+    void progress(int percent);
+
+  protected:
+    virtual void run();
+
+  private:
+    void    download(QSqlDatabase &db);
+    void    upload(QSqlDatabase &db);
+    QString cachePath(const QString &hash) const;
+    void    saveToCache(const QString &source, const QString &hash) const;
+    void    reportProgress(qint64 done, qint64 total);
+
+    Direction _direction;
+    QString   _filename;
+    bool      _fromCache;
+    int       _percent;
+    int       _urlid;
+};
+
+#endif
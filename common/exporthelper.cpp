@@ -10,22 +10,30 @@
 
 #include "exporthelper.h"
 
+#include <QBuffer>
 #include <QDir>
 #include <QDomDocument>
 #include <QFileInfo>
+#include <QIODevice>
 #include <QMessageBox>
 #include <QProcess>
 #include <QScriptEngine>
 #include <QScriptValue>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QTemporaryFile>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QTextStream>
+#include <QTime>
+#include <QXmlStreamWriter>
 
 #include "metasql.h"
 #include "mqlutil.h"
+#include "xslttransformer.h"
 #include "xsqlquery.h"
+#include "xsqlthread.h"
 
 #define DEBUG false
 
@@ -48,16 +56,17 @@ bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QStrin
       filename = fileinfo.absoluteFilePath();
     }
 
-    QFile *exportfile = new QFile(filename);
-    if (! exportfile->open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
+    QFile exportfile(filename);
+    if (! exportfile.open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
       errmsg = tr("Could not open %1: %2.")
-                                      .arg(filename, exportfile->errorString());
+                                      .arg(filename, exportfile.errorString());
     else
     {
-      if (exportfile->write(generateHTML(qryheadid, params, errmsg).toUtf8()) < 0)
+      writeHTML(&exportfile, qryheadid, params, errmsg);
+      if (exportfile.error() != QFile::NoError)
         errmsg = tr("Error writing to %1: %2")
-                                      .arg(filename, exportfile->errorString());
-      exportfile->close();
+                                      .arg(filename, exportfile.errorString());
+      exportfile.close();
     }
   }
   else if (setq.lastError().type() != QSqlError::NoError)
@@ -66,6 +75,7 @@ bool ExportHelper::exportHTML(const int qryheadid, ParameterList &params, QStrin
     errmsg = tr("<p>Cannot export data because the query set with "
                 "id %1 was not found.").arg(qryheadid);
 
+  returnVal = errmsg.isEmpty();
   if (DEBUG)
     qDebug("ExportHelper::exportHTML returning %d, filename %s, and errmsg %s",
            returnVal, qPrintable(filename), qPrintable(errmsg));
@@ -123,11 +133,26 @@ bool ExportHelper::exportXML(const int qryheadid, ParameterList &params, QString
 
     QFile exportfile(filename);
     if (! exportfile.open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
-      errmsg = tr("Could not open %1 (%2).").arg(filename,exportfile.error());
+      errmsg = tr("Could not open %1 (%2).").arg(filename, exportfile.errorString());
+    else if (xsltmapid < 0)
+    {
+      writeXML(&exportfile, qryheadid, params, errmsg);
+      exportfile.close();
+    }
     else
     {
-      exportfile.write(generateXML(qryheadid, params, errmsg, xsltmapid).toUtf8());
       exportfile.close();
+      QTemporaryFile tmpfile(QDir::tempPath() + QDir::separator() + "xtexportXXXXXX.xml");
+      if (! tmpfile.open())
+        errmsg = tr("Could not open a temporary file: %1.")
+                   .arg(tmpfile.errorString());
+      else
+      {
+        bool written = writeXML(&tmpfile, qryheadid, params, errmsg);
+        tmpfile.close();
+        if (written)
+          XSLTConvertFile(tmpfile.fileName(), filename, xsltmapid, errmsg);
+      }
     }
   }
   else if (setq.lastError().type() != QSqlError::NoError)
@@ -521,11 +546,11 @@ bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename
   return returnVal;
 }
 
-bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename, QString xsltfilename, QString &errmsg)
+/* read for every conversion so a change to the metrics takes effect
+   without restarting
+ */
+static bool xsltMetrics(QString &xsltdir, QString &xsltcmd, QString &errmsg)
 {
-  QString xsltdir;
-  QString xsltcmd;
-
   XSqlQuery q;
   q.prepare("SELECT fetchMetricText(:xsltdir) AS dir,"
             "       fetchMetricText(:xsltcmd) AS cmd;");
@@ -544,58 +569,63 @@ bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename
   {
     xsltdir = q.value("dir").toString();
     xsltcmd = q.value("cmd").toString();
+    return true;
   }
   else if (q.lastError().type() != QSqlError::NoError)
-  {
     errmsg = q.lastError().text();
-    return false;
-  }
   else
-  {
-    errmsg = tr("Could not find the XSLT directory and command metrics.");
-    return false;
-  }
+    errmsg = QObject::tr("Could not find the XSLT directory and command metrics.");
 
-  QStringList args = xsltcmd.split(" ", QString::SkipEmptyParts);
-  QString command = args[0];
-  args.removeFirst();
-  args.replaceInStrings("%f", inputfilename);
+  return false;
+}
 
+static QString xsltPath(const QString &xsltfilename, const QString &xsltdir, QString &errmsg)
+{
   if (QFile::exists(xsltfilename))
-    args.replaceInStrings("%x", xsltfilename);
+    return QFileInfo(xsltfilename).absoluteFilePath();
   else if (QFile::exists(xsltdir + QDir::separator() + xsltfilename))
-    args.replaceInStrings("%x", xsltdir + QDir::separator() + xsltfilename);
-  else
+    return QFileInfo(xsltdir + QDir::separator() + xsltfilename).absoluteFilePath();
+
+  errmsg = QObject::tr("Cannot find the XSLT file as either %1 or %2")
+              .arg(xsltfilename, xsltdir + QDir::separator() + xsltfilename);
+  return QString();
+}
+
+/* run the external XSLT processor configured in the XSLTProcessor* metric
+   for stylesheets that QtXmlPatterns cannot handle
+ */
+static bool externalXSLTConvertFile(QString inputfilename, QString outputfilename, QString xsltpath, QString xsltcmd, QString &errmsg)
+{
+  QStringList args = xsltcmd.split(" ", QString::SkipEmptyParts);
+  if (args.isEmpty())
   {
-    errmsg = tr("Cannot find the XSLT file as either %1 or %2")
-                .arg(xsltfilename, xsltdir + QDir::separator() + xsltfilename);
+    errmsg = QObject::tr("No XSLT Processor has been configured.");
     return false;
   }
+  QString command = args[0];
+  args.removeFirst();
+  args.replaceInStrings("%f", inputfilename);
+  args.replaceInStrings("%x", xsltpath);
 
   QProcess xslt;
   xslt.setStandardOutputFile(outputfilename);
   xslt.start(command, args);
   QString commandline = command + " " + args.join(" ");
   errmsg = "";
-  /* TODO: make the file-processing asynchronous
-     this will keep the UI snappy and handle spurious errors
-     like the occasional waitForFinished failure if the processing
-     runs faster than expected.
-   */
   if (! xslt.waitForStarted())
-    errmsg = tr("Error starting XSLT Processing: %1\n%2")
+    errmsg = QObject::tr("Error starting XSLT Processing: %1\n%2")
                       .arg(commandline)
                       .arg(QString(xslt.readAllStandardError()));
   if (! xslt.waitForFinished())
-    errmsg = tr("The XSLT Processor encountered an error: %1\n%2")
+    errmsg = QObject::tr("The XSLT Processor encountered an error: %1\n%2")
                       .arg(commandline)
                       .arg(QString(xslt.readAllStandardError()));
   if (xslt.exitStatus() !=  QProcess::NormalExit)
-    errmsg = tr("The XSLT Processor did not exit normally: %1\n%2")
+    errmsg = QObject::tr("The XSLT Processor did not exit normally: %1\n%2")
                       .arg(commandline)
                       .arg(QString(xslt.readAllStandardError()));
   if (xslt.exitCode() != 0)
-    errmsg = tr("The XSLT Processor returned an error code: %1\nreturned %2\n%3")
+    errmsg = QObject::tr("The XSLT Processor returned an error code: %1\nreturned %2\n%3")
                       .arg(commandline)
                       .arg(xslt.exitCode())
                       .arg(QString(xslt.readAllStandardError()));
@@ -603,6 +633,114 @@ bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename
   return errmsg.isEmpty();
 }
 
+bool ExportHelper::XSLTConvertFile(QString inputfilename, QString outputfilename, QString xsltfilename, QString &errmsg)
+{
+  QString xsltdir;
+  QString xsltcmd;
+  if (! xsltMetrics(xsltdir, xsltcmd, errmsg))
+    return false;
+
+  QString xsltpath = xsltPath(xsltfilename, xsltdir, errmsg);
+  if (xsltpath.isEmpty())
+    return false;
+
+  XSLTTransformer::Result result = XSLTTransformer::Unsupported;
+  {
+    QFile input(inputfilename);
+    QFile output(outputfilename);
+    if (! input.open(QIODevice::ReadOnly))
+    {
+      errmsg = tr("Could not open %1: %2.").arg(inputfilename, input.errorString());
+      return false;
+    }
+    if (! output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+      errmsg = tr("Could not open %1: %2.").arg(outputfilename, output.errorString());
+      return false;
+    }
+    result = XSLTTransformer::transform(xsltpath, &input, &output, errmsg);
+  }
+
+  if (result == XSLTTransformer::Transformed)
+    return true;
+  else if (result == XSLTTransformer::Failed && xsltcmd.trimmed().isEmpty())
+    return false;       // keep the built-in processor's error
+
+  return externalXSLTConvertFile(inputfilename, outputfilename,
+                                 xsltpath, xsltcmd, errmsg);
+}
+
+/** \brief Transform XML read from one device and write the result to another.
+
+  The stylesheet is compiled once and reused for later calls. If the
+  built-in processor cannot compile or apply it, the input is copied to
+  temporary files and the external XSLT processor is run instead. That
+  needs both devices to be random-access when the built-in processor has
+  already read or written part of them.
+
+  \param input  An open, readable device holding the XML to transform.
+  \param output An open, writable device to receive the result.
+  \param xsltfilename The stylesheet, either a full path or a file in the
+                      XSLTDefaultDir.
+  \param[out] errmsg Why the transformation failed, if it did.
+  */
+bool ExportHelper::XSLTConvert(QIODevice *input, QIODevice *output, QString xsltfilename, QString &errmsg)
+{
+  QString xsltdir;
+  QString xsltcmd;
+  if (! xsltMetrics(xsltdir, xsltcmd, errmsg))
+    return false;
+
+  QString xsltpath = xsltPath(xsltfilename, xsltdir, errmsg);
+  if (xsltpath.isEmpty())
+    return false;
+
+  qint64 inputstart  = input->pos();
+  qint64 outputstart = output->pos();
+  XSLTTransformer::Result result = XSLTTransformer::transform(xsltpath, input,
+                                                             output, errmsg);
+  if (result == XSLTTransformer::Transformed)
+    return true;
+  else if (result == XSLTTransformer::Failed)
+  {
+    // start over with whatever the built-in processor read and wrote
+    if (xsltcmd.trimmed().isEmpty() ||
+        input->isSequential() || output->isSequential() ||
+        ! input->seek(inputstart) || ! output->seek(outputstart))
+      return false;
+    if (QBuffer *buffer = qobject_cast<QBuffer*>(output))
+      buffer->buffer().truncate(outputstart);
+    else if (QFile *file = qobject_cast<QFile*>(output))
+      file->resize(outputstart);
+  }
+
+  QTemporaryFile inputfile(QDir::tempPath() + QDir::separator() + "xsltInput.XXXXXX.xml");
+  QTemporaryFile outputfile(QDir::tempPath() + QDir::separator() + "xsltOutput.XXXXXX.xml");
+  if (! inputfile.open() || ! outputfile.open())
+  {
+    errmsg = tr("Could not open a temporary file.");
+    return false;
+  }
+  while (! input->atEnd())
+    inputfile.write(input->read(65536));
+  inputfile.close();
+  outputfile.close();
+
+  if (! externalXSLTConvertFile(inputfile.fileName(), outputfile.fileName(),
+                                xsltpath, xsltcmd, errmsg))
+    return false;
+
+  if (! outputfile.open())
+  {
+    errmsg = tr("Could not open %1: %2.").arg(outputfile.fileName(), outputfile.errorString());
+    return false;
+  }
+  while (! outputfile.atEnd())
+    output->write(outputfile.read(65536));
+
+  return true;
+}
+
 QString ExportHelper::XSLTConvertString(QString input, int xsltmapid, QString &errmsg)
 {
   if (DEBUG)
@@ -619,68 +757,466 @@ QString ExportHelper::XSLTConvertString(QString input, int xsltmapid, QString &e
   xsltq.exec();
   if (xsltq.first())
   {
-    /* tempfile handling is messy because windows doesn't handle them as you
-       might expect.
-       TODO: find a simpler way
-     */
-    QString xsltmap = xsltq.value("xsltmap_name").toString();
-    QTemporaryFile *inputfile = new QTemporaryFile(QDir::tempPath()
-                                                   + QDir::separator()
-                                                   + xsltmap
-                                                   + "Input.XXXXXX.xml");
-    inputfile->setAutoRemove(false);
-    if (! inputfile->open())
-      errmsg = tr("Could not open temporary input file (%1).")
-                  .arg(inputfile->error());
-    else
+    QByteArray inputbytes = input.toUtf8();
+    QBuffer    inputbuf(&inputbytes);
+    QBuffer    outputbuf;
+    inputbuf.open(QIODevice::ReadOnly);
+    outputbuf.open(QIODevice::WriteOnly);
+
+    if (XSLTConvert(&inputbuf, &outputbuf,
+                    xsltq.value("xsltmap_export").toString(), errmsg))
+      returnVal = QString::fromUtf8(outputbuf.data());
+  }
+  else  if (xsltq.lastError().type() != QSqlError::NoError)
+    errmsg = xsltq.lastError().text();
+  else
+    errmsg = tr("Could not find XSLT mapping with internal id %1.")
+               .arg(xsltmapid);
+
+  if (! errmsg.isEmpty())
+    qWarning("%s", qPrintable(errmsg));
+  return returnVal;
+}
+
+// streaming export ////////////////////////////////////////////////////////////
+
+/* The write*() functions send rows to a QIODevice as they arrive instead
+   of building the whole export in memory. Each query is run through a
+   server-side cursor and fetched EXPORTFETCHSIZE rows at a time. Queries
+   that cannot be declared as a cursor (e.g. several statements) fall back
+   to a plain forward-only query.
+*/
+#define EXPORTFETCHSIZE 1000
+
+static QAtomicInt _exportCursorCounter;
+
+class ExportCursor
+{
+  public:
+    ExportCursor();
+    ~ExportCursor();
+
+    bool       exec(const QString &qtext, ParameterList &params);
+    bool       next();
+    QSqlRecord record()    const;
+    QSqlError  lastError() const;
+
+  private:
+    bool    fetch();
+
+    bool      _declared;
+    QString   _name;
+    QSqlQuery _fetchq;
+    XSqlQuery _plainq;
+};
+
+ExportCursor::ExportCursor()
+  : _declared(false)
+{
+  _name = QString("xtexport%1").arg(_exportCursorCounter.fetchAndAddOrdered(1));
+  _fetchq.setForwardOnly(true);
+}
+
+ExportCursor::~ExportCursor()
+{
+  if (_declared)
+  {
+    QSqlQuery closeq;
+    closeq.exec("CLOSE " + _name + ";");
+  }
+}
+
+bool ExportCursor::exec(const QString &qtext, ParameterList &params)
+{
+  MetaSQLQuery mql(qtext);
+  XSqlQuery query = mql.toQuery(params, QSqlDatabase::database(), false);
+
+  QString sql = XSqlThread::inlineBoundValues(query,
+                                              QSqlDatabase::database().driver());
+  if (! sql.isEmpty())
+  {
+    QSqlQuery declareq;
+    if (declareq.exec("DECLARE " + _name +
+                      " NO SCROLL CURSOR WITH HOLD FOR " + sql + ";"))
     {
-      QString inputfileName = inputfile->fileName();
-      inputfile->write(input.toUtf8());
-      inputfile->close();
-      delete inputfile;
-      inputfile = 0;
-
-      QTemporaryFile *outputfile = new QTemporaryFile(QDir::tempPath()
-                                                      + QDir::separator()
-                                                      + xsltmap
-                                                      + "Output.XXXXXX.xml");
-      outputfile->setAutoRemove(false);
-      if (! outputfile->open())
-        errmsg = tr("Could not open temporary output file (%1).")
-                  .arg(outputfile->error());
-      else
-      {
-        QString outputfileName = outputfile->fileName();
+      _declared = true;
+      return fetch();
+    }
+    else if (DEBUG)
+      qDebug("ExportCursor::exec() could not declare a cursor: %s",
+             qPrintable(declareq.lastError().text()));
+  }
 
-        if (DEBUG)
-          qDebug("ExportHelper::XSLTConvertString writing from %s to %s",
-                 qPrintable(inputfileName), qPrintable(outputfileName));
+  _plainq = query;
+  _plainq.setForwardOnly(true);
+  return _plainq.exec();
+}
+
+bool ExportCursor::fetch()
+{
+  return _fetchq.exec(QString("FETCH FORWARD %1 FROM %2;")
+                      .arg(EXPORTFETCHSIZE).arg(_name));
+}
+
+bool ExportCursor::next()
+{
+  if (! _declared)
+    return _plainq.next();
+
+  if (_fetchq.next())
+    return true;
+  if (_fetchq.size() < EXPORTFETCHSIZE || ! fetch())
+    return false;
+  return _fetchq.next();
+}
+
+QSqlRecord ExportCursor::record() const
+{
+  return _declared ? _fetchq.record() : _plainq.record();
+}
+
+QSqlError ExportCursor::lastError() const
+{
+  return _declared ? _fetchq.lastError() : _plainq.lastError();
+}
+
+/* get the text of the query described by the current qryitem record */
+static QString qryitemText(const XSqlQuery &itemq, QString &schemaName, QString &errmsg)
+{
+  QString qtext;
+  schemaName = QString::null;
+  if (itemq.value("qryitem_src").toString() == "REL")
+  {
+    schemaName = itemq.value("qryitem_group").toString();
+    qtext = "SELECT * FROM " +
+            (schemaName.isEmpty() ? QString("") : schemaName + QString(".")) +
+            itemq.value("qryitem_detail").toString();
+  }
+  else if (itemq.value("qryitem_src").toString() == "MQL")
+  {
+    QString tmpmsg;
+    bool valid;
+    qtext = MQLUtil::mqlLoad(itemq.value("qryitem_group").toString(),
+                             itemq.value("qryitem_detail").toString(),
+                             tmpmsg, &valid);
+    if (! valid)
+      errmsg = tmpmsg;
+  }
+  else if (itemq.value("qryitem_src").toString() == "CUSTOM")
+    qtext = itemq.value("qryitem_detail").toString();
+
+  return qtext;
+}
+
+static bool includeHeaderLine(ParameterList &params)
+{
+  bool valid;
+  QVariant includeheaderVar = params.value("includeHeaderLine", &valid);
+  return (valid ? includeheaderVar.toBool() : false);
+}
 
-        if (XSLTConvertFile(inputfileName, outputfileName,
-                            xsltq.value("xsltmap_export").toString(), errmsg))
-          returnVal = outputfile->readAll();
+static void writeDelimitedRows(QTextStream &out, const QString &qtext,
+                               ParameterList &params, QString &errmsg,
+                               bool &firstLine, ExportStats *stats)
+{
+  bool valid;
+  QString delim = params.value("delim", &valid).toString();
+  if (! valid)
+    delim = ",";
+  bool includeheader = includeHeaderLine(params);
 
-        outputfile->close();
-        delete outputfile;
-        outputfile = 0;
+  ExportCursor qry;
+  if (qry.exec(qtext, params))
+  {
+    int cols = -1;
+    while (qry.next())
+    {
+      QSqlRecord record = qry.record();
+      if (cols < 0)
+      {
+        cols = record.count();
+        if (includeheader)
+        {
+          out << (firstLine ? "" : "\n");
+          for (int p = 0; p < cols; p++)
+            out << (p ? delim : "") << record.fieldName(p);
+          firstLine = false;
+        }
+      }
 
-        if (errmsg.isEmpty())
+      out << (firstLine ? "" : "\n");
+      for (int p = 0; p < cols; p++)
+      {
+        QString tmp = record.value(p).toString();
+        if (tmp.contains(delim))
         {
-          QFile::remove(outputfileName);
-          QFile::remove(inputfileName);
+          tmp.replace("\"", "\"\"");
+          tmp = "\"" + tmp + "\"";
         }
+        out << (p ? delim : "") << tmp;
       }
+      firstLine = false;
+      if (stats)
+        stats->rows++;
     }
   }
-  else  if (xsltq.lastError().type() != QSqlError::NoError)
-    errmsg = xsltq.lastError().text();
-  else
-    errmsg = tr("Could not find XSLT mapping with internal id %1.")
-               .arg(xsltmapid);
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+}
 
-  if (! errmsg.isEmpty())
-    qWarning("%s", qPrintable(errmsg));
-  return returnVal;
+static void writeHTMLRows(QTextStream &out, const QString &qtext,
+                          ParameterList &params, QString &errmsg,
+                          ExportStats *stats)
+{
+  bool includeheader = includeHeaderLine(params);
+
+  ExportCursor qry;
+  if (qry.exec(qtext, params))
+  {
+    int cols = -1;
+    while (qry.next())
+    {
+      QSqlRecord record = qry.record();
+      if (cols < 0)
+      {
+        cols = record.count();
+        out << "<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n";
+        if (includeheader)
+        {
+          out << "<tr>";
+          for (int p = 0; p < cols; p++)
+            out << "<th>" << Qt::escape(record.fieldName(p)) << "</th>";
+          out << "</tr>\n";
+        }
+      }
+
+      out << "<tr>";
+      for (int i = 0; i < cols; i++)
+        out << "<td>" << Qt::escape(record.value(i).toString()) << "</td>";
+      out << "</tr>\n";
+      if (stats)
+        stats->rows++;
+    }
+    if (cols >= 0)
+      out << "</table>\n";
+  }
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+}
+
+static void writeXMLRows(QXmlStreamWriter &out, const QString &qtext,
+                         const QString &tableElemName, const QString &schemaName,
+                         ParameterList &params, QString &errmsg,
+                         ExportStats *stats)
+{
+  ExportCursor qry;
+  if (qry.exec(qtext, params))
+  {
+    while (qry.next())
+    {
+      QSqlRecord record = qry.record();
+      out.writeStartElement(tableElemName);
+      if (! schemaName.isEmpty())
+        out.writeAttribute("schema", schemaName);
+      for (int i = 0; i < record.count(); i++)
+        out.writeTextElement(record.fieldName(i),
+                             record.value(i).isNull() ? QString("[NULL]")
+                                                      : record.value(i).toString());
+      out.writeEndElement();
+      if (stats)
+        stats->rows++;
+    }
+  }
+  if (qry.lastError().type() != QSqlError::NoError)
+    errmsg = qry.lastError().text();
+}
+
+static void startStats(ExportStats *stats, QTime &timer)
+{
+  if (stats)
+  {
+    stats->rows  = 0;
+    stats->msecs = 0;
+  }
+  timer.start();
+}
+
+static void finishStats(ExportStats *stats, QTime &timer)
+{
+  if (stats)
+  {
+    stats->msecs = timer.elapsed();
+    if (DEBUG)
+      qDebug("export wrote %lld rows in %lld msec (%.0f rows/sec)",
+             stats->rows, stats->msecs, stats->rowsPerSecond());
+  }
+}
+
+/** \brief Write the results of a query set to a device as delimited text.
+
+  This produces the same output as generateDelimited() but writes the
+  rows as they are read so memory use does not depend on the size of
+  the result.
+
+  \param device    An open, writable device.
+  \param qryheadid The internal ID of the query set (qryhead record) to run.
+  \param params    Parameters for the MetaSQL statements. delim and
+                   includeHeaderLine are honored as in generateDelimited().
+  \param[out] errmsg A message describing why the processing failed.
+  \param[out] stats  Optional; receives the row count and elapsed time.
+  */
+bool ExportHelper::writeDelimited(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QTextStream out(device);
+  out.setCodec("UTF-8");
+  bool firstLine = true;
+
+  XSqlQuery itemq;
+  itemq.prepare("SELECT *"
+                "  FROM qryitem"
+                " WHERE qryitem_qryhead_id=:id"
+                " ORDER BY qryitem_order;");
+  itemq.bindValue(":id", qryheadid);
+  itemq.exec();
+  while (itemq.next())
+  {
+    QString schemaName;
+    QString qtext = qryitemText(itemq, schemaName, errmsg);
+    if (! qtext.isEmpty())
+      writeDelimitedRows(out, qtext, params, errmsg, firstLine, stats);
+  }
+  if (itemq.lastError().type() != QSqlError::NoError)
+    errmsg = itemq.lastError().text();
+
+  out.flush();
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
+}
+
+bool ExportHelper::writeDelimited(QIODevice *device, QString qtext, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QTextStream out(device);
+  out.setCodec("UTF-8");
+  bool firstLine = true;
+  if (! qtext.isEmpty())
+    writeDelimitedRows(out, qtext, params, errmsg, firstLine, stats);
+
+  out.flush();
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
+}
+
+/** \brief Write the results of a query set to a device as an HTML page
+           with one table per query.
+  */
+bool ExportHelper::writeHTML(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QTextStream out(device);
+  out.setCodec("UTF-8");
+  out << "<html><head><meta http-equiv=\"Content-Type\""
+         " content=\"text/html; charset=utf-8\"/></head><body>\n";
+
+  XSqlQuery itemq;
+  itemq.prepare("SELECT * FROM qryitem WHERE qryitem_qryhead_id=:id ORDER BY qryitem_order;");
+  itemq.bindValue(":id", qryheadid);
+  itemq.exec();
+  while (itemq.next())
+  {
+    QString schemaName;
+    QString qtext = qryitemText(itemq, schemaName, errmsg);
+    if (! qtext.isEmpty())
+      writeHTMLRows(out, qtext, params, errmsg, stats);
+  }
+  if (itemq.lastError().type() != QSqlError::NoError)
+    errmsg = itemq.lastError().text();
+
+  out << "</body></html>\n";
+  out.flush();
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
+}
+
+bool ExportHelper::writeHTML(QIODevice *device, QString qtext, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QTextStream out(device);
+  out.setCodec("UTF-8");
+  out << "<html><head><meta http-equiv=\"Content-Type\""
+         " content=\"text/html; charset=utf-8\"/></head><body>\n";
+  if (! qtext.isEmpty())
+    writeHTMLRows(out, qtext, params, errmsg, stats);
+  out << "</body></html>\n";
+
+  out.flush();
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
+}
+
+/** \brief Write the results of a query set to a device as xtupleimport XML.
+
+  This writes the same structure as generateXML() without an XSLT step.
+  Use exportXML() to apply an export XSLT map.
+  */
+bool ExportHelper::writeXML(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QXmlStreamWriter out(device);
+  out.setAutoFormatting(true);
+  out.setAutoFormattingIndent(1);
+  out.writeStartDocument();
+  out.writeDTD("<!DOCTYPE xtupleimport>");
+  out.writeStartElement("xtupleimport");
+
+  XSqlQuery itemq;
+  itemq.prepare("SELECT * FROM qryitem WHERE qryitem_qryhead_id=:id ORDER BY qryitem_order;");
+  itemq.bindValue(":id", qryheadid);
+  itemq.exec();
+  while (itemq.next())
+  {
+    QString schemaName;
+    QString qtext = qryitemText(itemq, schemaName, errmsg);
+    if (! qtext.isEmpty())
+      writeXMLRows(out, qtext, itemq.value("qryitem_name").toString(),
+                   schemaName, params, errmsg, stats);
+  }
+  if (itemq.lastError().type() != QSqlError::NoError)
+    errmsg = itemq.lastError().text();
+
+  out.writeEndDocument();
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
+}
+
+bool ExportHelper::writeXML(QIODevice *device, QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, ExportStats *stats)
+{
+  QTime timer;
+  startStats(stats, timer);
+
+  QXmlStreamWriter out(device);
+  out.setAutoFormatting(true);
+  out.setAutoFormattingIndent(1);
+  out.writeStartDocument();
+  out.writeDTD("<!DOCTYPE xtupleimport>");
+  out.writeStartElement("xtupleimport");
+  if (! qtext.isEmpty())
+    writeXMLRows(out, qtext, tableElemName, QString(), params, errmsg, stats);
+  out.writeEndDocument();
+
+  finishStats(stats, timer);
+  return errmsg.isEmpty();
 }
 
 // scripting exposure //////////////////////////////////////////////////////////
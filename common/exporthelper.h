@@ -19,8 +19,19 @@
 
 #include <parameter.h>
 
+class QIODevice;
 class QScriptEngine;
 
+class ExportStats
+{
+  public:
+    ExportStats() : rows(0), msecs(0) {}
+    double rowsPerSecond() const { return msecs > 0 ? rows * 1000.0 / msecs : 0; }
+
+    qint64 rows;
+    qint64 msecs;
+};
+
 class ExportHelper : public QObject
 {
   Q_OBJECT
@@ -34,6 +45,13 @@ class ExportHelper : public QObject
     static QString generateHTML(QString qtext, ParameterList &params, QString &errmsg);
     static QString generateXML(const int qryheadid, ParameterList &params, QString &errmsg, int xsltmapid = -1);
     static QString generateXML(QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, int xsltmapid = -1);
+    static bool    writeDelimited(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    writeDelimited(QIODevice *device, QString qtext, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    writeHTML(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    writeHTML(QIODevice *device, QString qtext, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    writeXML(QIODevice *device, const int qryheadid, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    writeXML(QIODevice *device, QString qtext, QString tableElemName, ParameterList &params, QString &errmsg, ExportStats *stats = 0);
+    static bool    XSLTConvert(QIODevice *input, QIODevice *output, QString xsltfilename, QString &errmsg);
     static bool    XSLTConvertFile(QString inputfilename, QString outputfilename, QString xsltfilename, QString &errmsg);
     static bool    XSLTConvertFile(QString inputfilename, QString outputfilename, int xsltmapid, QString &errmsg);
     static QString XSLTConvertString(QString input, int xsltmapid, QString &errmsg);
@@ -0,0 +1,207 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "imagecache.h"
+
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QVariant>
+
+#include <quuencode.h>
+
+#include "xsqlquery.h"
+#include "xtsettings.h"
+
+#define DEBUG false
+
+#define NOTIFYNAME "imagesUpdated"
+#define IMAGECACHESIZE 32768    // kilobytes of decoded images
+
+static ImageCache *_imageCache = 0;
+
+ImageCache *ImageCache::instance()
+{
+  if (! _imageCache)
+    _imageCache = new ImageCache();
+  return _imageCache;
+}
+
+ImageCache::ImageCache()
+  : QObject(0),
+    _listening(false)
+{
+  setObjectName("_imageCache");
+  _images.setMaxCost(IMAGECACHESIZE);
+
+  if (xtsettingsValue("imageDiskCache", false).toBool())
+  {
+    QDir dir(QDesktopServices::storageLocation(QDesktopServices::CacheLocation));
+    if (dir.mkpath("images"))
+      _diskDir = dir.absoluteFilePath("images");
+  }
+}
+
+void ImageCache::listen()
+{
+  if (! _listening && QSqlDatabase::database().isOpen())
+  {
+    QSqlDriver *driver = QSqlDatabase::database().driver();
+    driver->subscribeToNotification(NOTIFYNAME);
+    connect(driver, SIGNAL(notification(const QString&)),
+            this,   SLOT(sNotification(const QString &)));
+    _listening = true;
+  }
+}
+
+/* Return the image with the given image_id or a null image if there is none. */
+QImage ImageCache::image(int id)
+{
+  if (id <= 0)
+    return QImage();
+
+  QImage *cached = _images.object(id);
+  if (cached)
+    return *cached;
+
+  return load(id);
+}
+
+/* Return the first image with the given image_name. */
+QImage ImageCache::image(const QString &name)
+{
+  if (! _ids.contains(name))
+  {
+    XSqlQuery idq;
+    idq.prepare("SELECT image_id FROM image WHERE (image_name=:name) LIMIT 1;");
+    idq.bindValue(":name", name);
+    idq.exec();
+    if (idq.first())
+      _ids.insert(name, idq.value("image_id").toInt());
+    else if (idq.lastError().type() == QSqlError::NoError)
+      _ids.insert(name, -1);
+    else
+    {
+      qWarning("ImageCache::image(%s): %s", qPrintable(name),
+               qPrintable(idq.lastError().text()));
+      return QImage();
+    }
+  }
+
+  return image(_ids.value(name));
+}
+
+QImage ImageCache::load(int id)
+{
+  listen();
+
+  QByteArray data;
+  QString    hash;
+  if (! _diskDir.isEmpty())
+  {
+    XSqlQuery hashq;
+    hashq.prepare("SELECT MD5(image_data) AS hash FROM image WHERE (image_id=:id);");
+    hashq.bindValue(":id", id);
+    hashq.exec();
+    if (! hashq.first())
+    {
+      if (hashq.lastError().type() != QSqlError::NoError)
+        qWarning("ImageCache::load(%d): %s", id, qPrintable(hashq.lastError().text()));
+      return QImage();
+    }
+    hash = hashq.value("hash").toString();
+    data = diskData(hash);
+  }
+
+  if (data.isEmpty())
+  {
+    XSqlQuery dataq;
+    dataq.prepare("SELECT image_data, MD5(image_data) AS hash"
+                  "  FROM image WHERE (image_id=:id);");
+    dataq.bindValue(":id", id);
+    dataq.exec();
+    if (! dataq.first())
+    {
+      if (dataq.lastError().type() != QSqlError::NoError)
+        qWarning("ImageCache::load(%d): %s", id, qPrintable(dataq.lastError().text()));
+      return QImage();
+    }
+    data = QUUDecode(dataq.value("image_data").toString());
+    hash = dataq.value("hash").toString();
+    if (! _diskDir.isEmpty())
+      saveDiskData(hash, data);
+  }
+  else if (DEBUG)
+    qDebug("ImageCache::load(%d) read %s from disk", id, qPrintable(hash));
+
+  QImage image;
+  image.loadFromData(data);
+  insert(id, image);
+  return image;
+}
+
+void ImageCache::insert(int id, const QImage &image)
+{
+  _images.insert(id, new QImage(image), image.byteCount() / 1024 + 1);
+}
+
+QByteArray ImageCache::diskData(const QString &hash) const
+{
+  QFile file(_diskDir + QDir::separator() + hash);
+  if (hash.isEmpty() || ! file.open(QIODevice::ReadOnly))
+    return QByteArray();
+  return file.readAll();
+}
+
+void ImageCache::saveDiskData(const QString &hash, const QByteArray &data) const
+{
+  if (hash.isEmpty() || data.isEmpty())
+    return;
+
+  // write then rename so a concurrent session never reads a partial file
+  QString filename = _diskDir + QDir::separator() + hash;
+  QFile   file(filename + ".tmp");
+  if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+      file.write(data) == data.size())
+  {
+    file.close();
+    if (! QFile::rename(file.fileName(), filename))
+      QFile::remove(file.fileName());
+  }
+  else
+    qWarning("ImageCache could not write %s: %s",
+             qPrintable(file.fileName()), qPrintable(file.errorString()));
+}
+
+/* Tell every client, including this one, that the image table changed.
+   Files in the disk cache are named by content so they need no cleanup.
+ */
+void ImageCache::notifyChanged()
+{
+  instance()->clear();
+
+  XSqlQuery notifyq;
+  notifyq.exec("NOTIFY " NOTIFYNAME ";");
+}
+
+void ImageCache::clear()
+{
+  _images.clear();
+  _ids.clear();
+}
+
+void ImageCache::sNotification(const QString &note)
+{
+  if (note == NOTIFYNAME)
+    clear();
+}
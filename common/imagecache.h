@@ -0,0 +1,61 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __IMAGECACHE_H__
+#define __IMAGECACHE_H__
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QString>
+
+/* ImageCache holds decoded rows of the image table so widgets that show
+   the same picture over and over do not fetch and UU-decode image_data
+   each time. Images are kept in memory up to a size limit, least recently
+   used first out. If the imageDiskCache setting is on, the decoded data
+   are also saved under the user's cache directory, named by the md5 of
+   image_data, so later sessions only fetch the checksum.
+   The memory cache is emptied when the imagesUpdated notification arrives.
+*/
+class ImageCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static ImageCache *instance();
+
+    QImage image(int id);
+    QImage image(const QString &name);
+
+    static void notifyChanged();
+
+  public slots:
+    void clear();
+
+  private slots:
+    void sNotification(const QString &note);
+
+  private:
+    ImageCache();
+
+    void       listen();
+    QByteArray diskData(const QString &hash) const;
+    void       saveDiskData(const QString &hash, const QByteArray &data) const;
+    QImage     load(int id);
+    void       insert(int id, const QImage &image);
+
+    QCache<int, QImage>  _images;
+    QHash<QString, int>  _ids;
+    QString              _diskDir;
+    bool                 _listening;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "importhelper.h"
 
 #include <QApplication>
+#include <QBuffer>
 #include <QDate>
 #include <QDateTime>
 #include <QDirIterator>
@@ -23,6 +24,8 @@
 #include <QSqlError>
 #include <QTemporaryFile>
 #include <QVariant>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
 
 #include <xsqlquery.h>
 
@@ -358,71 +361,445 @@ bool ImportHelper::importCSV(const QString &pFileName, QString &errmsg)
   return errmsg.isEmpty();
 }
 
+/* The streaming XML importer reads one view-level element at a time and
+   gathers consecutive elements that produce the same statement into a
+   batch. A batch shares one prepared statement and, when errors must be
+   isolated, one savepoint. If any row in the batch fails, the savepoint
+   is rolled back and the batch is replayed row by row with a savepoint
+   each, so errors are reported against the element that caused them.
+*/
+#define XMLIMPORTBATCHSIZE     500
+#define XMLIMPORTMAXPREPARED    32
+
+struct XMLImportColumn
+{
+  QString              name;
+  QXmlStreamAttributes attributes;
+  QString              text;
+};
+
+struct XMLImportRow
+{
+  QString                tag;
+  QXmlStreamAttributes   attributes;
+  QList<XMLImportColumn> columns;
+
+  QString      viewName;
+  QString      mode;
+  QStringList  keyList;
+  bool         ignoreErr;
+  bool         silent;
+  QString      sql;     // with :pN placeholders for the quoted values
+  QVariantList values;
+};
+
+class XMLImporter
+{
+  public:
+    XMLImporter(const QString &pFileName, bool pSaveErrorXML,
+                QStringList &pErrors, QStringList &pWarnings);
+
+    bool    readRow(QXmlStreamReader &reader, XMLImportRow &row);
+    void    add(const XMLImportRow &row);
+    void    flush();
+    QString errorXML();
+
+  private:
+    bool build(XMLImportRow &row);
+    void execRow(const XMLImportRow &row, bool haveSavepoint);
+    void handleError(const XMLImportRow &row, const QSqlError &err);
+    void saveRow(const XMLImportRow &row, const QString &comment = QString());
+    XSqlQuery &prepared(const QString &sql);
+
+    QString                  _fileName;
+    bool                     _saveErrorXML;
+    QStringList             &_errors;
+    QStringList             &_warnings;
+    QList<XMLImportRow>      _batch;
+    QHash<QString, XSqlQuery> _prepared;
+    QRegExp                  _apos;
+    QString                  _errorXML;
+    QXmlStreamWriter         _errorWriter;
+    int                      _errorCount;
+};
+
+XMLImporter::XMLImporter(const QString &pFileName, bool pSaveErrorXML,
+                         QStringList &pErrors, QStringList &pWarnings)
+  : _fileName(pFileName),
+    _saveErrorXML(pSaveErrorXML),
+    _errors(pErrors),
+    _warnings(pWarnings),
+    _apos("\\\\*'"),
+    _errorWriter(&_errorXML),
+    _errorCount(0)
+{
+  _errorWriter.setAutoFormatting(true);
+}
+
+/* read the view-level element the reader is positioned on, leaving the
+   reader on its end element
+ */
+bool XMLImporter::readRow(QXmlStreamReader &reader, XMLImportRow &row)
+{
+  row            = XMLImportRow();
+  row.tag        = reader.name().toString();
+  row.attributes = reader.attributes();
+
+  while (reader.readNextStartElement())
+  {
+    XMLImportColumn column;
+    column.name       = reader.name().toString();
+    column.attributes = reader.attributes();
+    column.text       = reader.readElementText(QXmlStreamReader::IncludeChildElements);
+    row.columns.append(column);
+  }
+
+  return ! reader.hasError();
+}
+
+/* the silent attribute provides the user the option to turn off
+   the interactive message for the view-level element
+ */
+void XMLImporter::add(const XMLImportRow &pRow)
+{
+  XMLImportRow row(pRow);
+
+  QString ignore = row.attributes.value("ignore").toString();
+  row.ignoreErr  = row.attributes.hasAttribute("ignore") &&
+                   (ignore.isEmpty() || ignore == "true");
+
+  QString silent = row.attributes.value("silent").toString();
+  row.silent     = row.attributes.hasAttribute("silent") &&
+                   (silent.isEmpty() || silent == "true");
+
+  row.mode = row.attributes.value("mode").toString();
+  if (row.mode.isEmpty())
+    row.mode = "insert";
+
+  if (! row.attributes.value("key").isEmpty())
+    row.keyList = row.attributes.value("key").toString().split(QRegExp(",\\s*"));
+
+  row.viewName = row.tag;
+  if (row.viewName.indexOf(".") > 0)
+    ; // viewName contains . so accept that it's schema-qualified
+  else if (! row.attributes.value("schema").isEmpty())
+    row.viewName = row.attributes.value("schema").toString() + "." + row.viewName;
+  else // backwards compatibility - must be in the api schema
+    row.viewName = "api." + row.viewName;
+
+  if (! build(row))
+    return;
+
+  if (! _batch.isEmpty() &&
+      (_batch.last().sql       != row.sql       ||
+       _batch.last().ignoreErr != row.ignoreErr ||
+       _batch.last().silent    != row.silent    ||
+       _batch.size() >= XMLIMPORTBATCHSIZE))
+    flush();
+
+  _batch.append(row);
+}
+
+/* turn the columns into a statement. quoted values are bound, everything
+   else ([NULL], subselects, quote="false") is inlined as before.
+ */
+bool XMLImporter::build(XMLImportRow &row)
+{
+  QStringList columnNameList;
+  QStringList columnValueList;
+  QList<int>  columnParamList;  // index into row.values or -1 if inlined
+
+  row.values.clear();
+  for (int i = 0; i < row.columns.size(); i++)
+  {
+    const XMLImportColumn &column = row.columns.at(i);
+    QString value = column.attributes.value("value").isEmpty() ?
+                            column.text : column.attributes.value("value").toString();
+    if (DEBUG)
+      qDebug("%s before transformation: /%s/",
+             qPrintable(column.name), qPrintable(value));
+
+    columnNameList.append(column.name);
+
+    columnParamList.append(-1);
+    if (value.trimmed() == "[NULL]")
+      columnValueList.append("NULL");
+    else if (value.trimmed().startsWith("SELECT"))
+      columnValueList.append("(" + value.trimmed() + ")");
+    else if (column.attributes.value("quote") == "false")
+      columnValueList.append(value);
+    else
+    {
+      columnParamList.last() = row.values.size();
+      columnValueList.append(QString(":p%1").arg(row.values.size()));
+      row.values.append(value.replace(_apos, "'"));
+    }
+  }
+
+  if (row.mode == "update" && row.keyList.isEmpty())
+  {
+    if (columnNameList.contains(row.viewName + "_number"))
+      row.keyList.append(row.viewName + "_number");
+    else if (columnNameList.contains("order_number"))
+      row.keyList.append("order_number");
+    else
+    {
+      flush();
+      if (row.ignoreErr || _saveErrorXML)
+      {
+        _warnings.append(ImportHelper::tr("Cannot process %1 element without a key attribute")
+                         .arg(row.tag));
+        if (_saveErrorXML)
+          saveRow(row);
+      }
+      else
+        _errors.append(ImportHelper::tr("Cannot process %1 element without a key attribute")
+                       .arg(row.tag));
+      return false;
+    }
+    if (columnNameList.contains("line_number"))
+      row.keyList.append("line_number");
+  }
+
+  if (row.mode == "update")
+  {
+    QStringList whereList;
+    for (int i = 0; i < row.keyList.size(); i++)
+    {
+      int col = columnNameList.indexOf(row.keyList.at(i));
+      if (col < 0)
+      {
+        flush();
+        if (! row.ignoreErr)
+          _errors.append(ImportHelper::tr("Could not process %1: key %2 is not one of its columns")
+                         .arg(row.tag, row.keyList.at(i)));
+        return false;
+      }
+      QString value = columnValueList.at(col);
+      if (columnParamList.at(col) >= 0)   // bind the key separately
+      {
+        value = QString(":p%1").arg(row.values.size());
+        row.values.append(row.values.at(columnParamList.at(col)));
+      }
+      whereList.append("(" + row.keyList.at(i) + "=" + value + ")");
+    }
+
+    for (int i = 0; i < columnNameList.size(); i++)
+      columnNameList[i].append("=" + columnValueList[i]);
+
+    row.sql = "UPDATE " + row.viewName + " SET " +
+              columnNameList.join(", ") +
+              " WHERE (" + whereList.join(" AND ") + ");";
+  }
+  else if (row.mode == "insert")
+    row.sql = "INSERT INTO " + row.viewName + " (" +
+              columnNameList.join(", ") +
+              " ) VALUES (" +
+              columnValueList.join(", ") + ");" ;
+  else
+  {
+    flush();
+    if (! row.ignoreErr)
+      _errors.append(ImportHelper::tr("Could not process %1: invalid mode %2")
+                     .arg(row.tag, row.mode));
+    return false;
+  }
+
+  if (DEBUG) qDebug("Built this: %s", qPrintable(row.sql));
+  return true;
+}
+
+XSqlQuery &XMLImporter::prepared(const QString &sql)
+{
+  if (! _prepared.contains(sql))
+  {
+    if (_prepared.size() >= XMLIMPORTMAXPREPARED)
+      _prepared.clear();
+    XSqlQuery q;
+    q.prepare(sql);
+    _prepared.insert(sql, q);
+  }
+  return _prepared[sql];
+}
+
+void XMLImporter::flush()
+{
+  if (_batch.isEmpty())
+    return;
+
+  const XMLImportRow &first = _batch.first();
+  bool haveSavepoint = (first.ignoreErr || _saveErrorXML);
+
+  if (! haveSavepoint)
+  {
+    for (int i = 0; i < _batch.size(); i++)
+      execRow(_batch.at(i), false);
+    _batch.clear();
+    return;
+  }
+
+  XSqlQuery savepoint;
+  savepoint.exec("SAVEPOINT xmlimportbatch;");
+
+  XSqlQuery &q = prepared(first.sql);
+  bool failed = false;
+  for (int i = 0; ! failed && i < _batch.size(); i++)
+  {
+    for (int v = 0; v < _batch.at(i).values.size(); v++)
+      q.bindValue(QString(":p%1").arg(v), _batch.at(i).values.at(v));
+    q.exec();
+    failed = (q.lastError().type() != QSqlError::NoError);
+  }
+
+  if (! failed)
+    savepoint.exec("RELEASE SAVEPOINT xmlimportbatch;");
+  else
+  {
+    if (DEBUG)
+      qDebug("XMLImporter::flush() replaying %d rows of %s one at a time",
+             _batch.size(), qPrintable(first.viewName));
+    savepoint.exec("ROLLBACK TO SAVEPOINT xmlimportbatch;");
+    savepoint.exec("RELEASE SAVEPOINT xmlimportbatch;");
+    for (int i = 0; i < _batch.size(); i++)
+      execRow(_batch.at(i), true);
+  }
+
+  _batch.clear();
+}
+
+void XMLImporter::execRow(const XMLImportRow &row, bool haveSavepoint)
+{
+  XSqlQuery savepoint;
+  if (haveSavepoint)
+    savepoint.exec("SAVEPOINT xmlimportrow;");
+
+  XSqlQuery &q = prepared(row.sql);
+  for (int v = 0; v < row.values.size(); v++)
+    q.bindValue(QString(":p%1").arg(v), row.values.at(v));
+  q.exec();
+  if (q.lastError().type() != QSqlError::NoError)
+  {
+    QSqlError err = q.lastError();
+    if (haveSavepoint)
+      savepoint.exec("ROLLBACK TO SAVEPOINT xmlimportrow;");
+    handleError(row, err);
+  }
+  else if (haveSavepoint)
+    savepoint.exec("RELEASE SAVEPOINT xmlimportrow;");
+}
+
+void XMLImporter::handleError(const XMLImportRow &row, const QSqlError &err)
+{
+  if (row.ignoreErr)
+  {
+    if (! row.silent)
+      _warnings.append(ImportHelper::tr("Ignored error while importing %1:\n%2")
+                          .arg(row.tag, err.text()));
+  }
+  else if (_saveErrorXML)
+  {
+    _warnings.append(ImportHelper::tr("Error processing %1. Saving to retry later:\t%2")
+                          .arg(row.tag, err.text()));
+    saveRow(row, err.text());
+  }
+  else
+    _errors.append(ImportHelper::tr("Error importing %1: %2")
+                  .arg(_fileName, err.databaseText()));
+}
+
+void XMLImporter::saveRow(const XMLImportRow &row, const QString &comment)
+{
+  if (_errorCount++ == 0)
+    _errorWriter.writeStartElement("xtupleimport");
+
+  _errorWriter.writeStartElement(row.tag);
+  _errorWriter.writeAttributes(row.attributes);
+  for (int i = 0; i < row.columns.size(); i++)
+  {
+    _errorWriter.writeStartElement(row.columns.at(i).name);
+    _errorWriter.writeAttributes(row.columns.at(i).attributes);
+    _errorWriter.writeCharacters(row.columns.at(i).text);
+    _errorWriter.writeEndElement();
+  }
+  if (! comment.isEmpty())
+    _errorWriter.writeComment(comment);
+  _errorWriter.writeEndElement();
+}
+
+QString XMLImporter::errorXML()
+{
+  if (_errorCount == 0)
+    return QString();
+
+  _errorWriter.writeEndDocument();
+  return _errorXML;
+}
+
 bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString &warnmsg)
 {
   if (DEBUG)
     qDebug("ImportHelper::importXML(%s, errmsg)", qPrintable(pFileName));
 
-  QString xmldir;
-  QString xsltdir;
-  QString xsltcmd;
   QStringList errors;
   QStringList warnings;
-  bool        saveErrorXML = false;
 
   XSqlQuery q;
-  q.prepare("SELECT fetchMetricText(:xmldir)  AS xmldir,"
-            "       fetchMetricText(:xsltdir) AS xsltdir,"
-            "       fetchMetricText(:xsltcmd) AS xsltcmd,"
-            "       fetchMetricBool('ImportXMLCreateErrorFile') AS createerr;");
-#if defined Q_WS_MACX
-  q.bindValue(":xmldir",  "XMLDefaultDirMac");
-  q.bindValue(":xsltdir", "XSLTDefaultDirMac");
-  q.bindValue(":xsltcmd", "XSLTProcessorMac");
-#elif defined Q_WS_WIN
-  q.bindValue(":xmldir",  "XMLDefaultDirWindows");
-  q.bindValue(":xsltdir", "XSLTDefaultDirWindows");
-  q.bindValue(":xsltcmd", "XSLTProcessorWindows");
-#elif defined Q_WS_X11
-  q.bindValue(":xmldir",  "XMLDefaultDirLinux");
-  q.bindValue(":xsltdir", "XSLTDefaultDirLinux");
-  q.bindValue(":xsltcmd", "XSLTProcessorLinux");
-#endif
-  q.exec();
+  bool saveErrorXML = false;
+  q.exec("SELECT fetchMetricBool('ImportXMLCreateErrorFile') AS createerr;");
   if (q.first())
-  {
-    xmldir  = q.value("xmldir").toString();
-    xsltdir = q.value("xsltdir").toString();
-    xsltcmd = q.value("xsltcmd").toString();
     saveErrorXML = q.value("createerr").toBool();
-  }
   else if (q.lastError().type() != QSqlError::NoError)
   {
     errmsg = q.lastError().text();
     return false;
   }
-  else
-  {
-    errmsg = tr("Could not find the XSLT directory and command metrics.");
-    return false;
-  }
 
-  if (xmldir.isEmpty())
-    xmldir = ".";
+  QString doctype;
+  QString systemId;
+  {
+    QFile file(pFileName);
+    if (! file.open(QIODevice::ReadOnly))
+    {
+      errmsg = tr("<p>Could not open file %1 (error %2)")
+                        .arg(pFileName, file.error());
+      return false;
+    }
 
-  QDomDocument doc(pFileName);
-  if (!openDomDocument(pFileName, doc, errmsg))
-    return false;
+    QXmlStreamReader reader(&file);
+    while (! reader.atEnd() && ! reader.isStartElement())
+    {
+      reader.readNext();
+      if (reader.isDTD())
+      {
+        doctype  = reader.dtdName().toString();
+        systemId = reader.dtdSystemId().toString();
+      }
+    }
+    if (reader.hasError())
+    {
+      errmsg = tr("Problem reading %1, line %2 column %3:<br>%4")
+                        .arg(pFileName).arg(reader.lineNumber())
+                        .arg(reader.columnNumber()).arg(reader.errorString());
+      return false;
+    }
+    if (DEBUG) qDebug("initial doctype = %s", qPrintable(doctype));
+    if (doctype.isEmpty())
+    {
+      doctype = reader.name().toString();
+      if (DEBUG) qDebug("changed doctype to %s", qPrintable(doctype));
+    }
+  }
 
-  QString doctype = doc.doctype().name();
-  if (DEBUG) qDebug("initial doctype = %s", qPrintable(doctype));
-  if (doctype.isEmpty())
+  QFile   file(pFileName);
+  QBuffer converted;
+  QIODevice *importDevice = &file;
+  if (! file.open(QIODevice::ReadOnly))
   {
-    doctype = doc.documentElement().tagName();
-    if (DEBUG) qDebug("changed doctype to %s", qPrintable(doctype));
+    errmsg = tr("<p>Could not open file %1 (error %2)")
+                      .arg(pFileName, file.error());
+    return false;
   }
 
-  QString tmpfileName;
   if (doctype != "xtupleimport")
   {
     QString xsltfile;
@@ -431,7 +808,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
               "WHERE ((xsltmap_doctype=:doctype OR xsltmap_doctype='')"
               "   AND (xsltmap_system=:system   OR xsltmap_system=''));");
     q.bindValue(":doctype", doctype);
-    q.bindValue(":system",  doc.doctype().systemId());
+    q.bindValue(":system",  systemId);
     q.exec();
     if (q.first())
       xsltfile = q.value("xsltmap_import").toString();
@@ -445,19 +822,17 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
       errmsg = tr("<p>Could not find a map for doctype '%1' and system id '%2'"
                   ". Write an XSLT stylesheet to convert this to valid xtuple "
                   "import XML and add it to the Map of XSLT Import Filters.")
-                    .arg(doctype, doc.doctype().systemId());
+                    .arg(doctype, systemId);
       return false;
     }
 
-    tmpfileName = xmldir + QDir::separator() + doctype + "TOxtupleimport";
-
-    if (! ExportHelper::XSLTConvertFile(pFileName, tmpfileName,
-                                        q.value("xsltmap_import").toString(),
-                                        errmsg))
-      return false;
-
-    if (! openDomDocument(tmpfileName, doc, errmsg))
+    converted.open(QIODevice::WriteOnly);
+    if (! ExportHelper::XSLTConvert(&file, &converted, xsltfile, errmsg))
       return false;
+    file.close();
+    converted.close();
+    converted.open(QIODevice::ReadOnly);
+    importDevice = &converted;
   }
 
   /* xtupleimport format is very straightforward:
@@ -470,13 +845,13 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
      we can reimport files which have failures. however, if a
      view-level element has the ignore attribute set to true then
      rollback just that view-level element if it generates an error.
-  */
 
-  // the silent attribute provides the user the option to turn off 
-  // the interactive message for the view-level element
+     the file is read as a stream so memory use does not grow with it.
+     files converted by an XSLT import map are read from the in-memory
+     result of the conversion.
+  */
 
-  QDomDocument errorDoc;
-  QDomElement errorRoot = errorDoc.appendChild(errorDoc.createElement("xtupleimport")).toElement();
+  QXmlStreamReader reader(importDevice);
 
   q.exec("BEGIN;");
   if (q.lastError().type() != QSqlError::NoError)
@@ -488,156 +863,28 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
   XSqlQuery rollback;
   rollback.prepare("ROLLBACK;");
 
-  QRegExp apos("\\\\*'");
-
-  for (QDomElement viewElem = doc.documentElement().firstChildElement();
-       ! viewElem.isNull();
-       viewElem = viewElem.nextSiblingElement())
+  XMLImporter importer(pFileName, saveErrorXML, errors, warnings);
+  if (reader.readNextStartElement())
   {
-    QStringList columnNameList;
-    QStringList columnValueList;
-
-    bool ignoreErr = (viewElem.attribute("ignore", "false").isEmpty() ||
-                      viewElem.attribute("ignore", "false") == "true");
-
-    bool silent = (viewElem.attribute("silent", "false").isEmpty() ||
-                   viewElem.attribute("silent", "false") == "true");
-
-    QString mode = viewElem.attribute("mode", "insert");
-    QStringList keyList;
-    if (! viewElem.attribute("key").isEmpty())
-      keyList = viewElem.attribute("key").split(QRegExp(",\\s*"));
-
-    QString viewName = viewElem.tagName();
-    if (viewName.indexOf(".") > 0)
-      ; // viewName contains . so accept that it's schema-qualified
-    else if (! viewElem.attribute("schema").isEmpty())
-      viewName = viewElem.attribute("schema") + "." + viewName;
-    else // backwards compatibility - must be in the api schema
-      viewName = "api." + viewName;
-
-    QString savepointName = viewName;
-    savepointName.remove(".");
-    XSqlQuery rollbacktosavepoint;
-    if (ignoreErr || saveErrorXML)
-    {
-      q.exec("SAVEPOINT " + savepointName + ";");
-      rollbacktosavepoint.prepare("ROLLBACK TO SAVEPOINT " + savepointName + ";");
-    }
-    bool haveSavepoint = (ignoreErr || saveErrorXML);
-
-    if (mode.isEmpty())
-      mode = "insert";
-    else if (mode == "update" && keyList.isEmpty())
-    {
-      if (! viewElem.namedItem(viewName + "_number").isNull())
-        keyList.append(viewName + "_number");
-      else if (! viewElem.namedItem("order_number").isNull())
-        keyList.append("order_number");
-      else
-      {
-        if (haveSavepoint)
-          rollbacktosavepoint.exec();
-        if (ignoreErr || saveErrorXML)
-        {
-          warnings.append(tr("Cannot process %1 element without a key attribute"));
-          if (saveErrorXML)
-            errorRoot.appendChild(errorDoc.importNode(viewElem, true));
-        }
-        else
-          errors.append(tr("Cannot process %1 element without a key attribute"));
-        continue;       // back to top of viewElem for loop
-      }
-      if (! viewElem.namedItem("line_number").isNull())
-        keyList.append("line_number");
-    }
-
-    for (QDomElement columnElem = viewElem.firstChildElement();
-         ! columnElem.isNull();
-         columnElem = columnElem.nextSiblingElement())
+    XMLImportRow row;
+    while (reader.readNextStartElement())
     {
-      QString value = columnElem.attribute("value").isEmpty() ?
-                              columnElem.text() : columnElem.attribute("value");
-      if (DEBUG)
-        qDebug("%s before transformation: /%s/",
-               qPrintable(columnElem.tagName()), qPrintable(value));
-
-      columnNameList.append(columnElem.tagName());
-
-      if (value.trimmed() == "[NULL]")
-        columnValueList.append("NULL");
-      else if (value.trimmed().startsWith("SELECT"))
-        columnValueList.append("(" + value.trimmed() + ")");
-      else if (columnElem.attribute("quote") == "false")
-        columnValueList.append(value);
-      else
-        columnValueList.append("'" + value.replace(apos, "''") + "'");
-
-      if (DEBUG)
-        qDebug("%s after transformation: /%s/",
-               qPrintable(columnElem.tagName()), qPrintable(value));
-    }
-
-    QString sql;
-    if (mode == "update")
-    {
-      QStringList whereList;
-      for (int i = 0; i < keyList.size(); i++)
-        whereList.append("(" + keyList[i] + "=" +
-                         columnValueList[columnNameList.indexOf(keyList[i])] + ")");
-
-      for (int i = 0; i < columnNameList.size(); i++)
-        columnNameList[i].append("=" + columnValueList[i]);
-
-      sql = "UPDATE " + viewName + " SET " +
-            columnNameList.join(", ") +
-            " WHERE (" + whereList.join(" AND ") + ");";
-    }
-    else if (mode == "insert")
-      sql = "INSERT INTO " + viewName + " (" +
-            columnNameList.join(", ") +
-            " ) SELECT " +
-            columnValueList.join(", ") + ";" ;
-    else
-    {
-      if (haveSavepoint)
-        rollbacktosavepoint.exec();
-      if (! ignoreErr)
-        errors.append(tr("Could not process %1: invalid mode %2")
-                      .arg(viewElem.tagName(), mode));
-      continue;       // back to top of viewElem for loop
+      if (! importer.readRow(reader, row))
+        break;
+      importer.add(row);
     }
+  }
+  importer.flush();
 
-    if (DEBUG) qDebug("About to run this: %s", qPrintable(sql));
-    q.exec(sql);
-    if (q.lastError().type() != QSqlError::NoError)
-    {
-      if (haveSavepoint)
-        rollbacktosavepoint.exec();
-      if (ignoreErr)
-      {
-        if (! silent)
-          warnings.append(tr("Ignored error while importing %1:\n%2")
-                              .arg(viewElem.tagName(), q.lastError().text()));
-      }
-      else if (saveErrorXML)
-      {
-        warnings.append(tr("Error processing %1. Saving to retry later:\t%2")
-                              .arg(viewElem.tagName(), q.lastError().text()));
-        QDomNode nodecopy = errorDoc.importNode(viewElem, true);
-        nodecopy.appendChild(errorDoc.createComment(q.lastError().text()));
-        errorRoot.appendChild(nodecopy);
-      }
-      else
-      {
-        errors.append(tr("Error importing %1: %2")
-                      .arg(pFileName, q.lastError().databaseText()));
-        continue;       // back to top of viewElem for loop
-      }
-    }
-    else if (haveSavepoint)
-      q.exec("RELEASE SAVEPOINT " + savepointName + ";");
+  if (reader.hasError())
+  {
+    rollback.exec();
+    errmsg = tr("Problem reading %1, line %2 column %3:<br>%4")
+                      .arg(pFileName).arg(reader.lineNumber())
+                      .arg(reader.columnNumber()).arg(reader.errorString());
+    return false;
   }
+  importDevice->close();
 
   q.exec("COMMIT;");
   if (q.lastError().type() != QSqlError::NoError)
@@ -647,9 +894,6 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
     return false;
   }
 
-  if (! tmpfileName.isEmpty())
-    QFile::remove(tmpfileName);
-
   if (warnings.size() > 0)
     warnmsg = warnings.join("\n");
 
@@ -657,8 +901,7 @@ bool ImportHelper::importXML(const QString &pFileName, QString &errmsg, QString
   if (! handleFilePostImport(pFileName,
                              errors.size() == 0,
                              fileerrmsg,
-                             errorRoot.hasChildNodes() ? errorDoc.toString()
-                                                       : QString()))
+                             importer.errorXML()))
   {
     errors.append(fileerrmsg);
     return false;
@@ -0,0 +1,147 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "scriptcache.h"
+
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QVariant>
+
+#include "xsqlquery.h"
+
+#define NOTIFYNAME       "scriptsUpdated"
+#define SCRIPTCACHECHECK 30000
+
+static ScriptCache *_scriptCache = 0;
+
+ScriptCache *ScriptCache::instance()
+{
+  if (! _scriptCache)
+    _scriptCache = new ScriptCache();
+  return _scriptCache;
+}
+
+ScriptCache::ScriptCache()
+  : QObject(0),
+    _listening(false)
+{
+  setObjectName("_scriptCache");
+}
+
+/* Load every requested name that is not already cached with a single query.
+   Until the LISTEN is in place nothing would tell us the cache is stale, so
+   we subscribe before the first load.
+*/
+void ScriptCache::prefetch(const QStringList &names)
+{
+  if (! _listening && QSqlDatabase::database().isOpen())
+  {
+    QSqlDriver *driver = QSqlDatabase::database().driver();
+    driver->subscribeToNotification(NOTIFYNAME);
+    connect(driver, SIGNAL(notification(const QString&)),
+            this,   SLOT(sNotification(const QString &)));
+    _listening = true;
+  }
+
+  checkFresh();
+
+  QStringList missing;
+  for (int i = 0; i < names.size(); i++)
+    if (! _scripts.contains(names.at(i)) && ! missing.contains(names.at(i)))
+      missing.append(names.at(i));
+
+  if (missing.isEmpty())
+    return;
+
+  // build a text[] literal instead of one bind per name
+  QStringList quoted;
+  for (int i = 0; i < missing.size(); i++)
+  {
+    QString name = missing.at(i);
+    name.replace("\\", "\\\\").replace("\"", "\\\"");
+    quoted.append("\"" + name + "\"");
+  }
+
+  XSqlQuery scriptq;
+  scriptq.prepare("SELECT script_id, script_name, script_order, script_source"
+                  "  FROM script"
+                  " WHERE((script_name=ANY(CAST(:names AS TEXT[])))"
+                  "   AND (script_enabled))"
+                  " ORDER BY script_name, script_order;");
+  scriptq.bindValue(":names", "{" + quoted.join(",") + "}");
+  if (! scriptq.exec())
+    return;     // leave the names uncached so the next caller retries
+
+  for (int i = 0; i < missing.size(); i++)
+    _scripts.insert(missing.at(i), QList<Script>());
+
+  while (scriptq.next())
+  {
+    Script script;
+    script.id     = scriptq.value("script_id").toInt();
+    script.order  = scriptq.value("script_order").toInt();
+    script.source = scriptq.value("script_source").toString();
+    _scripts[scriptq.value("script_name").toString()].append(script);
+  }
+}
+
+/* Return the enabled scripts with the given name in script_order. */
+QList<ScriptCache::Script> ScriptCache::scripts(const QString &name)
+{
+  if (! _scripts.contains(name))
+    prefetch(QStringList(name));
+
+  return _scripts.value(name);
+}
+
+/* Tell every client, including this one, that the script table changed. */
+void ScriptCache::notifyChanged()
+{
+  instance()->clear();
+
+  XSqlQuery notifyq;
+  notifyq.exec("NOTIFY " NOTIFYNAME ";");
+}
+
+void ScriptCache::clear()
+{
+  _scripts.clear();
+}
+
+/* Any insert, update or delete on the script table changes either the row
+   count or the newest xmin, so comparing the two with what we saw last time
+   catches changes nobody sent a notification for.
+*/
+void ScriptCache::checkFresh()
+{
+  if (_checked.isValid() && _checked.elapsed() < SCRIPTCACHECHECK)
+    return;
+
+  XSqlQuery stampq;
+  stampq.exec("SELECT COUNT(*) || ':' ||"
+              "       COALESCE(MAX(CAST(CAST(xmin AS TEXT) AS BIGINT)), 0) AS stamp"
+              "  FROM script;");
+  if (! stampq.first())
+    return;     // try again next time rather than trust a stale cache
+
+  _checked.start();
+  QString stamp = stampq.value("stamp").toString();
+  if (stamp != _stamp)
+  {
+    clear();
+    _stamp = stamp;
+  }
+}
+
+void ScriptCache::sNotification(const QString &note)
+{
+  if (note == NOTIFYNAME)
+    clear();
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __SCRIPTCACHE_H__
+#define __SCRIPTCACHE_H__
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+
+/* ScriptCache holds the enabled rows of the script table keyed by
+   script_name so opening a window, or include()ing a library script, does
+   not cost a round trip per name. Names with no scripts are cached too.
+   The cache is emptied when the scriptsUpdated notification arrives.
+   Only the script editor sends that, so scripts changed by packages, the
+   updater or plain SQL are caught by a cheap row count and max(xmin)
+   check of the script table, run at most every SCRIPTCACHECHECK msec.
+*/
+class ScriptCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    struct Script
+    {
+      int     id;
+      int     order;
+      QString source;
+    };
+
+    static ScriptCache *instance();
+
+    void          prefetch(const QStringList &names);
+    QList<Script> scripts(const QString &name);
+
+    static void   notifyChanged();
+
+  public slots:
+    void clear();
+
+  private slots:
+    void sNotification(const QString &note);
+
+  private:
+    ScriptCache();
+    void checkFresh();
+
+    QHash<QString, QList<Script> > _scripts;
+    bool                           _listening;
+    QTime                          _checked;
+    QString                        _stamp;
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xslttransformer.h"
+
+#include <QAbstractMessageHandler>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QHash>
+#include <QIODevice>
+#include <QThread>
+#include <QThreadPool>
+#include <QUrl>
+#include <QXmlQuery>
+
+#define DEBUG false
+
+class XSLTMessageHandler : public QAbstractMessageHandler
+{
+  public:
+    QString lastError;
+
+  protected:
+    virtual void handleMessage(QtMsgType type, const QString &description,
+                               const QUrl &identifier,
+                               const QSourceLocation &sourceLocation)
+    {
+      Q_UNUSED(identifier);
+      if (type == QtWarningMsg)
+        return;
+      lastError = QObject::tr("%1 line %2 column %3: %4")
+                    .arg(sourceLocation.uri().toLocalFile())
+                    .arg(sourceLocation.line())
+                    .arg(sourceLocation.column())
+                    .arg(description);
+    }
+};
+
+struct XSLTStylesheet
+{
+  XSLTStylesheet() : query(0), handler(0), compiled(false) {}
+  ~XSLTStylesheet() { delete query; delete handler; }
+
+  QDateTime           modified;
+  QXmlQuery          *query;
+  XSLTMessageHandler *handler;
+  bool                compiled;
+};
+
+// only touched from the single worker thread, so no locking is needed
+static QHash<QString, XSLTStylesheet*> _stylesheets;
+
+static QThreadPool *xsltPool()
+{
+  static QThreadPool *pool = 0;
+  if (! pool)
+  {
+    pool = new QThreadPool(QCoreApplication::instance());
+    pool->setMaxThreadCount(1);
+    pool->setExpiryTimeout(-1); // keep the thread that owns the stylesheets
+  }
+  return pool;
+}
+
+XSLTTransformer::XSLTTransformer(const QString &stylesheet, QIODevice *input,
+                                 QIODevice *output)
+  : QObject(),
+    _stylesheet(stylesheet),
+    _input(input),
+    _output(output),
+    _result(Failed)
+{
+  setAutoDelete(false);
+}
+
+/** \brief Transform the input device to the output device with the given
+           stylesheet.
+
+  \param stylesheet The absolute path of the XSLT file.
+  \param input      An open, readable device holding the source document.
+  \param output     An open, writable device for the result.
+  \param[out] errmsg Why the transformation failed, if it did.
+  */
+XSLTTransformer::Result XSLTTransformer::transform(const QString &stylesheet,
+                                                   QIODevice *input,
+                                                   QIODevice *output,
+                                                   QString &errmsg)
+{
+  XSLTTransformer job(stylesheet, input, output);
+
+  if (QCoreApplication::instance() &&
+      QThread::currentThread() == QCoreApplication::instance()->thread())
+  {
+    QEventLoop loop;
+    connect(&job, SIGNAL(finished()), &loop, SLOT(quit()), Qt::QueuedConnection);
+    xsltPool()->start(&job);
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+  }
+  else
+  {
+    xsltPool()->start(&job);
+    xsltPool()->waitForDone();
+  }
+
+  if (job._result != Transformed)
+    errmsg = job._errmsg;
+  return job._result;
+}
+
+void XSLTTransformer::run()
+{
+  QFileInfo fileinfo(_stylesheet);
+  XSLTStylesheet *sheet = _stylesheets.value(_stylesheet);
+  if (sheet && sheet->modified != fileinfo.lastModified())
+  {
+    _stylesheets.remove(_stylesheet);
+    delete sheet;
+    sheet = 0;
+  }
+
+  if (! sheet)
+  {
+    if (DEBUG)
+      qDebug("XSLTTransformer::run() compiling %s", qPrintable(_stylesheet));
+    sheet = new XSLTStylesheet();
+    sheet->modified = fileinfo.lastModified();
+    sheet->handler  = new XSLTMessageHandler();
+    sheet->query    = new QXmlQuery(QXmlQuery::XSLT20);
+    sheet->query->setMessageHandler(sheet->handler);
+    sheet->query->setQuery(QUrl::fromLocalFile(_stylesheet));
+    sheet->compiled = sheet->query->isValid();
+    if (! sheet->compiled)
+      qWarning("XSLTTransformer could not compile %s: %s",
+               qPrintable(_stylesheet), qPrintable(sheet->handler->lastError));
+    _stylesheets.insert(_stylesheet, sheet);
+  }
+
+  if (! sheet->compiled)
+    _result = Unsupported;
+  else
+  {
+    sheet->handler->lastError.clear();
+    if (! sheet->query->setFocus(_input))
+    {
+      _result = Failed;
+      _errmsg = sheet->handler->lastError;
+    }
+    else if (! sheet->query->evaluateTo(_output))
+    {
+      _result = Failed;
+      _errmsg = sheet->handler->lastError;
+    }
+    else
+      _result = Transformed;
+
+    if (_result == Failed && _errmsg.isEmpty())
+      _errmsg = tr("Could not apply the XSLT stylesheet %1.").arg(_stylesheet);
+  }
+
+  emit finished();
+}
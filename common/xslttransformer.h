@@ -0,0 +1,56 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XSLTTRANSFORMER_H__
+#define __XSLTTRANSFORMER_H__
+
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+
+class QIODevice;
+
+/* XSLTTransformer applies XSLT stylesheets with QtXmlPatterns instead of
+   an external processor. Each stylesheet is compiled the first time it is
+   used and kept until the file changes. All of the work happens on one
+   worker thread that owns the compiled stylesheets; a caller on the GUI
+   thread waits in a local event loop so the windows keep painting.
+
+   QtXmlPatterns does not implement all of XSLT 1.0. transform() returns
+   Unsupported when a stylesheet does not compile so the caller can fall
+   back to the external processor.
+*/
+class XSLTTransformer : public QObject, public QRunnable
+{
+  Q_OBJECT
+
+  public:
+    enum Result { Transformed, Failed, Unsupported };
+
+    static Result transform(const QString &stylesheet, QIODevice *input,
+                            QIODevice *output, QString &errmsg);
+
+    virtual void run();
+
+  signals:
+    void finished();
+
+  private:
+    XSLTTransformer(const QString &stylesheet, QIODevice *input,
+                    QIODevice *output);
+
+    QString    _stylesheet;
+    QIODevice *_input;
+    QIODevice *_output;
+    Result     _result;
+    QString    _errmsg;
+};
+
+#endif
@@ -0,0 +1,796 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xsqlthread.h"
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlField>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include <climits>
+
+#include <libpq-fe.h>
+#include <metasql.h>
+
+#define DEBUG false
+
+#define DEFAULTBATCHSIZE 500
+#define PAGEIDLETIMEOUT  30000  // msec a paged query keeps its cursor open unread
+
+static QAtomicInt _connectionCounter;
+
+XSqlThread::XSqlThread(QObject *parent)
+  : QThread(parent),
+    _cancelHandle(0),
+    _generation(0),
+    _runGeneration(0),
+    _batchSize(DEFAULTBATCHSIZE),
+    _pageSize(0),
+    _pagesWanted(0),
+    _fetchAll(false),
+    _paused(false),
+    _cancelled(false),
+    _keepConnection(false),
+    _queryPending(false),
+    _busy(false),
+    _stopping(false),
+    _port(-1),
+    _isMetaSQL(true)
+{
+  qRegisterMetaType<QList<QSqlRecord> >("QList<QSqlRecord>");
+
+  connect(this, SIGNAL(rowsQueued(int, const QList<QSqlRecord> &)),
+          this, SLOT(sRowsQueued(int, const QList<QSqlRecord> &)), Qt::QueuedConnection);
+  connect(this, SIGNAL(pageQueued(int)),
+          this, SLOT(sPageQueued(int)), Qt::QueuedConnection);
+  connect(this, SIGNAL(totalsQueued(int, const QVariantMap &)),
+          this, SLOT(sTotalsQueued(int, const QVariantMap &)), Qt::QueuedConnection);
+  connect(this, SIGNAL(finishedQueued(int)),
+          this, SLOT(sFinishedQueued(int)), Qt::QueuedConnection);
+
+  /* copy the connection parameters here, in the GUI thread. the worker
+     opens its own connection with them since a QSqlDatabase may only be
+     used by the thread that opened it.
+   */
+  QSqlDatabase db = QSqlDatabase::database();
+  _driverName     = db.driverName();
+  _hostName       = db.hostName();
+  _databaseName   = db.databaseName();
+  _userName       = db.userName();
+  _password       = db.password();
+  _port           = db.port();
+  _connectOptions = db.connectOptions();
+  _connectionName = QString("xsqlthread%1").arg(_connectionCounter.fetchAndAddOrdered(1));
+}
+
+XSqlThread::~XSqlThread()
+{
+  if (isRunning())
+  {
+    {
+      QMutexLocker locker(&_mutex);
+      _stopping = true;
+      _queryWanted.wakeAll();
+    }
+    cancel();
+    wait();
+  }
+}
+
+void XSqlThread::setQuery(const QString &metasql, const ParameterList &params)
+{
+  QMutexLocker locker(&_mutex);
+  _isMetaSQL = true;
+  _metasql   = metasql;
+  _params    = params;
+  _cancelled = false;
+  _generation++;
+  _error     = QSqlError();
+  _pagesWanted = 0;
+  _fetchAll    = false;
+}
+
+/* run plain SQL instead of MetaSQL, binding each parameter to the
+   placeholder with the same name, e.g. "number" to :number
+ */
+void XSqlThread::setSql(const QString &sql, const ParameterList &bindings)
+{
+  QMutexLocker locker(&_mutex);
+  _isMetaSQL = false;
+  _metasql   = sql;
+  _params    = bindings;
+  _cancelled = false;
+  _generation++;
+  _error     = QSqlError();
+  _pagesWanted = 0;
+  _fetchAll    = false;
+}
+
+/* connect to some other database than the one the application is using,
+   such as a child company's database. call before start().
+ */
+void XSqlThread::setConnection(const QString &hostName,
+                               const QString &databaseName, int port,
+                               const QString &userName,
+                               const QString &password)
+{
+  QMutexLocker locker(&_mutex);
+  _hostName     = hostName;
+  _databaseName = databaseName;
+  _port         = port;
+  _userName     = userName;
+  _password     = password;
+}
+
+void XSqlThread::setBatchSize(int rows)
+{
+  QMutexLocker locker(&_mutex);
+  _batchSize = rows > 0 ? rows : DEFAULTBATCHSIZE;
+}
+
+int XSqlThread::batchSize() const
+{
+  QMutexLocker locker(&_mutex);
+  return _batchSize;
+}
+
+/* read the query a page of rows at a time through a server-side cursor.
+   0, the default, reads all of the rows at once. the cursor lives in a
+   transaction on the worker's connection, which is committed once the
+   last page has been read, the query is cancelled, or nobody has asked
+   for a page for PAGEIDLETIMEOUT msec. call before start() or runQuery().
+ */
+void XSqlThread::setPageSize(int rows)
+{
+  QMutexLocker locker(&_mutex);
+  _pageSize = rows > 0 ? rows : 0;
+}
+
+int XSqlThread::pageSize() const
+{
+  QMutexLocker locker(&_mutex);
+  return _pageSize;
+}
+
+bool XSqlThread::isCancelled() const
+{
+  QMutexLocker locker(&_mutex);
+  return _cancelled;
+}
+
+/* true while a paged query waits for fetchMore() or fetchAll(). only
+   those and cancel() end the wait, so this can't change underneath the
+   thread that calls them.
+ */
+bool XSqlThread::isPaused() const
+{
+  QMutexLocker locker(&_mutex);
+  return _paused;
+}
+
+QSqlError XSqlThread::lastError() const
+{
+  QMutexLocker locker(&_mutex);
+  return _error;
+}
+
+// stop handing back rows and cancel the statement the worker is running
+void XSqlThread::cancel()
+{
+  {
+    QMutexLocker locker(&_mutex);
+    _cancelled = true;
+  }
+  cancelStatement();
+  _pageWanted.wakeAll();
+}
+
+/* run the query set with setQuery() or setSql() and keep the worker and
+   its connection for the next one. a query that is still running is
+   cancelled first; queryFinished() is only emitted for the new one.
+ */
+void XSqlThread::runQuery()
+{
+  bool busy;
+  {
+    QMutexLocker locker(&_mutex);
+    _keepConnection = true;
+    busy = _busy;
+  }
+
+  /* cancel before handing over the new query so the cancel request can't
+     reach the server after the worker has started on the new statement
+   */
+  if (busy)
+    cancelStatement();
+
+  {
+    QMutexLocker locker(&_mutex);
+    _queryPending = true;
+    _queryWanted.wakeAll();
+    _pageWanted.wakeAll();
+  }
+  if (! isRunning())
+    start();
+}
+
+/* ask the server to cancel the statement the worker connection is
+   running. PQcancel() sends the request for the worker's own connection,
+   so unlike pg_cancel_backend() it needs no special privileges and can be
+   called from the GUI thread while the worker is blocked in the query.
+ */
+void XSqlThread::cancelStatement()
+{
+  QMutexLocker locker(&_mutex);   // closeDatabase() frees the handle
+  if (! _cancelHandle)
+    return;
+
+  char errbuf[256];
+  if (! PQcancel(_cancelHandle, errbuf, sizeof(errbuf)))
+    qWarning("XSqlThread::cancelStatement() could not cancel: %s", errbuf);
+  else if (DEBUG)
+    qDebug("XSqlThread::cancelStatement() sent the cancel request");
+}
+
+// read the next page of a paged query
+void XSqlThread::fetchMore()
+{
+  QMutexLocker locker(&_mutex);
+  _pagesWanted++;
+  _pageWanted.wakeAll();
+}
+
+// read all of the remaining rows of a paged query
+void XSqlThread::fetchAll()
+{
+  QMutexLocker locker(&_mutex);
+  _fetchAll = true;
+  _pageWanted.wakeAll();
+}
+
+// the characters QSqlQuery accepts in a :name placeholder
+static bool isPlaceholderChar(const QChar &c)
+{
+  return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+/* a cursor cannot be declared over a prepared statement, so put the values
+   MetaSQL bound back into the statement text the way the driver quotes
+   them. the statement is scanned so only whole :name tokens are replaced,
+   not text in quoted literals, quoted identifiers, comments or :: casts.
+   returns an empty string if the values can't be put back safely: the
+   query uses positional placeholders, has a placeholder with no bound
+   value, or has a literal or comment that doesn't end.
+ */
+QString XSqlThread::inlineBoundValues(const QSqlQuery &query,
+                                      const QSqlDriver *driver)
+{
+  QMap<QString, QVariant> bound = query.boundValues();
+  for (QMap<QString, QVariant>::const_iterator it = bound.constBegin();
+       it != bound.constEnd(); ++it)
+  {
+    if (! it.key().startsWith(":"))
+      return QString();         // positional placeholders, can't inline
+  }
+
+  QString sql = query.lastQuery().trimmed();
+  while (sql.endsWith(";"))
+    sql = sql.left(sql.length() - 1).trimmed();
+
+  QString result;
+  result.reserve(sql.length());
+  int n = sql.length();
+  int i = 0;
+  while (i < n)
+  {
+    QChar ch   = sql.at(i);
+    QChar next = (i + 1 < n) ? sql.at(i + 1) : QChar();
+    QChar prev = (i > 0)     ? sql.at(i - 1) : QChar();
+    int   end  = i + 1;         // copy sql[i, end) unchanged
+
+    if (ch == '\'')             // 'literal', with '' or E'\'' escapes
+    {
+      bool backslash = (prev == 'E' || prev == 'e') &&
+                       (i < 2 || ! isPlaceholderChar(sql.at(i - 2)));
+      for ( ; end < n; end++)
+      {
+        if (backslash && sql.at(end) == '\\')
+          end++;
+        else if (sql.at(end) == '\'')
+        {
+          if (end + 1 < n && sql.at(end + 1) == '\'')
+            end++;              // '' stands for one quote
+          else
+            break;
+        }
+      }
+      if (end >= n)
+        return QString();
+      end++;
+    }
+    else if (ch == '"')         // "identifier"
+    {
+      end = sql.indexOf('"', i + 1);
+      if (end < 0)
+        return QString();
+      end++;
+    }
+    else if (ch == '-' && next == '-')
+    {
+      end = sql.indexOf('\n', i);
+      if (end < 0)
+        end = n;
+    }
+    else if (ch == '/' && next == '*')  // /* comment */, which may nest
+    {
+      int depth = 1;
+      for (end = i + 2; depth > 0 && end < n; )
+      {
+        if (sql.midRef(end, 2) == QLatin1String("/*"))
+        {
+          depth++;
+          end += 2;
+        }
+        else if (sql.midRef(end, 2) == QLatin1String("*/"))
+        {
+          depth--;
+          end += 2;
+        }
+        else
+          end++;
+      }
+      if (depth > 0)
+        return QString();
+    }
+    else if (ch == '$' && ! isPlaceholderChar(prev) &&
+             (next == '$' || next.isLetter() || next == '_'))
+    {                           // $tag$ dollar quoting $tag$, but not $1
+      int tagend = i + 1;
+      while (tagend < n && isPlaceholderChar(sql.at(tagend)))
+        tagend++;
+      if (tagend < n && sql.at(tagend) == '$')
+      {
+        QString tag   = sql.mid(i, tagend - i + 1);
+        int     close = sql.indexOf(tag, tagend + 1);
+        if (close < 0)
+          return QString();
+        end = close + tag.length();
+      }
+    }
+    else if (ch == ':' && next == ':')
+      end = i + 2;              // a cast
+    else if (ch == ':' && isPlaceholderChar(next))
+    {
+      end = i + 2;
+      while (end < n && isPlaceholderChar(sql.at(end)))
+        end++;
+
+      QString name = sql.mid(i, end - i);
+      if (! bound.contains(name))
+        return QString();
+
+      QVariant  value = bound.value(name);
+      QSqlField field(QString(), value.type());
+      field.setValue(value);
+      result += driver->formatValue(field);
+      i = end;
+      continue;
+    }
+
+    result += sql.mid(i, end - i);
+    i = end;
+  }
+
+  return result;
+}
+
+/* open this thread's own connection and log in. call from run().
+   on failure the error is saved for lastError() and the returned
+   database is not open.
+ */
+QSqlDatabase XSqlThread::openDatabase()
+{
+  QSqlDatabase db = QSqlDatabase::contains(_connectionName)
+                  ? QSqlDatabase::database(_connectionName, false)
+                  : QSqlDatabase::addDatabase(_driverName, _connectionName);
+  db.setHostName(_hostName);
+  db.setDatabaseName(_databaseName);
+  db.setUserName(_userName);
+  db.setPassword(_password);
+  db.setPort(_port);
+  db.setConnectOptions(_connectOptions);
+
+  /* use QSqlQuery::exec() instead of XSqlQuery::exec() so the error
+     listeners, which update the GUI, don't get called from this thread
+   */
+  QSqlQuery setup(db);
+  if (! db.open())
+    setLastError(db.lastError());
+  else if (! setup.exec("SELECT login() AS result;"))
+  {
+    setLastError(setup.lastError());
+    db.close();
+  }
+  else
+  {
+    QVariant handle = db.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0)
+    {
+      PGconn *conn = *static_cast<PGconn **>(handle.data());
+      QMutexLocker locker(&_mutex);
+      if (_cancelHandle)
+        PQfreeCancel(_cancelHandle);
+      _cancelHandle = conn ? PQgetCancel(conn) : 0;
+    }
+  }
+
+  return db;
+}
+
+void XSqlThread::closeDatabase()
+{
+  {
+    QMutexLocker locker(&_mutex);
+    if (_cancelHandle)
+      PQfreeCancel(_cancelHandle);
+    _cancelHandle = 0;
+  }
+  {
+    QSqlDatabase db = QSqlDatabase::database(_connectionName, false);
+    db.close();
+  }
+  QSqlDatabase::removeDatabase(_connectionName);
+}
+
+void XSqlThread::setLastError(const QSqlError &error)
+{
+  QMutexLocker locker(&_mutex);
+  _error = error;
+}
+
+void XSqlThread::run()
+{
+  for (bool first = true; takeQuery(first); first = false)
+  {
+    {
+      QSqlDatabase db = QSqlDatabase::database(_connectionName, false);
+      if (! db.isOpen())
+        db = openDatabase();
+      if (db.isOpen())
+        execQuery(db);
+    }
+
+    int generation;
+    {
+      QMutexLocker locker(&_mutex);
+      _busy      = false;
+      generation = _runGeneration;
+    }
+    emit finishedQueued(generation);
+    if (DEBUG)
+      qDebug("XSqlThread::run() query done, error: %s",
+             qPrintable(lastError().text()));
+  }
+
+  closeDatabase();
+}
+
+/* wait for the next query from runQuery(). the first query is the one
+   set before start() or runQuery() started the thread. returns false
+   when the thread should end.
+ */
+bool XSqlThread::takeQuery(bool first)
+{
+  QMutexLocker locker(&_mutex);
+  if (! first && ! _keepConnection)
+    return false;
+  while (! first && ! _stopping && ! _queryPending)
+    _queryWanted.wait(&_mutex);
+  if (_stopping)
+    return false;
+
+  _queryPending  = false;
+  _busy          = true;
+  _runGeneration = _generation;
+  _error         = QSqlError();
+  return true;
+}
+
+// true once the query the worker is running was cancelled or replaced
+bool XSqlThread::isStopped() const
+{
+  QMutexLocker locker(&_mutex);
+  return _cancelled || _stopping || _runGeneration != _generation;
+}
+
+void XSqlThread::execQuery(QSqlDatabase &db)
+{
+  bool          isMetaSQL;
+  QString       metasql;
+  ParameterList params;
+  int           batchSize;
+  int           pageSize;
+  {
+    QMutexLocker locker(&_mutex);
+    isMetaSQL = _isMetaSQL;
+    metasql   = _metasql;
+    params    = _params;
+    batchSize = _batchSize;
+    pageSize  = _pageSize;
+  }
+
+  QSqlQuery query(db);
+  if (isMetaSQL)
+  {
+    MetaSQLQuery mql(metasql);
+    query = mql.toQuery(params, db, false);
+  }
+  else
+  {
+    query.prepare(metasql);
+    for (int i = 0; i < params.count(); i++)
+      query.bindValue(":" + params.name(i), params.value(i));
+  }
+
+  bool paged = false;
+  if (pageSize > 0 && ! isStopped())
+  {
+    QString sql = inlineBoundValues(query, db.driver());
+    paged = ! sql.isEmpty() && runPaged(db, sql, pageSize, batchSize);
+  }
+
+  if (paged)
+    ;                           // runPaged() has read the rows
+  else if (! isStopped() && ! query.exec())
+    setLastError(query.lastError());
+  else
+  {
+    QList<QSqlRecord> batch;
+    while (! isStopped() && query.next())
+    {
+      batch.append(query.record());
+      if (batch.size() >= batchSize)
+      {
+        emit rowsQueued(_runGeneration, batch);
+        batch.clear();
+      }
+    }
+    if (! isStopped() && ! batch.isEmpty())
+      emit rowsQueued(_runGeneration, batch);
+  }
+}
+
+/* read the query through a cursor one page at a time, waiting for
+   fetchMore() or fetchAll() between pages. returns false without reading
+   anything if the cursor can't be declared, e.g. for several statements,
+   so the caller can run the query the ordinary way.
+
+   the cursor's transaction pins a snapshot and keeps vacuum from cleaning
+   up after it, so if the user leaves the list alone for PAGEIDLETIMEOUT
+   the cursor is closed and the transaction committed. the next page
+   declares the cursor again and skips the rows already read. rows added
+   or removed in the meantime can shift that page by as many rows.
+ */
+bool XSqlThread::runPaged(QSqlDatabase &db, const QString &sql,
+                          int pageSize, int batchSize)
+{
+  QSqlQuery cursorq(db);
+  cursorq.setForwardOnly(true);
+  if (! cursorq.exec("BEGIN;"))
+  {
+    setLastError(cursorq.lastError());
+    return true;
+  }
+  if (! cursorq.exec("DECLARE xtpage NO SCROLL CURSOR FOR " + sql + ";"))
+  {
+    if (DEBUG)
+      qDebug("XSqlThread::runPaged() could not declare a cursor: %s",
+             qPrintable(cursorq.lastError().text()));
+    cursorq.exec("ROLLBACK;");
+    return false;
+  }
+
+  bool open = true;             // the cursor and its transaction
+  int  read = 0;
+  for (bool first = true; ! isStopped(); first = false)
+  {
+    if (! first && open && ! waitForPage(PAGEIDLETIMEOUT))
+    {
+      if (isStopped())
+        break;
+      if (DEBUG)
+        qDebug("XSqlThread::runPaged() closing the idle cursor after %d rows", read);
+      cursorq.exec("COMMIT;");
+      open = false;
+    }
+    if (! open)
+    {
+      if (! waitForPage(ULONG_MAX))
+        break;
+      if (! cursorq.exec("BEGIN;") ||
+          ! cursorq.exec("DECLARE xtpage NO SCROLL CURSOR FOR " + sql + ";") ||
+          ! cursorq.exec(QString("MOVE FORWARD %1 IN xtpage;").arg(read)))
+      {
+        setLastError(cursorq.lastError());
+        cursorq.exec("ROLLBACK;");
+        break;
+      }
+      open = true;
+    }
+
+    bool all;
+    {
+      QMutexLocker locker(&_mutex);
+      all = _fetchAll;
+    }
+
+    if (! cursorq.exec(QString("FETCH FORWARD %1 FROM xtpage;")
+                       .arg(all ? QString("ALL") : QString::number(pageSize))))
+    {
+      setLastError(cursorq.lastError());
+      break;
+    }
+
+    QList<QSqlRecord> batch;
+    int               fetched = 0;
+    while (! isStopped() && cursorq.next())
+    {
+      batch.append(cursorq.record());
+      fetched++;
+      if (batch.size() >= batchSize)
+      {
+        emit rowsQueued(_runGeneration, batch);
+        batch.clear();
+      }
+    }
+    if (! isStopped() && ! batch.isEmpty())
+      emit rowsQueued(_runGeneration, batch);
+    read += fetched;
+
+    if (all || fetched < pageSize)
+      break;                    // that was the last page
+
+    if (first)
+    {
+      QVariantMap sums = totals(db, sql, cursorq.record());
+      if (! isStopped() && ! sums.isEmpty())
+        emit totalsQueued(_runGeneration, sums);
+    }
+    {
+      QMutexLocker locker(&_mutex);
+      _paused = true;
+    }
+    emit pageQueued(_runGeneration);
+  }
+
+  // ends the transaction, or rolls it back if a statement failed
+  if (open)
+  {
+    QSqlQuery endq(db);
+    endq.exec("COMMIT;");
+  }
+  return true;
+}
+
+/* the worker's signals are queued for the GUI thread. by the time one is
+   delivered the query may have been cancelled or replaced with setQuery(),
+   so only pass on what belongs to the query that is current now.
+ */
+bool XSqlThread::isCurrent(int generation) const
+{
+  QMutexLocker locker(&_mutex);
+  return generation == _generation && ! _cancelled;
+}
+
+void XSqlThread::sRowsQueued(int generation, const QList<QSqlRecord> &records)
+{
+  if (isCurrent(generation))
+    emit rowsReady(records);
+}
+
+void XSqlThread::sPageQueued(int generation)
+{
+  if (isCurrent(generation))
+    emit pageFetched();
+}
+
+void XSqlThread::sTotalsQueued(int generation, const QVariantMap &totals)
+{
+  if (isCurrent(generation))
+    emit totalsReady(totals);
+}
+
+// a cancelled query still finishes, one that was replaced doesn't
+void XSqlThread::sFinishedQueued(int generation)
+{
+  bool current;
+  {
+    QMutexLocker locker(&_mutex);
+    current = (generation == _generation);
+  }
+  if (current)
+    emit queryFinished();
+}
+
+/* block until fetchMore(), fetchAll() or cancel() is called, runQuery()
+   replaces the query, or timeout msec pass. returns true if a page is
+   wanted. the query stays paused if the wait merely timed out.
+ */
+bool XSqlThread::waitForPage(unsigned long timeout)
+{
+  QMutexLocker locker(&_mutex);
+  while (! _cancelled && ! _stopping && _runGeneration == _generation &&
+         ! _fetchAll && _pagesWanted <= 0)
+  {
+    if (! _pageWanted.wait(&_mutex, timeout))
+      break;
+  }
+
+  bool stopped = _cancelled || _stopping || _runGeneration != _generation;
+  bool wanted  = ! stopped && (_fetchAll || _pagesWanted > 0);
+  _paused = ! stopped && ! wanted;
+  if (wanted && _pagesWanted > 0)
+    _pagesWanted--;
+  return wanted;
+}
+
+/* sum the columns that XTreeWidget totals, those with a matching
+   <column>_xttotalrole column, over the whole result so a paged list can
+   show totals for rows it hasn't read yet. only total set 0 is summed;
+   XTreeWidget shows these in its set 0 totals row and sums any other
+   sets from the rows it has. a savepoint keeps a failure here from
+   aborting the transaction the cursor lives in.
+ */
+QVariantMap XSqlThread::totals(QSqlDatabase &db, const QString &sql,
+                               const QSqlRecord &record)
+{
+  QVariantMap  result;
+  QStringList  names;
+  QStringList  sums;
+  QSqlDriver  *driver = db.driver();
+  for (int i = 0; i < record.count(); i++)
+  {
+    QString name = record.fieldName(i);
+    if (record.indexOf(name + "_xttotalrole") < 0)
+      continue;
+
+    names << name;
+    sums  << QString("SUM(CASE WHEN COALESCE(%1, 0) = 0 THEN %2 END)")
+             .arg(driver->escapeIdentifier(name + "_xttotalrole", QSqlDriver::FieldName),
+                  driver->escapeIdentifier(name, QSqlDriver::FieldName));
+  }
+  if (sums.isEmpty())
+    return result;
+
+  QSqlQuery sumq(db);
+  sumq.exec("SAVEPOINT xtpagetotals;");
+  if (sumq.exec("SELECT " + sums.join(", ") +
+                " FROM (" + sql + ") AS xtpagedata;") && sumq.first())
+  {
+    for (int i = 0; i < names.size(); i++)
+      result.insert(names.at(i), sumq.value(i));
+    sumq.exec("RELEASE SAVEPOINT xtpagetotals;");
+  }
+  else
+  {
+    if (DEBUG)
+      qDebug("XSqlThread::totals() could not sum %s: %s",
+             qPrintable(names.join(", ")),
+             qPrintable(sumq.lastError().text()));
+    sumq.exec("ROLLBACK TO SAVEPOINT xtpagetotals;");
+  }
+
+  return result;
+}
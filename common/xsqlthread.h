@@ -0,0 +1,147 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __XSQLTHREAD_H__
+#define __XSQLTHREAD_H__
+
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+#include <parameter.h>
+
+class QSqlDriver;
+class QSqlQuery;
+struct pg_cancel;
+
+/* XSqlThread runs one MetaSQL query on a worker thread with its own
+   database connection and hands the results back to the GUI thread in
+   batches of QSqlRecords. cancel() asks the server to cancel the running
+   statement. Batches that were already on their way to the GUI thread
+   when the query was cancelled or replaced are dropped, so a receiver
+   only ever sees rows from the current query.
+
+   start() runs one query and ends the thread. runQuery() instead keeps
+   the thread and its connection for the next query, so a window that
+   refreshes often logs in once rather than once per refresh.
+
+   With setPageSize() the query is read through a server-side cursor
+   instead: the first page is fetched at once, then the thread waits for
+   fetchMore() or fetchAll() before reading on. This keeps huge results
+   on the server until the user actually scrolls to them. A cursor nobody
+   reads from for a while is closed, and declared again when more rows
+   are wanted, so an open window doesn't hold a transaction open.
+*/
+class XSqlThread : public QThread
+{
+  Q_OBJECT
+
+  public:
+    XSqlThread(QObject *parent = 0);
+    ~XSqlThread();
+
+    void      setQuery(const QString &metasql, const ParameterList &params);
+    void      setSql(const QString &sql, const ParameterList &bindings);
+    void      setBatchSize(int rows);
+    void      setPageSize(int rows);
+    void      setConnection(const QString &hostName, const QString &databaseName,
+                            int port, const QString &userName,
+                            const QString &password);
+    int       batchSize()   const;
+    int       pageSize()    const;
+    bool      isCancelled() const;
+    bool      isPaused()    const;
+    QSqlError lastError()   const;
+
+    static QString inlineBoundValues(const QSqlQuery &query,
+                                     const QSqlDriver *driver);
+
+  public slots:
+    void runQuery();
+    void cancel();
+    void fetchMore();
+    void fetchAll();
+
+  signals:
+    void rowsReady(const QList<QSqlRecord> &records);
+    void pageFetched();
+    void totalsReady(const QVariantMap &totals);
+    void queryFinished();
+
+    // emitted by the worker, relayed by the sXxxQueued() slots
+    void rowsQueued(int generation, const QList<QSqlRecord> &records);
+    void pageQueued(int generation);
+    void totalsQueued(int generation, const QVariantMap &totals);
+    void finishedQueued(int generation);
+
+  protected:
+    virtual void run();
+
+    QSqlDatabase openDatabase();
+    void         closeDatabase();
+    void         setLastError(const QSqlError &error);
+
+  private slots:
+    void sRowsQueued(int generation, const QList<QSqlRecord> &records);
+    void sPageQueued(int generation);
+    void sTotalsQueued(int generation, const QVariantMap &totals);
+    void sFinishedQueued(int generation);
+
+  private:
+    bool         isCurrent(int generation) const;
+    bool         isStopped() const;
+    bool         takeQuery(bool first);
+    void         execQuery(QSqlDatabase &db);
+    void         cancelStatement();
+    bool         runPaged(QSqlDatabase &db, const QString &sql,
+                          int pageSize, int batchSize);
+    bool         waitForPage(unsigned long timeout);
+    QVariantMap  totals(QSqlDatabase &db, const QString &sql,
+                        const QSqlRecord &record);
+
+    mutable QMutex _mutex;
+    QWaitCondition _pageWanted;
+    QWaitCondition _queryWanted;
+    pg_cancel     *_cancelHandle;
+    int            _generation;
+    int            _runGeneration;
+    int            _batchSize;
+    int            _pageSize;
+    int            _pagesWanted;
+    bool           _fetchAll;
+    bool           _paused;
+    bool           _cancelled;
+    bool           _keepConnection;
+    bool           _queryPending;
+    bool           _busy;
+    bool           _stopping;
+    QString        _connectionName;
+    QString        _driverName;
+    QString        _hostName;
+    QString        _databaseName;
+    QString        _userName;
+    QString        _password;
+    int            _port;
+    QString        _connectOptions;
+    QSqlError      _error;
+    bool           _isMetaSQL;
+    QString        _metasql;
+    ParameterList  _params;
+};
+
+Q_DECLARE_METATYPE(QList<QSqlRecord>)
+
+#endif
@@ -58,6 +58,16 @@ exists($${OPENRPT_LIBDIR}/libDmtx_Library.a)   { DMTXLIB = -lDmtx_Library }
 exists($${OPENRPT_LIBDIR}/libdmtx.lib)         { DMTXLIB = -ldmtx }
 exists($${OPENRPT_LIBDIR}/libDmtx_Library.lib) { DMTXLIB = -lDmtx_Library }
 
+# libpq, which XSqlThread uses to cancel queries. set PGSQL_HEADERS and
+# PGSQL_LIBDIR if PostgreSQL isn't where the compiler looks by default
+PGSQL_HEADERS = $$(PGSQL_HEADERS)
+! isEmpty( PGSQL_HEADERS ) { INCLUDEPATH  += $${PGSQL_HEADERS} }
+PGSQL_LIBDIR = $$(PGSQL_LIBDIR)
+! isEmpty( PGSQL_LIBDIR )  { QMAKE_LIBDIR += $${PGSQL_LIBDIR} }
+
+PGSQLLIB = -lpq
+win32-msvc*:PGSQLLIB = -llibpq
+
 # global.pri is processed at the top level but the variables are used down 1 level
 ! isEmpty( OPENRPT_DIR_REL    ) { OPENRPT_DIR    = ../$${OPENRPT_DIR}
                                   OPENRPT_BLD    = ../$${OPENRPT_BLD}    }
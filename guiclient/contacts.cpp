@@ -34,6 +34,8 @@ contacts::contacts(QWidget* parent, const char*, Qt::WFlags fl)
   setNewVisible(true);
   setSearchVisible(true);
   setQueryOnStartEnabled(true);
+  setFillInThread(true);
+  setFillPageSize(500);
 
   _crmacctid = -1;
   _attachAct = 0;
@@ -0,0 +1,275 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "creditcardgateway.h"
+
+#include <QApplication>
+#include <QCursor>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#define DEBUG false
+
+#define STARTPROPERTY     "_ccgatewayStarted"
+#define PROCESSORPROPERTY "_ccgatewayProcessor"
+
+static CreditCardGateway *_gateway = 0;
+
+CreditCardGateway::Stats::Stats()
+  : requests(0),
+    failures(0),
+    totalMsecs(0),
+    maxMsecs(0),
+    firstStarted(0),
+    lastFinished(0)
+{
+}
+
+double CreditCardGateway::Stats::averageMsecs() const
+{
+  return requests > 0 ? double(totalMsecs) / requests : 0;
+}
+
+/* completed requests per second of wall-clock time, which is higher than
+   1000 / averageMsecs() when requests overlap
+ */
+double CreditCardGateway::Stats::requestsPerSecond() const
+{
+  qint64 elapsed = lastFinished - firstStarted;
+  return elapsed > 0 ? requests * 1000.0 / elapsed : 0;
+}
+
+CreditCardGateway *CreditCardGateway::instance()
+{
+  if (! _gateway)
+    _gateway = new CreditCardGateway();
+  return _gateway;
+}
+
+CreditCardGateway::CreditCardGateway()
+  : QObject(qApp)
+{
+  setObjectName("_ccgateway");
+  _manager = new QNetworkAccessManager(this);
+  connect(_manager, SIGNAL(finished(QNetworkReply*)),
+          this,     SLOT(sFinished(QNetworkReply*)));
+}
+
+/** @brief Start an HTTP POST and return without waiting for the response.
+
+    The caller owns the returned reply and should deleteLater() it once it
+    has emitted finished().
+
+    @param processor The name used to group the statistics, usually the
+                     CCCompany metric.
+ */
+QNetworkReply *CreditCardGateway::post(const QString &processor,
+                                       const QUrl &url, const QByteArray &body,
+                                       const CreditCardHeaders &headers)
+{
+  QNetworkRequest request(url);
+  request.setHeader(QNetworkRequest::ContentTypeHeader,
+                    "application/x-www-form-urlencoded");
+  for (int i = 0; i < headers.size(); i++)
+    request.setRawHeader(headers.at(i).first.toUtf8(),
+                         headers.at(i).second.toUtf8());
+
+  QNetworkReply *reply = _manager->post(request, body);
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  reply->setProperty(STARTPROPERTY,     now);
+  reply->setProperty(PROCESSORPROPERTY, processor);
+
+  Stats &stats = _stats[processor];
+  if (stats.firstStarted == 0)
+    stats.firstStarted = now;
+
+  return reply;
+}
+
+/** @brief Send a request and wait for the response.
+
+    Other events are processed while waiting so the application keeps
+    painting, but user input is held back so nothing else can be started
+    in the middle of a transaction.
+
+    @param[out] response The body of the reply
+    @param[out] errmsg   Why the request failed, if it did
+    @param sslReceiver   An object with a sslErrors(QList<QSslError>) slot
+                         to decide whether to accept questionable
+                         certificates
+    @return 0 on success, otherwise the QNetworkReply::NetworkError
+ */
+int CreditCardGateway::send(const QString &processor, const QUrl &url,
+                            const QByteArray &body,
+                            const CreditCardHeaders &headers,
+                            QByteArray &response, QString &errmsg,
+                            QObject *sslReceiver)
+{
+  QNetworkReply *reply = post(processor, url, body, headers);
+  if (sslReceiver)
+    connect(reply,       SIGNAL(sslErrors(const QList<QSslError> &)),
+            sslReceiver, SLOT(sslErrors(const QList<QSslError> &)));
+
+  QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+  if (! reply->isFinished())
+  {
+    QEventLoop loop;
+    connect(reply, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+  }
+  QApplication::restoreOverrideCursor();
+
+  int result = reply->error();
+  if (result != QNetworkReply::NoError)
+    errmsg = reply->errorString();
+  else
+    response = reply->readAll();
+
+  reply->deleteLater();
+  return result;
+}
+
+/* used for all later requests; the manager keeps its connections */
+void CreditCardGateway::setProxy(const QNetworkProxy &proxy)
+{
+  _manager->setProxy(proxy);
+}
+
+QStringList CreditCardGateway::processors() const
+{
+  return _stats.keys();
+}
+
+CreditCardGateway::Stats CreditCardGateway::stats(const QString &processor) const
+{
+  return _stats.value(processor);
+}
+
+QString CreditCardGateway::statsText(const QString &processor) const
+{
+  Stats stats = _stats.value(processor);
+  return tr("%1: %2 requests, %3 failed, %4 ms average, %5 ms max, %6 per second")
+           .arg(processor)
+           .arg(stats.requests)
+           .arg(stats.failures)
+           .arg(stats.averageMsecs(), 0, 'f', 0)
+           .arg(stats.maxMsecs)
+           .arg(stats.requestsPerSecond(), 0, 'f', 2);
+}
+
+void CreditCardGateway::sFinished(QNetworkReply *reply)
+{
+  qint64 now     = QDateTime::currentMSecsSinceEpoch();
+  qint64 elapsed = now - reply->property(STARTPROPERTY).toLongLong();
+
+  Stats &stats = _stats[reply->property(PROCESSORPROPERTY).toString()];
+  stats.requests++;
+  stats.totalMsecs  += elapsed;
+  stats.maxMsecs     = qMax(stats.maxMsecs, elapsed);
+  stats.lastFinished = now;
+  if (reply->error() != QNetworkReply::NoError)
+    stats.failures++;
+
+  if (DEBUG)
+    qDebug("CreditCardGateway %s took %lld ms; %s",
+           qPrintable(reply->url().toString()), elapsed,
+           qPrintable(statsText(reply->property(PROCESSORPROPERTY).toString())));
+}
+
+CreditCardGatewayBatch::CreditCardGatewayBatch(const QString &processor,
+                                               int maxParallel, QObject *parent)
+  : QObject(parent),
+    _done(0),
+    _maxParallel(qMax(1, maxParallel)),
+    _next(0),
+    _processor(processor)
+{
+}
+
+/* queue a request and return its id for response() and errorString() */
+int CreditCardGatewayBatch::add(const QUrl &url, const QByteArray &body,
+                                const CreditCardHeaders &headers)
+{
+  Request request;
+  request.url     = url;
+  request.body    = body;
+  request.headers = headers;
+  _requests.append(request);
+  return _requests.size() - 1;
+}
+
+void CreditCardGatewayBatch::start()
+{
+  if (_requests.isEmpty())
+  {
+    emit finished();
+    return;
+  }
+  while (_next < _requests.size() && _replies.size() < _maxParallel)
+    sendNext();
+}
+
+bool CreditCardGatewayBatch::isFinished() const
+{
+  return _done == _requests.size();
+}
+
+int CreditCardGatewayBatch::count() const
+{
+  return _requests.size();
+}
+
+QByteArray CreditCardGatewayBatch::response(int id) const
+{
+  return (id >= 0 && id < _requests.size()) ? _requests.at(id).response : QByteArray();
+}
+
+QString CreditCardGatewayBatch::errorString(int id) const
+{
+  return (id >= 0 && id < _requests.size()) ? _requests.at(id).error : QString();
+}
+
+void CreditCardGatewayBatch::sendNext()
+{
+  const Request &request = _requests.at(_next);
+  QNetworkReply *reply = CreditCardGateway::instance()->post(_processor,
+                                                             request.url,
+                                                             request.body,
+                                                             request.headers);
+  _replies.insert(reply, _next);
+  _next++;
+  connect(reply, SIGNAL(finished()), this, SLOT(sReplyFinished()));
+}
+
+void CreditCardGatewayBatch::sReplyFinished()
+{
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  if (! reply || ! _replies.contains(reply))
+    return;
+
+  int id = _replies.take(reply);
+  if (reply->error() != QNetworkReply::NoError)
+    _requests[id].error = reply->errorString();
+  else
+    _requests[id].response = reply->readAll();
+  reply->deleteLater();
+  _done++;
+
+  emit replied(id);
+
+  if (_next < _requests.size())
+    sendNext();
+  else if (isFinished())
+    emit finished();
+}
@@ -0,0 +1,130 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef CREDITCARDGATEWAY_H
+#define CREDITCARDGATEWAY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkProxy;
+class QNetworkReply;
+
+typedef QList<QPair<QString, QString> > CreditCardHeaders;
+
+/* CreditCardGateway is the HTTP transport shared by all of the
+   CreditCardProcessor subclasses. It keeps one QNetworkAccessManager for
+   the session so connections, and their TLS sessions, are reused between
+   transactions instead of being set up for every request. Requests are
+   asynchronous; send() is a convenience that waits without letting the
+   user start another transaction. Latency and throughput are collected
+   per processor.
+*/
+class CreditCardGateway : public QObject
+{
+  Q_OBJECT
+
+  public:
+    class Stats
+    {
+      public:
+        Stats();
+
+        double averageMsecs()      const;
+        double requestsPerSecond() const;
+
+        int    requests;
+        int    failures;
+        qint64 totalMsecs;
+        qint64 maxMsecs;
+        qint64 firstStarted;
+        qint64 lastFinished;
+    };
+
+    static CreditCardGateway *instance();
+
+    QNetworkReply *post(const QString &processor, const QUrl &url,
+                        const QByteArray &body,
+                        const CreditCardHeaders &headers = CreditCardHeaders());
+    int            send(const QString &processor, const QUrl &url,
+                        const QByteArray &body, const CreditCardHeaders &headers,
+                        QByteArray &response, QString &errmsg,
+                        QObject *sslReceiver = 0);
+
+    void           setProxy(const QNetworkProxy &proxy);
+    QStringList    processors()                       const;
+    Stats          stats(const QString &processor)    const;
+    QString        statsText(const QString &processor) const;
+
+  private slots:
+    void sFinished(QNetworkReply *reply);
+
+  private:
+    CreditCardGateway();
+
+    QNetworkAccessManager *_manager;
+    QHash<QString, Stats>  _stats;
+};
+
+/* CreditCardGatewayBatch sends a list of requests through the gateway
+   with at most maxParallel of them in flight at once, e.g. to capture
+   the pre-authorizations for a posting run.
+*/
+class CreditCardGatewayBatch : public QObject
+{
+  Q_OBJECT
+
+  public:
+    CreditCardGatewayBatch(const QString &processor, int maxParallel = 4,
+                           QObject *parent = 0);
+
+    int        add(const QUrl &url, const QByteArray &body,
+                   const CreditCardHeaders &headers = CreditCardHeaders());
+    void       start();
+    bool       isFinished()           const;
+    int        count()                const;
+    QByteArray response(int id)       const;
+    QString    errorString(int id)    const;
+
+  signals:
+    void replied(int id);
+    void finished();
+
+  private slots:
+    void sReplyFinished();
+
+  private:
+    void sendNext();
+
+    struct Request
+    {
+      QUrl              url;
+      QByteArray        body;
+      CreditCardHeaders headers;
+      QByteArray        response;
+      QString           error;
+    };
+
+    int                        _done;
+    int                        _maxParallel;
+    int                        _next;
+    QString                    _processor;
+    QHash<QNetworkReply*, int> _replies;
+    QList<Request>             _requests;
+};
+
+#endif // CREDITCARDGATEWAY_H
@@ -13,7 +13,8 @@
 #include <QMessageBox>
 #include <QProcess>
 #include <QSqlError>
-#include <QHttp>
+#include <QNetworkProxy>
+#include <QNetworkReply>
 #include <QSslSocket>
 #include <QSslCertificate>
 #include <QSslConfiguration>
@@ -26,6 +27,7 @@
 #include <openreports.h>
 
 #include "guiclient.h"
+#include "creditcardgateway.h"
 #include "creditcardprocessor.h"
 #include "storedProcErrorLookup.h"
 
@@ -278,8 +280,7 @@ CreditCardProcessor::CreditCardProcessor()
     _defaultLiveServer("live.creditcardprocessor.com"),
     _defaultTestServer("test.creditcardprocessor.com"),
     _defaultLivePort(0),
-    _defaultTestPort(0),
-    _http(0)
+    _defaultTestPort(0)
 {
   if (DEBUG)
     qDebug("CCP:CreditCardProcessor()");
@@ -1797,43 +1798,31 @@ int CreditCardProcessor::sendViaHTTP(const QString &prequest,
       }
     }
 
-    QHttp::ConnectionMode cmode = QHttp::ConnectionModeHttps;
     QUrl ccurl(buildURL(_metrics->value("CCServer"), _metrics->value("CCPort"), true));
-    if(ccurl.scheme().compare("https", Qt::CaseInsensitive) != 0)
-      cmode = QHttp::ConnectionModeHttp;
-    _http = new QHttp(ccurl.host(), cmode, _metrics->value("CCPort").toInt());
-    connect(_http, SIGNAL(sslErrors(const QList<QSslError> &)),
-            this,  SLOT(sslErrors(const QList<QSslError> &)));
 
+    CreditCardGateway *gateway = CreditCardGateway::instance();
     if(_metrics->boolean("CCUseProxyServer"))
-    {
-      _http->setProxy(_metrics->value("CCProxyServer"), _metrics->value("CCProxyPort").toInt(),
-                    _metricsenc->value("CCProxyLogin"), _metricsenc->value("CCPassword"));
-    }
+      gateway->setProxy(QNetworkProxy(QNetworkProxy::HttpProxy,
+                                      _metrics->value("CCProxyServer"),
+                                      _metrics->value("CCProxyPort").toInt(),
+                                      _metricsenc->value("CCProxyLogin"),
+                                      _metricsenc->value("CCPassword")));
+    else
+      gateway->setProxy(QNetworkProxy(QNetworkProxy::DefaultProxy));
 
-    QHttpRequestHeader request("POST", ccurl.encodedPath());
-    if(!_extraHeaders.isEmpty())
-    {
-      request.setValues(_extraHeaders);
-    }
-    request.setValue("Host", ccurl.host());
-    
-    QApplication::setOverrideCursor( QCursor(Qt::WaitCursor) );
-    _http->request(request, prequest.toUtf8());
-    while(_http->hasPendingRequests() || _http->currentId() != 0)
-    {
-      QApplication::processEvents(QEventLoop::WaitForMoreEvents);
-    }
-    QApplication::restoreOverrideCursor();
-    if(_http->error() != QHttp::NoError)
+    QByteArray response;
+    QString    neterror;
+    int        neterrno = gateway->send(_company, ccurl, prequest.toUtf8(),
+                                        _extraHeaders, response, neterror, this);
+    if (neterrno != 0)
     {
       _errorMsg = errorMsg(-18)
                         .arg(ccurl.toString())
-                        .arg(_http->error())
-                        .arg(_http->errorString());
+                        .arg(neterrno)
+                        .arg(neterror);
       return -18;
     }
-    presponse = _http->readAll();
+    presponse = response;
   }
   else
 #endif // QT_NO_OPENSSL
@@ -3073,8 +3062,8 @@ void CreditCardProcessor::sslErrors(const QList<QSslError> &errors)
   if (DEBUG)
     qDebug() << "CreditCardProcessor::sslErrors(" << errors << ")";
 
-  QHttp *httpobj = qobject_cast<QHttp*>(sender());
-  if (errors.size() > 0 && httpobj)
+  QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+  if (errors.size() > 0 && reply)
   {
     QString errlist;
     for (int i = 0; i < errors.size(); i++)
@@ -3089,6 +3078,6 @@ void CreditCardProcessor::sslErrors(const QList<QSslError> &errors)
                               .arg(errlist),
                               QMessageBox::Yes,
                               QMessageBox::No | QMessageBox::Default) == QMessageBox::Yes)
-        httpobj->ignoreSslErrors();
+        reply->ignoreSslErrors();
   }
 }
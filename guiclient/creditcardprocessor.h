@@ -12,9 +12,11 @@
 #define CREDITCARDPROCESSOR_H
 
 #include <QHash>
+#include <QList>
 #include <QObject>
+#include <QPair>
+#include <QSslError>
 #include <QString>
-#include <QHttp>
 
 #include <parameter.h>
 
@@ -120,7 +122,6 @@ class CreditCardProcessor : public QObject
     QString		_ppassword;
     QString		_pport;
     QString		_pserver;
-    QHttp             * _http;
     QList<QPair<QString, QString> > _extraHeaders;
 
     protected slots:
@@ -13,11 +13,16 @@
 #include "xlineedit.h"
 #include "ui_display.h"
 
+#include <QCloseEvent>
+#include <QEventLoop>
+#include <QPointer>
 #include <QSqlError>
 #include <QMessageBox>
 #include <QPrinter>
 #include <QPrintDialog>
+#include <QSet>
 #include <QShortcut>
+#include <QTimer>
 #include <QToolButton>
 #include <QDebug>
 
@@ -30,6 +35,10 @@
 #include <previewdialog.h>
 
 #include "../scriptapi/parameterlistsetup.h"
+#include "xsqlthread.h"
+
+#define AUTOUPDATEDELAY 500  // msec to gather a burst of notices into one refresh
+#define AUTOUPDATETICKS 10   // ticks between refreshes once every channel is heard
 
 class displayPrivate : public Ui::display
 {
@@ -46,6 +55,21 @@ public:
     _useAltId = false;
     _queryOnStartEnabled = false;
     _autoUpdateEnabled = false;
+    _autoUpdateTicks = 0;
+    _refreshing = false;
+    _fillInThread = false;
+    _fillThread = 0;
+    _fillPageSize = 0;
+    _filling = false;
+    _fillWaiting = false;
+    _fillDone = false;
+    _fillAgain = false;
+    _fillAgainForce = false;
+    _closeWanted = false;
+
+    _autoUpdateTimer = new QTimer(_parent);
+    _autoUpdateTimer->setSingleShot(true);
+    _autoUpdateTimer->setInterval(AUTOUPDATEDELAY);
 
     // Build Toolbar even if we hide it so we get actions
     _newBtn = new QToolButton(_toolBar);
@@ -135,6 +159,22 @@ public:
   bool _useAltId;
   bool _queryOnStartEnabled;
   bool _autoUpdateEnabled;
+  QSet<QString> _autoUpdateHeard;
+  int _autoUpdateTicks;
+  bool _refreshing;
+  QStringList _autoUpdateChannels;
+  QTimer *_autoUpdateTimer;
+
+  bool _fillInThread;
+  XSqlThread *_fillThread;
+  int _fillPageSize;
+  bool _filling;        // a fill hasn't finished yet, e.g. a paged one
+  bool _fillWaiting;    // sFillList() is waiting for the current fill
+  bool _fillDone;       // the fill thread has finished the current query
+  bool _fillAgain;      // sFillList() was called while it was waiting
+  ParameterList _fillAgainParams;
+  bool _fillAgainForce;
+  bool _closeWanted;    // the window was closed while sFillList() waited
 
   QAction* _newAct;
   QAction* _closeAct;
@@ -440,6 +480,7 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   connect(this, SIGNAL(fillList()), this, SLOT(sFillList()));
   connect(_data->_list, SIGNAL(populateMenu(QMenu*,QTreeWidgetItem*,int)), this, SLOT(sPopulateMenu(QMenu*,QTreeWidgetItem*,int)));
   connect(_data->_autoupdate, SIGNAL(toggled(bool)), this, SLOT(sAutoUpdateToggled()));
+  connect(_data->_autoUpdateTimer, SIGNAL(timeout()), this, SLOT(sAutoUpdate()));
   connect(filterButton, SIGNAL(toggled(bool)), _data->_moreBtn, SLOT(setChecked(bool)));
 }
 
@@ -704,6 +745,79 @@ bool display::autoUpdateEnabled() const
   return _data->_autoUpdateEnabled;
 }
 
+/*!
+  Refresh an auto-updating display when the database sends a NOTIFY on one
+  of \a channels instead of on every tick. Until a notice has arrived on
+  every one of the channels the display keeps refreshing on each tick, so
+  it still updates against a database that sends only some or none of
+  these notices. After that it refreshes on every AUTOUPDATETICKS tick as
+  well, in case a notice is missed.
+
+  The channels are the names of the tables the display reads, and the
+  database is expected to send them from a statement-level trigger on each
+  table, for example:
+
+  \code
+  CREATE OR REPLACE FUNCTION _notifyTableChange() RETURNS TRIGGER AS $$
+  BEGIN
+    PERFORM pg_notify(TG_TABLE_NAME, '');
+    RETURN NULL;
+  END;
+  $$ LANGUAGE plpgsql;
+
+  CREATE TRIGGER coitemnotify AFTER INSERT OR UPDATE OR DELETE ON coitem
+     FOR EACH STATEMENT EXECUTE PROCEDURE _notifyTableChange();
+  \endcode
+*/
+void display::setAutoUpdateChannels(const QStringList &channels)
+{
+  _data->_autoUpdateChannels = channels;
+  _data->_autoUpdateHeard.clear();
+  _data->_autoUpdateTicks = 0;
+  sAutoUpdateToggled();
+}
+
+QStringList display::autoUpdateChannels() const
+{
+  return _data->_autoUpdateChannels;
+}
+
+/*!
+  Run the list's query on a separate database connection so the window
+  keeps painting while it runs and the list's Stop button can cancel it on
+  the server. That connection does not share the window's session, so
+  only turn this on for displays whose query does not depend on temporary
+  tables, session settings, or uncommitted work on the main connection.
+  The default is false.
+*/
+void display::setFillInThread(bool on)
+{
+  _data->_fillInThread = on;
+}
+
+bool display::fillInThread() const
+{
+  return _data->_fillInThread;
+}
+
+/*!
+  Read the list's rows \a rows at a time through a server-side cursor
+  instead of all at once. The first page is shown right away and the next
+  is read when the user scrolls to the end of the list. Sorting or
+  exporting the list reads all of the remaining rows. 0, the default,
+  turns paging off. Use this for open-ended displays that can return more
+  rows than anyone will look at. Paging needs setFillInThread(true).
+*/
+void display::setFillPageSize(int rows)
+{
+  _data->_fillPageSize = rows > 0 ? rows : 0;
+}
+
+int display::fillPageSize() const
+{
+  return _data->_fillPageSize;
+}
+
 void display::sNew()
 {
 }
@@ -735,6 +849,26 @@ void display::sFillList()
 
 void display::sFillList(ParameterList pParams, bool forceSetParams)
 {
+  if (_data->_fillWaiting)      // run again once the current fill returns
+  {
+    _data->_fillAgain       = true;
+    _data->_fillAgainParams = pParams;
+    _data->_fillAgainForce  = forceSetParams;
+    return;
+  }
+
+  // a merge needs every row, which would defeat paging
+  bool paged = _data->_fillInThread && _data->_fillPageSize > 0;
+  XTreeWidget::PopulateStyle popstyle =
+    (_data->_refreshing && ! paged) ? XTreeWidget::Merge : XTreeWidget::Replace;
+  _data->_refreshing = false;
+
+  if (_data->_filling)          // the rest of a paged fill is replaced
+  {
+    _data->_filling = false;
+    emit fillListAfter();
+  }
+
   emit fillListBefore();
   if (forceSetParams || !pParams.count())
   {
@@ -750,16 +884,122 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
     systemError(this, errorString, __FILE__, __LINE__);
     return;
   }
-  XSqlQuery xq = mql.toQuery(pParams);
-  _data->_list->populate(xq, itemid, _data->_useAltId);
-  if (xq.lastError().type() != QSqlError::NoError)
+
+  if (! _data->_fillInThread)
+  {
+    XSqlQuery xq = mql.toQuery(pParams);
+    _data->_list->populate(xq, itemid, _data->_useAltId, popstyle);
+    if (xq.lastError().type() != QSqlError::NoError)
+    {
+      systemError(this, xq.lastError().databaseText(), __FILE__, __LINE__);
+      return;
+    }
+    emit fillListAfter();
+    return;
+  }
+
+  /* rows are added to the list as they arrive. wait here so callers
+     still find the list populated when sFillList() returns; calls made
+     while waiting, e.g. from the Query button, run once the wait is
+     over. a paged fill only waits for the first page and finishes in
+     sFillThreadFinished(). the thread and its connection are kept for
+     the next fill.
+   */
+  if (! _data->_fillThread)
+  {
+    XSqlThread *thread = new XSqlThread(this);
+    connect(thread, SIGNAL(queryFinished()), this, SLOT(sFillThreadFinished()));
+    connect(thread, SIGNAL(rowsReady(const QList<QSqlRecord> &)),
+            _data->_list, SLOT(populateRecords(const QList<QSqlRecord> &)));
+    connect(thread, SIGNAL(totalsReady(const QVariantMap &)),
+            _data->_list, SLOT(setPopulateTotals(const QVariantMap &)));
+    connect(thread, SIGNAL(pageFetched()), _data->_list, SLOT(populatePaused()));
+    connect(_data->_list, SIGNAL(populateCancelled()), thread, SLOT(cancel()));
+    connect(_data->_list, SIGNAL(moreRowsWanted()),    thread, SLOT(fetchMore()));
+    connect(_data->_list, SIGNAL(allRowsWanted()),     thread, SLOT(fetchAll()));
+    _data->_fillThread = thread;
+  }
+
+  XSqlThread *thread = _data->_fillThread;
+  thread->setQuery(mql.getSource(), pParams);
+  thread->setPageSize(_data->_fillPageSize);
+
+  _data->_filling     = true;
+  _data->_fillWaiting = true;
+  _data->_fillDone    = false;
+
+  QEventLoop loop;
+  connect(thread, SIGNAL(queryFinished()), &loop, SLOT(quit()));
+  connect(thread, SIGNAL(pageFetched()),   &loop, SLOT(quit()));
+
+  QPointer<display> self(this);
+  _data->_list->beginPopulate(itemid, _data->_useAltId, popstyle);
+  thread->runQuery();
+  loop.exec();
+  if (! self)   // deleted without being closed
+    return;
+  _data->_fillWaiting = false;
+
+  // otherwise the rest of a paged fill arrives as the user scrolls
+  if (_data->_fillDone)
+    finishFill();
+
+  if (_data->_closeWanted)
+  {
+    _data->_closeWanted = false;
+    _data->_fillAgain   = false;
+    close();
+  }
+  else if (_data->_fillAgain)
   {
-    systemError(this, xq.lastError().databaseText(), __FILE__, __LINE__);
+    _data->_fillAgain = false;
+    sFillList(_data->_fillAgainParams, _data->_fillAgainForce);
+  }
+}
+
+/* tell the list it has all of its rows. fillListAfter() is emitted
+   here, once per fill, even if the fill was cancelled.
+ */
+void display::finishFill()
+{
+  _data->_filling = false;
+  _data->_list->endPopulate();
+
+  QSqlError error = _data->_fillThread->lastError();
+  if (! _data->_fillThread->isCancelled() && error.type() != QSqlError::NoError)
+  {
+    systemError(this, error.databaseText(), __FILE__, __LINE__);
     return;
   }
   emit fillListAfter();
 }
 
+/* the fill thread has finished the current query. finish a paged fill
+   here, sFillList() finishes the others itself.
+ */
+void display::sFillThreadFinished()
+{
+  if (! _data->_filling)
+    return;
+
+  _data->_fillDone = true;
+  if (! _data->_fillWaiting)
+    finishFill();
+}
+
+// stop the fill sFillList() is waiting on and close once it returns
+void display::closeEvent(QCloseEvent *event)
+{
+  if (_data->_fillWaiting)
+  {
+    _data->_closeWanted = true;
+    _data->_fillThread->cancel();
+    event->ignore();
+    return;
+  }
+  XWidget::closeEvent(event);
+}
+
 void display::sPopulateMenu(QMenu *, QTreeWidgetItem *, int)
 {
 }
@@ -767,10 +1007,57 @@ void display::sPopulateMenu(QMenu *, QTreeWidgetItem *, int)
 void display::sAutoUpdateToggled()
 {
   bool update = _data->_autoUpdateEnabled && _data->_autoupdate->isChecked();
-  if (update)
-    connect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
-  else
-    disconnect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
+
+  disconnect(omfgThis, SIGNAL(tick()), this, SLOT(sAutoUpdateTick()));
+  disconnect(omfgThis, SIGNAL(notifyHeard(const QString &)),
+             this,     SLOT(sAutoUpdateNotified(const QString &)));
+  _data->_autoUpdateTimer->stop();
+
+  if (! update)
+    return;
+
+  for (int i = 0; i < _data->_autoUpdateChannels.size(); i++)
+    omfgThis->setUpListener(_data->_autoUpdateChannels.at(i));
+  if (! _data->_autoUpdateChannels.isEmpty())
+    connect(omfgThis, SIGNAL(notifyHeard(const QString &)),
+            this,     SLOT(sAutoUpdateNotified(const QString &)));
+  connect(omfgThis, SIGNAL(tick()), this, SLOT(sAutoUpdateTick()));
+}
+
+/* refresh the list in place, changing only the rows that differ from the
+   last time it was filled
+*/
+void display::sAutoUpdate()
+{
+  if (_data->_filling)          // try again once the current fill is done
+  {
+    _data->_autoUpdateTimer->start();
+    return;
+  }
+
+  _data->_autoUpdateTicks = 0;
+  _data->_refreshing = true;
+  sFillList();
+  _data->_refreshing = false;
+}
+
+void display::sAutoUpdateNotified(const QString &note)
+{
+  if (! _data->_autoUpdateChannels.contains(note))
+    return;
+
+  _data->_autoUpdateHeard.insert(note);
+  _data->_autoUpdateTimer->start();
+}
+
+void display::sAutoUpdateTick()
+{
+  bool allHeard = ! _data->_autoUpdateChannels.isEmpty();
+  for (int i = 0; allHeard && i < _data->_autoUpdateChannels.size(); i++)
+    allHeard = _data->_autoUpdateHeard.contains(_data->_autoUpdateChannels.at(i));
+
+  if (! allHeard || ++_data->_autoUpdateTicks >= AUTOUPDATETICKS)
+    sAutoUpdate();
 }
 
 ParameterList display::getParams()
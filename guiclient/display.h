@@ -55,6 +55,13 @@ public:
 
     Q_INVOKABLE void setAutoUpdateEnabled(bool);
     Q_INVOKABLE bool autoUpdateEnabled() const;
+    Q_INVOKABLE void setAutoUpdateChannels(const QStringList &);
+    Q_INVOKABLE QStringList autoUpdateChannels() const;
+
+    Q_INVOKABLE void setFillInThread(bool);
+    Q_INVOKABLE bool fillInThread() const;
+    Q_INVOKABLE void setFillPageSize(int);
+    Q_INVOKABLE int  fillPageSize() const;
 
     Q_INVOKABLE XTreeWidget * list();
     Q_INVOKABLE ParameterWidget * parameterWidget();
@@ -87,10 +94,15 @@ public slots:
 protected:
     Q_INVOKABLE ParameterList getParams();
     virtual void showEvent(QShowEvent*);
+    virtual void closeEvent(QCloseEvent*);
 
 protected slots:
     virtual void languageChange();
     virtual void sAutoUpdateToggled();
+    virtual void sAutoUpdate();
+    virtual void sAutoUpdateNotified(const QString &);
+    virtual void sAutoUpdateTick();
+    virtual void sFillThreadFinished();
 
 signals:
     void fillList();
@@ -98,6 +110,8 @@ signals:
     void fillListAfter();
 
 private:
+    void finishFill();
+
     displayPrivate * _data;
 };
 
@@ -38,6 +38,7 @@ dspInventoryAvailabilityByCustomerType::dspInventoryAvailabilityByCustomerType(Q
   setMetaSQLOptions("inventoryAvailability", "byCustOrSO");
   setUseAltId(true);
   setAutoUpdateEnabled(true);
+  setAutoUpdateChannels(QStringList() << "itemsite" << "coitem" << "wo" << "womatl" << "poitem");
 
   _custtype->setType(ParameterGroup::CustomerType);
 
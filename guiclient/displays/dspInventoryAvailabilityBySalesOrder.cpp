@@ -36,6 +36,7 @@ dspInventoryAvailabilityBySalesOrder::dspInventoryAvailabilityBySalesOrder(QWidg
   setMetaSQLOptions("inventoryAvailability", "byCustOrSO");
   setUseAltId(true);
   setAutoUpdateEnabled(true);
+  setAutoUpdateChannels(QStringList() << "itemsite" << "coitem" << "wo" << "womatl" << "poitem");
 
   _so->setAllowedTypes(OrderLineEdit::Sales);
   _so->setAllowedStatuses(OrderLineEdit::Open);
@@ -82,6 +82,7 @@ dspInventoryHistory::dspInventoryHistory(QWidget* parent, const char* name, Qt::
   parameterWidget()->applyDefaultFilterSet();
 
   list()->setRootIsDecorated(true);
+  list()->setColumnStore(true);
   list()->addColumn(tr("Transaction Time"),_timeDateColumn, Qt::AlignLeft,  true, "invhist_transdate");
   list()->addColumn(tr("Created Time"),    _timeDateColumn, Qt::AlignLeft,  false, "invhist_created");
   list()->addColumn(tr("Site"),                 _whsColumn, Qt::AlignCenter,true, "warehous_code");
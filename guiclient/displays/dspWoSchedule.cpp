@@ -43,6 +43,7 @@ dspWoSchedule::dspWoSchedule(QWidget* parent, const char*, Qt::WFlags fl)
   setMetaSQLOptions("workOrderSchedule", "detail");
   setUseAltId(true);
   setAutoUpdateEnabled(true);
+  setAutoUpdateChannels(QStringList() << "wo");
   setParameterWidgetVisible(true);
   setQueryOnStartEnabled(true);
 
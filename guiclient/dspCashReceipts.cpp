@@ -32,6 +32,8 @@ dspCashReceipts::dspCashReceipts(QWidget* parent, const char*, Qt::WFlags fl)
   setNewVisible(true);
   setUseAltId(true);
   setParameterWidgetVisible(true);
+  setFillInThread(true);
+  setFillPageSize(500);
   
   QString qryType = QString("SELECT  1, '%1' UNION "
                             "SELECT  2, '%2' UNION "
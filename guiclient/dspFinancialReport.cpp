@@ -11,6 +11,7 @@
 #include "dspFinancialReport.h"
 
 #include <QAction>
+#include <QApplication>
 #include <QCloseEvent>
 #include <QInputDialog>
 #include <QList>
@@ -26,6 +27,7 @@
 #include <orprerender.h>
 #include <previewdialog.h>
 #include <orprintrender.h>
+#include <xsqlthread.h>
 #include "dspFinancialReport.h"
 #include "dspGLTransactions.h"
 #include "financialReportNotes.h"
@@ -43,6 +45,8 @@
 #define cBudget   4
 #define cDiff     5
 
+#define MAXREPORTTHREADS 4
+
 dspFinancialReport::dspFinancialReport(QWidget* parent, const char*, Qt::WFlags fl)
   : display(parent, "dspFinancialReport", fl)
 {
@@ -567,8 +571,6 @@ void dspFinancialReport::sFillListTrend()
   list()->setColumnCount(0);
   list()->addColumn( tr("Group\n  Account Name"), -1, Qt::AlignLeft, true, "name");
 
-  dspFillListTrend.prepare("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;");
-
   QString q1c = QString("SELECT -1, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
                         "       :group AS type, flgrp_id AS id,"
                         "       flgrp_name AS name");
@@ -794,14 +796,11 @@ void dspFinancialReport::sFillListTrend()
     q4w += QString(" AND (r%1.flrpt_interval='%2')").arg(c).arg(interval);
     if(c > 0)
       q4w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
-
-    dspFillListTrend.bindValue(":flhead_id", _flhead->id());
-    dspFillListTrend.bindValue(":period_id", periodsRef.at(c));
-    dspFillListTrend.bindValue(":interval", interval);
-    dspFillListTrend.bindValue(":prjid", _prjid);
-    dspFillListTrend.exec();
   }
 
+  if (! updateReportData(periodsRef, interval))
+    return;
+
   //Grand Total for Trend Reports
   if ((_trend->isChecked()) && ((_typeCode == "I") || (_typeCode == "C")))
   {
@@ -861,6 +860,76 @@ void dspFinancialReport::sFillListTrend()
   list()->expandAll();
 }
 
+/* financialReport() fills flrpt for one period at a time. flrpt is keyed
+   only by flhead, period, interval, and user, not by project, and trialbal
+   can change without new gltrans rows, so every fill recalculates all of
+   the periods shown. They are calculated at the same time on separate
+   connections.
+ */
+bool dspFinancialReport::updateReportData(const QList<int> &periods,
+                                          const QString &interval)
+{
+  QString sql("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;");
+  if (periods.size() == 1)
+  {
+    XSqlQuery rptq;
+    rptq.prepare(sql);
+    rptq.bindValue(":flhead_id", _flhead->id());
+    rptq.bindValue(":period_id", periods.first());
+    rptq.bindValue(":interval",  interval);
+    rptq.bindValue(":prjid",     _prjid);
+    rptq.exec();
+    if (rptq.lastError().type() != QSqlError::NoError)
+    {
+      systemError(this, rptq.lastError().databaseText(), __FILE__, __LINE__);
+      return false;
+    }
+  }
+  else
+  {
+    for (int start = 0; start < periods.size(); start += MAXREPORTTHREADS)
+    {
+      message(tr("Calculating %1 of %2 periods...")
+                .arg(qMin(start + MAXREPORTTHREADS, periods.size())).arg(periods.size()));
+
+      QList<XSqlThread*> threads;
+      for (int i = start; i < periods.size() && i < start + MAXREPORTTHREADS; i++)
+      {
+        ParameterList bindings;
+        bindings.append("flhead_id", _flhead->id());
+        bindings.append("period_id", periods.at(i));
+        bindings.append("interval",  interval);
+        bindings.append("prjid",     _prjid);
+
+        XSqlThread *thread = new XSqlThread(this);
+        thread->setSql(sql, bindings);
+        thread->start();
+        threads.append(thread);
+      }
+
+      QSqlError error;
+      for (int i = 0; i < threads.size(); i++)
+      {
+        while (! threads.at(i)->wait(50))
+          qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        if (threads.at(i)->lastError().type() != QSqlError::NoError)
+          error = threads.at(i)->lastError();
+      }
+      qDeleteAll(threads);
+
+      if (error.type() != QSqlError::NoError)
+      {
+        message("");
+        systemError(this, error.databaseText(), __FILE__, __LINE__);
+        return false;
+      }
+    }
+    message("");
+  }
+
+  return true;
+}
+
 void dspFinancialReport::sFillPeriods()
 {
   if ((!_trend->isChecked()) || (_month->isChecked()))
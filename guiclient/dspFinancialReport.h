@@ -62,6 +62,7 @@ protected slots:
 
 protected:
     virtual bool forwardUpdate();
+    virtual bool updateReportData(const QList<int> &periods, const QString &interval);
     Q_INVOKABLE ParameterList getParams();
     
 private:
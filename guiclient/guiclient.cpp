@@ -29,6 +29,7 @@
 #include <QApplication>
 #include <QCursor>
 #include <QDir>
+#include <QFileInfo>
 #include <QSqlError>
 #include <QPixmap>
 #include <QFrame>
@@ -42,6 +43,7 @@
 #include <QBuffer>
 #include <QDesktopServices>
 #include <QScriptEngineDebugger>
+#include <QThread>
 
 #include <parameter.h>
 #include <dbtools.h>
@@ -49,6 +51,8 @@
 #include <xvariant.h>
 
 #include "xtsettings.h"
+#include "imagecache.h"
+#include "documenttransfer.h"
 #include "xuiloader.h"
 #include "guiclient.h"
 #include "version.h"
@@ -73,6 +77,7 @@
 #include "idleShutdown.h"
 #include "inputManager.h"
 #include "xdoublevalidator.h"
+#include "xtextedit.h"
 
 #include "distributeInventory.h"
 #include "documents.h"
@@ -345,6 +350,9 @@ class xTupleGuiClientInterface : public GuiClientInterface
   }
 };
 
+#define SCRIPTENGINEPOOLSIZE  2
+#define SCRIPTENGINEPOOLDELAY 1500
+
 GUIClient *omfgThis;
 GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
 {
@@ -353,6 +361,13 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   _activeWindow = 0;
   _shown = false;
   _shuttingDown = false;
+  _useScriptEnginePool = true;
+  _timeWindowOpen = false;
+
+  _scriptEnginePoolTimer = new QTimer(this);
+  _scriptEnginePoolTimer->setSingleShot(true);
+  _scriptEnginePoolTimer->setInterval(SCRIPTENGINEPOOLDELAY);
+  connect(_scriptEnginePoolTimer, SIGNAL(timeout()), this, SLOT(sFillScriptEnginePool()));
 
   _databaseURL = pDatabaseURL;
   _username = pUsername;
@@ -458,18 +473,9 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
 
   if (_preferences->value("BackgroundImageid").toInt() > 0)
   {
-    _GGUIClient.prepare( "SELECT image_data "
-                "FROM image "
-                "WHERE (image_id=:image_id);" );
-    _GGUIClient.bindValue(":image_id", _preferences->value("BackgroundImageid").toInt());
-    _GGUIClient.exec();
-    if (_GGUIClient.first())
-    {
-      QImage background;
-
-      background.loadFromData(QUUDecode(_GGUIClient.value("image_data").toString()));
+    QImage background = ImageCache::instance()->image(_preferences->value("BackgroundImageid").toInt());
+    if (! background.isNull())
       _workspace->setBackground(QBrush(QPixmap::fromImage(background)));
-    }
   }
 
   _splash->showMessage(tr("Initializing Internal Timers"), SplashTextAlignment, SplashTextColor);
@@ -499,6 +505,17 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   XTextEdit::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
   XTextEditHighlighter::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
 
+  XComboBoxCache *lookupCache = XComboBoxCache::instance();
+  connect(this, SIGNAL(bankAccountsUpdated()),     lookupCache, SLOT(sBankAccountsUpdated()));
+  connect(this, SIGNAL(contractsUpdated(int, bool)), lookupCache, SLOT(sContractsUpdated()));
+  connect(this, SIGNAL(itemGroupsUpdated(int, bool)), lookupCache, SLOT(sItemGroupsUpdated()));
+  connect(this, SIGNAL(projectsUpdated(int)),      lookupCache, SLOT(sProjectsUpdated()));
+  connect(this, SIGNAL(reportsChanged(int, bool)), lookupCache, SLOT(sReportsChanged()));
+  connect(this, SIGNAL(salesRepUpdated(int)),      lookupCache, SLOT(sSalesRepUpdated()));
+  connect(this, SIGNAL(standardPeriodsUpdated()),  lookupCache, SLOT(sStandardPeriodsUpdated()));
+  connect(this, SIGNAL(taxAuthsUpdated(int)),      lookupCache, SLOT(sTaxAuthsUpdated()));
+  connect(this, SIGNAL(userUpdated(QString)),      lookupCache, SLOT(sUserUpdated()));
+
   _splash->showMessage(tr("Completing Initialization"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
   _splash->finish(this);
@@ -795,6 +812,10 @@ void GUIClient::closeEvent(QCloseEvent *event)
 
   _shuttingDown = true;
 
+  // finish saving documents before their temporary files go away
+  foreach (DocumentTransfer *upload, _documentUploads)
+    upload->wait();
+
   // Remove any temporary document files being watched
   QMapIterator<QString, int> i(_fileMap);
   while (i.hasNext())
@@ -888,6 +909,9 @@ void GUIClient::showEvent(QShowEvent *event)
         }
       }
     // END script code
+
+    if (_useScriptEnginePool)
+      _scriptEnginePoolTimer->start();
   }
 
   QMainWindow::showEvent(event);
@@ -1900,6 +1924,49 @@ QScriptValue distributeInventorySeriesAdjust(QScriptContext *context,
   return engine->toScriptValue(result);
 }
 
+/* Hand out a script engine with the globals already loaded. The pool is
+   refilled one engine at a time once the client has been left alone for
+   SCRIPTENGINEPOOLDELAY msec; every take pushes the refill back, so the
+   cost of loadScriptGlobals is not paid while a window is still opening
+   and painting. Engines are never returned to the pool: each window's
+   scripts get a global object nobody else has touched.
+   Start the client with -scriptEnginePool=no to compare window open times
+   (see -timeWindowOpen) without the pool.
+*/
+QScriptEngine *GUIClient::takeScriptEngine(QObject *parent)
+{
+  QScriptEngine *engine = 0;
+  if (_scriptEnginePool.isEmpty())
+  {
+    engine = new QScriptEngine(parent);
+    loadScriptGlobals(engine);
+  }
+  else
+  {
+    engine = _scriptEnginePool.takeFirst();
+    engine->setParent(parent);
+  }
+
+  if (_useScriptEnginePool && ! _shuttingDown)
+    _scriptEnginePoolTimer->start();
+
+  return engine;
+}
+
+void GUIClient::sFillScriptEnginePool()
+{
+  if (! _useScriptEnginePool || _shuttingDown ||
+      _scriptEnginePool.size() >= SCRIPTENGINEPOOLSIZE)
+    return;
+
+  QScriptEngine *engine = new QScriptEngine(this);
+  loadScriptGlobals(engine);
+  _scriptEnginePool.append(engine);
+
+  if (_scriptEnginePool.size() < SCRIPTENGINEPOOLSIZE)
+    _scriptEnginePoolTimer->start();
+}
+
 void GUIClient::loadScriptGlobals(QScriptEngine * engine)
 {
   if(!engine)
@@ -2090,7 +2157,6 @@ bool GUIClient::removeDocumentWatch(QString path)
 
 void GUIClient::handleDocument(QString path)
 {
-  QByteArray  bytarr;
   QFile sourceFile(path);
   bool opened = false;
 
@@ -2115,21 +2181,83 @@ void GUIClient::handleDocument(QString path)
     return;
   }
 
+  sourceFile.close();
   int id = _fileMap.value(path);
 
-  bytarr = sourceFile.readAll();
-  XSqlQuery qry;
-  qry.prepare( "UPDATE url SET url_stream = :stream "
-               "WHERE (url_id = :id);" );
-  qry.bindValue(":id", id);
-  qry.bindValue(":stream", bytarr);
-  qry.exec();
+  // a newer save replaces an upload still in progress for the same document
+  DocumentTransfer *upload = _documentUploads.take(id);
+  if (upload)
+  {
+    upload->cancel();
+    upload->wait();
+    upload->deleteLater();
+  }
+
+  upload = new DocumentTransfer(this);
+  upload->setUpload(id, path);
+  connect(upload, SIGNAL(finished()), this, SLOT(sDocumentUploaded()));
+  _documentUploads.insert(id, upload);
+  statusBar()->showMessage(tr("Saving %1 to the database...")
+                             .arg(QFileInfo(path).fileName()));
+  upload->start();
+
   addDocumentWatch(path, id);
 }
 
+void GUIClient::sDocumentUploaded()
+{
+  DocumentTransfer *upload = qobject_cast<DocumentTransfer*>(sender());
+  if (! upload || _documentUploads.value(upload->urlId()) != upload)
+    return;
+
+  _documentUploads.remove(upload->urlId());
+  if (upload->lastError().type() != QSqlError::NoError)
+    qWarning("File %s could not be saved to the database: %s",
+             qPrintable(upload->fileName()),
+             qPrintable(upload->lastError().text()));
+  statusBar()->clearMessage();
+  upload->deleteLater();
+}
+
+#define SPELLCACHESIZE 10000
+
+/* Loading a large dictionary takes long enough to slow down startup, so
+   Hunspell is built on a worker thread and handed to the GUI thread when
+   it's done. Spell checking stays off until then.
+*/
+class SpellCheckerLoader : public QThread
+{
+  public:
+    SpellCheckerLoader(const QString &aff, const QString &dic,
+                       const QString &userdic, QObject *parent)
+      : QThread(parent),
+        _aff(aff),
+        _dic(dic),
+        _userdic(userdic),
+        _checker(0)
+    {
+    }
+
+    QString   _aff;
+    QString   _dic;
+    QString   _userdic;
+    Hunspell *_checker;
+
+  protected:
+    void run()
+    {
+      _checker = new Hunspell(_aff.toLatin1(), _dic.toLatin1());
+      if (! _userdic.isEmpty())
+        _checker->add_dic(_userdic.toLatin1());
+    }
+};
+
 void GUIClient::hunspell_initialize()
 {
     _spellReady = false;
+    _spellChecker = 0;
+    _spellCodec = 0;
+    _spellVerdicts.setMaxCost(SPELLCACHESIZE);
     QString langName = QLocale::languageToString(QLocale().language());
     QString appPath("/usr/lib/postbooks");
     if (! QFile::exists(appPath))
@@ -2145,31 +2273,55 @@ void GUIClient::hunspell_initialize()
       affFile.setFileName(fullPathWithoutExt + tr(".aff"));
       dicFile.setFileName(fullPathWithoutExt + tr(".dic"));
     }
-    if(affFile.exists() && dicFile.exists())
+
+    QString homePath = QDir::homePath().toLatin1();
+    QString userdic;
+    if(affFile.exists() && dicFile.exists() &&
+       QFile::exists(homePath + tr("/xTuple/user.dic")))
     {
-      _spellReady = true;
+       //open user dictionary if exists
+       userdic = homePath + tr("/xTuple/user.dic");
     }
-    _spellChecker = new Hunspell(QString(fullPathWithoutExt+tr(".aff")).toLatin1(),
-                                 QString(fullPathWithoutExt+tr(".dic")).toLatin1());
+
+    _spellLoader = new SpellCheckerLoader(fullPathWithoutExt + tr(".aff"),
+                                          fullPathWithoutExt + tr(".dic"),
+                                          userdic, this);
+    connect(_spellLoader, SIGNAL(finished()), this, SLOT(sSpellCheckerLoaded()));
+    if(affFile.exists() && dicFile.exists())
+      _spellLoader->start(QThread::LowPriority);
+}
+
+void GUIClient::sSpellCheckerLoaded()
+{
+    if (! _spellLoader || _spellLoader->isRunning())
+      return;
+
+    _spellChecker = _spellLoader->_checker;
+    _spellLoader->deleteLater();
+    _spellLoader = 0;
+    if (! _spellChecker)
+      return;
 
     QString spell_encoding = QString(_spellChecker->get_dic_encoding());
     _spellCodec = QTextCodec::codecForName(spell_encoding.toLocal8Bit());
+    _spellReady = (_spellCodec != 0);
 
-    QString homePath = QDir::homePath().toLatin1();
-    if(_spellReady)
-    {
-        QFile file(homePath + tr("/xTuple/user.dic"));
-        if(file.exists(homePath + tr("/xTuple/user.dic")))
-        {
-           //open user dictionary if exists
-           _spellChecker->add_dic(QString(homePath + tr("/xTuple/user.dic")).toLatin1());
-        }
-    }
+    // underline the text already on screen
+    if (_spellReady)
+      XTextEdit::rehighlightAll();
 }
 
 void GUIClient::hunspell_uninitialize()
 {
+    if (_spellLoader)
+    {
+      _spellLoader->wait();
+      _spellChecker = _spellLoader->_checker;
+      delete _spellLoader;
+      _spellLoader = 0;
+    }
     delete (Hunspell *)(_spellChecker);
+    _spellChecker = 0;
     QString homePath = QDir::homePath().toLatin1();
     QFile file(homePath + tr("/xTuple/user.dic"));
 
@@ -2220,16 +2372,31 @@ bool GUIClient::hunspell_ready()
        return _spellReady;
 }
 
+/* hunspell_check() runs for every word the highlighters see, so remember
+   the most recently checked words. add and ignore change the verdict.
+*/
 int GUIClient::hunspell_check(const QString word)
 {
+      if (! _spellReady)
+        return 1;
+
+      int *verdict = _spellVerdicts.object(word);
+      if (verdict)
+        return *verdict;
+
       QByteArray encodedString = _spellCodec->fromUnicode(word);
-      return _spellChecker->spell(encodedString.data());
+      int result = _spellChecker->spell(encodedString.data());
+      _spellVerdicts.insert(word, new int(result));
+      return result;
 }
 
 const QStringList GUIClient::hunspell_suggest(const QString word)
 {
     char **wlst;
     QStringList wordList;
+    if (! _spellReady)
+      return wordList;
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     if(_spellChecker->spell(encodedString.data()) < 1)
     {
@@ -2246,27 +2413,40 @@ const QStringList GUIClient::hunspell_suggest(const QString word)
 
 int GUIClient::hunspell_add(const QString word)
 {
+    if (! _spellReady)
+      return 0;
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
     //check if word has been added before
     if(!_spellAddWords.contains(encodedString.data()))
         _spellAddWords.append(encodedString.data());
+    _spellVerdicts.remove(word);
     return _spellChecker->add(encodedString.data());
 }
 
 int GUIClient::hunspell_ignore(const QString word)
 {
+    if (! _spellReady)
+      return 0;
+
     QByteArray encodedString = _spellCodec->fromUnicode(word);
+    _spellVerdicts.remove(word);
     return _spellChecker->add(encodedString.data());
 }
 
 
+/* several windows may listen for the same note. subscribe once and
+   connect once so each note is only heard once.
+*/
 void GUIClient::setUpListener(const QString &note)
 {
     if(QSqlDatabase::database().isOpen())
     {
-        QSqlDatabase::database().driver()->subscribeToNotification(note);
-        QObject::connect(QSqlDatabase::database().driver(), SIGNAL(notification(const QString&)),
-                this, SLOT(sEmitNotifyHeard(const QString &)));
+        QSqlDriver *driver = QSqlDatabase::database().driver();
+        if (! driver->subscribedToNotifications().contains(note))
+          driver->subscribeToNotification(note);
+        QObject::connect(driver, SIGNAL(notification(const QString&)),
+                this, SLOT(sEmitNotifyHeard(const QString &)), Qt::UniqueConnection);
     }
 }
 
@@ -2276,4 +2456,6 @@ void GUIClient::sEmitNotifyHeard(const QString &note)
         QMessageBox::information(this, "asdf", "test note received");
     else if(note == "messagePosted")
         emit messageNotify();
+
+    emit notifyHeard(note);
 }
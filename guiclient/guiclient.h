@@ -17,8 +17,10 @@
 #include <QMdiArea>
 #include <QTimer>
 #include <QAction>
+#include <QCache>
 #include <QCloseEvent>
 #include <QFileSystemWatcher>
+#include <QHash>
 #include <QList>
 #include <QPixmap>
 #include <QMenu>
@@ -36,6 +38,8 @@ class QIntValidator;
 class QDoubleValidator;
 class QCheckBox;
 class QScriptEngine;
+class DocumentTransfer;
+class SpellCheckerLoader;
 
 class menuProducts;
 class menuInventory;
@@ -231,11 +235,15 @@ class GUIClient : public QMainWindow
 
     QString _singleWindow;
 
+    bool _useScriptEnginePool;
+    bool _timeWindowOpen;
+
     Q_INVOKABLE        void  launchBrowser(QWidget*, const QString &);
     Q_INVOKABLE     QWidget *myActiveWindow();
     Q_INVOKABLE inline bool  shuttingDown() { return _shuttingDown; }
 
     void loadScriptGlobals(QScriptEngine * engine);
+    QScriptEngine *takeScriptEngine(QObject *parent);
 
     //check hunspell is ready
     Q_INVOKABLE bool hunspell_ready();
@@ -313,6 +321,7 @@ class GUIClient : public QMainWindow
     void tick();
 
     void messageNotify();
+    void notifyHeard(const QString &);
 
     void assortmentsUpdated(int, bool);
     void bankAccountsUpdated();
@@ -372,8 +381,11 @@ class GUIClient : public QMainWindow
 
   private slots:
     void handleDocument(QString path);
+    void sDocumentUploaded();
+    void sSpellCheckerLoaded();
     void hunspell_initialize();
     void hunspell_uninitialize();
+    void sFillScriptEnginePool();
 
   private:
     QMdiArea   *_workspace;
@@ -427,12 +439,18 @@ class GUIClient : public QMainWindow
     bool _shown;
     bool _shuttingDown;
 
+    QList<QScriptEngine*> _scriptEnginePool;
+    QTimer               *_scriptEnginePoolTimer;
+
     QFileSystemWatcher* _fileWatcher;
     QMap<QString, int> _fileMap;
+    QHash<int, DocumentTransfer*> _documentUploads;
     QTextCodec * _spellCodec;
     Hunspell * _spellChecker;
+    SpellCheckerLoader *_spellLoader;
     bool _spellReady;
     QStringList _spellAddWords;
+    QCache<QString, int> _spellVerdicts;
 };
 extern GUIClient *omfgThis;
 
@@ -36,7 +36,7 @@ win32-msvc* {
 
 QMAKE_LIBDIR = ../lib $${OPENRPT_LIBDIR} $$QMAKE_LIBDIR
 LIBS        += -lxtuplecommon -lxtuplewidgets -lwrtembed -lopenrptcommon
-LIBS        += -lrenderer -lxtuplescriptapi $${DMTXLIB} -lMetaSQL
+LIBS        += -lrenderer -lxtuplescriptapi $${DMTXLIB} -lMetaSQL $${PGSQLLIB}
 
 #not the best way to handle this, but it should do
 mac:!static:contains(QT_CONFIG, qt_framework) {
@@ -743,6 +743,7 @@ HEADERS = ../common/format.h                    \
           creditMemo.h                          \
           creditMemoEditList.h                  \
           creditMemoItem.h                      \
+          creditcardgateway.h                   \
           creditcardprocessor.h                 \
           crmaccount.h                          \
           crmaccountMerge.h                     \
@@ -1353,6 +1354,7 @@ SOURCES = absoluteCalendarItem.cpp              \
           creditMemo.cpp                        \
           creditMemoEditList.cpp                \
           creditMemoItem.cpp                    \
+          creditcardgateway.cpp                 \
           creditcardprocessor.cpp               \
           crmaccount.cpp                        \
           crmaccountMerge.cpp                   \
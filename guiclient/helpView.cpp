@@ -22,7 +22,7 @@
 
 #include <QDebug>
 
-#include <quuencode.h>
+#include "imagecache.h"
 
 #include "guiclient.h"
 #include "helpView.h"
@@ -31,15 +31,9 @@
 
 static QIcon iconFromImageByName(QString name)
 {
-  QImage    image;
-  XSqlQuery imageq;
-  imageq.prepare("SELECT image_data FROM image WHERE image_name=:name LIMIT 1;");
-  imageq.bindValue(":name", name);
-  if (imageq.exec() && imageq.first())
-  {
-    image.loadFromData(QUUDecode(imageq.value("image_data").toString()));
+  QImage image = ImageCache::instance()->image(name);
+  if (! image.isNull())
     return QIcon(QPixmap::fromImage(image));
-  }
   return QIcon();
 }
 
@@ -19,6 +19,8 @@
 #include <QScrollArea>
 #include <quuencode.h>
 
+#include "imagecache.h"
+
 image::image(QWidget* parent, const char* name, bool modal, Qt::WFlags fl)
     : XDialog(parent, name, modal, fl)
 {
@@ -173,6 +175,7 @@ void image::sSave()
   }
 
   newImage.exec();
+  ImageCache::notifyChanged();
 
   done(_imageid);
 }
@@ -16,6 +16,7 @@
 #include <parameter.h>
 
 #include "image.h"
+#include "imagecache.h"
 #include "guiclient.h"
 
 images::images(QWidget* parent, const char* name, Qt::WFlags fl)
@@ -95,6 +96,7 @@ void images::sDelete()
              "WHERE (image_id=:image_id);" );
   imagesDelete.bindValue(":image_id", _image->id());
   imagesDelete.exec();
+  ImageCache::notifyChanged();
   if (imagesDelete.lastError().type() != QSqlError::NoError)
   {
     systemError(this, imagesDelete.lastError().databaseText(), __FILE__, __LINE__);
@@ -12,7 +12,7 @@
 
 #include <QVariant>
 #include <QImage>
-#include <quuencode.h>
+#include "imagecache.h"
 
 itemImages::itemImages(QWidget* parent, const char* name, Qt::WFlags fl)
   : XWidget(parent, name, fl)
@@ -68,7 +68,7 @@ void itemImages::sNext()
 
 void itemImages::sFillList()
 {
-  _images.prepare( "SELECT imageass_id, image_data, image_descrip,"
+  _images.prepare( "SELECT imageass_id, image_id, image_descrip,"
                    "       CASE WHEN (imageass_purpose='I') THEN :inventoryDescription"
                    "            WHEN (imageass_purpose='P') THEN :productDescription"
                    "            WHEN (imageass_purpose='E') THEN :engineeringReference"
@@ -104,8 +104,7 @@ void itemImages::loadImage()
 
   _description->setText(_images.value("purpose").toString() + " - " + _images.value("image_descrip").toString());
 
-  QImage image;
-  image.loadFromData(QUUDecode(_images.value("image_data").toString()));
+  QImage image = ImageCache::instance()->image(_images.value("image_id").toInt());
   _image->setPixmap(QPixmap::fromImage(image));
 }
 
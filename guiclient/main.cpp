@@ -162,6 +162,8 @@ int main(int argc, char *argv[])
   bool    _enhancedAuth   = false;
   bool    havePasswd      = false;
   bool    forceWelcomeStub= false;
+  bool    scriptEnginePool= true;
+  bool    timeWindowOpen  = false;
 
   qInstallMsgHandler(xTupleMessageOutput);
   QApplication app(argc, argv);
@@ -218,6 +220,13 @@ int main(int argc, char *argv[])
       }
       else if (argument.contains("-forceWelcomeStub", Qt::CaseInsensitive))
         forceWelcomeStub = true;
+      else if (argument.contains("-scriptEnginePool", Qt::CaseInsensitive))
+      {
+        if(argument.contains("=no", Qt::CaseInsensitive) || argument.contains("=false", Qt::CaseInsensitive))
+          scriptEnginePool = false;
+      }
+      else if (argument.contains("-timeWindowOpen", Qt::CaseInsensitive))
+        timeWindowOpen = true;
     }
   }
 
@@ -721,6 +730,8 @@ int main(int argc, char *argv[])
   omfgThis = 0;
   omfgThis = new GUIClient(databaseURL, username);
   omfgThis->_key = key;
+  omfgThis->_useScriptEnginePool = scriptEnginePool;
+  omfgThis->_timeWindowOpen = timeWindowOpen;
 
   if (key.length() > 0) {
 	_splash->showMessage(QObject::tr("Loading Database Encryption Metrics"), SplashTextAlignment, SplashTextColor);
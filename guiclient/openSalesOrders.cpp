@@ -37,6 +37,7 @@ openSalesOrders::openSalesOrders(QWidget* parent, const char*, Qt::WFlags fl)
   setNewVisible(true);
   setQueryOnStartEnabled(true);
   setAutoUpdateEnabled(true);
+  setAutoUpdateChannels(QStringList() << "cohead" << "coitem");
 
   _custid = -1;
   optionsWidget()->hide();
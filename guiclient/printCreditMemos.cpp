@@ -54,6 +54,15 @@ printCreditMemos::printCreditMemos(QWidget* parent, const char* name, bool modal
               
   _postFunction = "postCreditMemo";
   _postQuery    = "SELECT postCreditMemo(<? value('docid') ?>, 0) AS result;" ;
+  _postBatchQuery = "SELECT cmhead_id AS docid,"
+                    "       postCreditMemo(cmhead_id, 0) AS result"
+                    "  FROM cmhead"
+                    " WHERE cmhead_id IN ("
+                    "<? foreach('docids') ?>"
+                    "  <? if not isfirst('docids') ?>, <? endif ?>"
+                    "  <? value('docids') ?>"
+                    "<? endforeach ?>"
+                    ") ORDER BY cmhead_id;" ;
 
   connect(this, SIGNAL(finishedWithAll()), this, SLOT(sHandleFinishedWithAll()));
 }
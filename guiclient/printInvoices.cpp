@@ -57,10 +57,28 @@ printInvoices::printInvoices(QWidget *parent, const char *name, bool modal, Qt::
               
   _postFunction = "postInvoice";
   _postQuery    = "SELECT postInvoice(<? value('docid') ?>) AS result;" ;
+  _postBatchQuery = "SELECT invchead_id AS docid,"
+                    "       postInvoice(invchead_id) AS result"
+                    "  FROM invchead"
+                    " WHERE invchead_id IN ("
+                    "<? foreach('docids') ?>"
+                    "  <? if not isfirst('docids') ?>, <? endif ?>"
+                    "  <? value('docids') ?>"
+                    "<? endforeach ?>"
+                    ") ORDER BY invchead_id;" ;
 
   _askBeforePostingQry = "SELECT invoiceTotal(<? value('docid') ?>) = 0 AS ask;" ;
   _askBeforePostingMsg = tr("<p>Invoice %1 has a total value of 0.<br/>"
                             "Would you like to post it anyway?</p>");
+  _askBeforePostingBatchQry = "SELECT invchead_id AS docid,"
+                              "       invoiceTotal(invchead_id) = 0 AS ask"
+                              "  FROM invchead"
+                              " WHERE invchead_id IN ("
+                              "<? foreach('docids') ?>"
+                              "  <? if not isfirst('docids') ?>, <? endif ?>"
+                              "  <? value('docids') ?>"
+                              "<? endforeach ?>"
+                              ") ORDER BY invchead_id;" ;
 
   _errCheckBeforePostingQry =
          "SELECT EXISTS(SELECT *"
@@ -70,6 +88,19 @@ printInvoices::printInvoices(QWidget *parent, const char *name, bool modal, Qt::
          "                 AND  (invchead_id=<? value('docid') ?>))) AS ok;" ;
   _errCheckBeforePostingMsg =
           tr("Could not post Invoice %1 because of a missing exchange rate.");
+  _errCheckBeforePostingBatchQry =
+         "SELECT invchead_id AS docid,"
+         "       EXISTS(SELECT *"
+         "                FROM curr_rate"
+         "               WHERE ((curr_id=invchead_curr_id)"
+         "                 AND  (invchead_invcdate BETWEEN curr_effective AND curr_expires))) AS ok"
+         "  FROM invchead"
+         " WHERE invchead_id IN ("
+         "<? foreach('docids') ?>"
+         "  <? if not isfirst('docids') ?>, <? endif ?>"
+         "  <? value('docids') ?>"
+         "<? endforeach ?>"
+         ");" ;
 
   connect(this, SIGNAL(aboutToStart(XSqlQuery*)), this, SLOT(sHandleAboutToStart(XSqlQuery*)));
   connect(this, SIGNAL(finishedWithAll()),        this, SLOT(sHandleFinishedWithAll()));
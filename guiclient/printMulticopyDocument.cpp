@@ -10,18 +10,27 @@
 
 #include "printMulticopyDocument.h"
 
+#include <QDomDocument>
+#include <QHash>
 #include <QMessageBox>
+#include <QPainter>
+#include <QPrintDialog>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QVariant>
 
 #include <metasql.h>
 #include <openreports.h>
+#include <orprerender.h>
+#include <orprintrender.h>
+#include <renderobjects.h>
 
 #include "distributeInventory.h"
 #include "errorReporter.h"
 #include "storedProcErrorLookup.h"
 
+#define POSTCHUNKSIZE 100
+
 class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
 {
   public:
@@ -33,7 +42,9 @@ class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
       _parent(parent),
       _postPrivilege(postPrivilege),
       _printer(0),
-      _mpIsInitialized(false)
+      _mpIsInitialized(false),
+      _painter(0),
+      _batchPosting(false)
     {
       setupUi(_parent);
 
@@ -44,6 +55,7 @@ class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
 
     ~printMulticopyDocumentPrivate()
     {
+      endPrinting();
       if (_printer)
       {
         delete _printer;
@@ -62,6 +74,95 @@ class printMulticopyDocumentPrivate : public Ui::printMulticopyDocument
     bool                      _mpIsInitialized;
     QList<QVariant>           _printed;
     QString                   _reportKey;
+    QPainter                 *_painter;
+    QHash<QString, QDomDocument> _reportDefs;
+    QHash<QString, bool>      _watermarkOnly;
+    bool                      _batchPosting;
+    QList<QVariant>           _postQueue;
+    QHash<int, QString>       _postDocnumbers;
+
+    /* parse each report definition once per print run */
+    bool reportDefinition(const QString &reportname, QDomDocument &def)
+    {
+      if (_reportDefs.contains(reportname))
+      {
+        def = _reportDefs.value(reportname);
+        return ! def.isNull();
+      }
+
+      XSqlQuery reportq;
+      reportq.prepare("SELECT report_source "
+                      "  FROM report "
+                      " WHERE (report_name=:report_name) "
+                      "ORDER BY report_grade DESC LIMIT 1;");
+      reportq.bindValue(":report_name", reportname);
+      reportq.exec();
+      if (reportq.first())
+      {
+        QString errorMessage;
+        int     errorLine;
+        if (! def.setContent(reportq.value("report_source").toString(),
+                             &errorMessage, &errorLine))
+        {
+          qWarning("Could not parse report %s, line %d: %s",
+                   qPrintable(reportname), errorLine, qPrintable(errorMessage));
+          def = QDomDocument();
+        }
+      }
+      else
+        def = QDomDocument();
+
+      _reportDefs.insert(reportname, def);
+      _watermarkOnly.insert(reportname,
+                            def.elementsByTagName("watermark").count() > 0);
+      return ! def.isNull();
+    }
+
+    /* start the print job on the first document, using its page setup,
+       and keep painting into it until endPrinting()
+     */
+    bool beginPrinting(ORODocument *doc, bool &userCanceled)
+    {
+      userCanceled = false;
+      if (_painter)
+      {
+        _printer->newPage();
+        return true;
+      }
+
+      ORPrintRender render;
+      render.setupPrinter(doc, _printer);
+      if (! _mpIsInitialized)
+      {
+        QPrintDialog pd(_printer, _parent);
+        pd.setMinMax(1, doc->pages());
+        if (pd.exec() != QDialog::Accepted)
+        {
+          userCanceled = true;
+          return false;
+        }
+      }
+
+      _painter = new QPainter();
+      if (! _painter->begin(_printer))
+      {
+        delete _painter;
+        _painter = 0;
+        return false;
+      }
+      _mpIsInitialized = true;
+      return true;
+    }
+
+    void endPrinting()
+    {
+      if (_painter)
+      {
+        _painter->end();
+        delete _painter;
+        _painter = 0;
+      }
+    }
 };
 
 printMulticopyDocument::printMulticopyDocument(QWidget    *parent,
@@ -120,7 +221,7 @@ printMulticopyDocument::~printMulticopyDocument()
 {
   if (_data->_captive)
   {
-    orReport::endMultiPrint(_data->_printer);
+    _data->endPrinting();
   }
 
   if (_data)
@@ -217,6 +318,15 @@ bool printMulticopyDocument::sPostOneDoc(XSqlQuery *docq)
       ! docq->value("posted").toBool())
   {
     QString docnumber = docq->value("docnumber").toString();
+
+    // sPrint() posts everything queued here in sPostQueued()
+    if (_data->_batchPosting)
+    {
+      _data->_postQueue.append(docq->value("docid"));
+      _data->_postDocnumbers.insert(docq->value("docid").toInt(), docnumber);
+      return true;
+    }
+
     message(tr("Posting %1 #%2").arg(_data->_doctypefull, docnumber));
 
     ParameterList postp;
@@ -257,50 +367,236 @@ bool printMulticopyDocument::sPostOneDoc(XSqlQuery *docq)
       }
     }
 
-    //TODO: find a way to do this without holding locks during user input
-    XSqlQuery("BEGIN;");
+    return postOneDoc(docq->value("docid").toInt(), docnumber);
+  }
+
+  return true;
+}
+
+bool printMulticopyDocument::postOneDoc(int docid, QString docnumber)
+{
+  ParameterList postp;
+  postp.append("docid",     docid);
+  postp.append("docnumber", docnumber);
+
+  //TODO: find a way to do this without holding locks during user input
+  XSqlQuery("BEGIN;");
+
+  XSqlQuery rollback;
+  rollback.prepare("ROLLBACK;");
+
+  MetaSQLQuery postm(_postQuery);
+  XSqlQuery postq = postm.toQuery(postp);
+  if (postq.first())
+  {
+    int result = postq.value("result").toInt();
+    if (result < 0)
+    {
+      rollback.exec();
+      ErrorReporter::error(QtCriticalMsg, this,
+                           tr("Cannot Post %1").arg(docnumber),
+                           storedProcErrorLookup(_postFunction, result),
+                           __FILE__, __LINE__);
+      return false;
+    }
+    if (_distributeInventory &&
+        (distributeInventory::SeriesAdjust(result, this) == XDialog::Rejected))
+    {
+      rollback.exec();
+      QMessageBox::information(this, tr("Posting Canceled"),
+                               tr("Transaction Canceled") );
+      return false;
+    }
+  }
+  else if (postq.lastError().type() != QSqlError::NoError)
+  {
+    rollback.exec();
+    ErrorReporter::error(QtCriticalMsg, this,
+                         tr("Cannot Post %1").arg(docnumber),
+                         postq, __FILE__, __LINE__);
+    return false;
+  }
+
+  XSqlQuery("COMMIT;");
+
+  emit posted(docid);
+
+  return true;
+}
 
-    XSqlQuery rollback;
-    rollback.prepare("ROLLBACK;");
+/* Post every document queued by sPostOneDoc() during sPrint(). The checks
+   run once for the whole list and the documents are posted
+   POSTCHUNKSIZE at a time, each chunk in a single statement and
+   transaction. A chunk that fails is rolled back and posted again one
+   document at a time so each failure is reported against its own
+   document. If the user cancels a distribution, posting stops there.
+*/
+bool printMulticopyDocument::sPostQueued()
+{
+  QList<QVariant>     docids     = _data->_postQueue;
+  QHash<int, QString> docnumbers = _data->_postDocnumbers;
+  _data->_postQueue.clear();
+  _data->_postDocnumbers.clear();
 
-    MetaSQLQuery postm(_postQuery);
-    XSqlQuery postq = postm.toQuery(postp);
-    if (postq.first())
+  if (docids.isEmpty())
+    return true;
+
+  if (! _askBeforePostingBatchQry.isEmpty())
+  {
+    ParameterList askp;
+    askp.append("docids", QVariant(docids));
+    MetaSQLQuery askm(_askBeforePostingBatchQry);
+    XSqlQuery askq = askm.toQuery(askp);
+    while (askq.next())
     {
-      int result = postq.value("result").toInt();
-      if (result < 0)
+      QVariant docid = askq.value("docid");
+      if (askq.value("ask").toBool() &&
+          QMessageBox::question(this, tr("Post Anyway?"),
+                                _askBeforePostingMsg.arg(docnumbers.value(docid.toInt())),
+                                QMessageBox::Yes,
+                                QMessageBox::No | QMessageBox::Default)
+            == QMessageBox::No)
+        docids.removeAll(docid);
+    }
+    if (ErrorReporter::error(QtCriticalMsg, this,
+                             tr("Cannot Post %1").arg(_data->_doctypefull),
+                             askq, __FILE__, __LINE__))
+      return false;
+  }
+
+  if (! _errCheckBeforePostingBatchQry.isEmpty() && ! docids.isEmpty())
+  {
+    ParameterList errp;
+    errp.append("docids", QVariant(docids));
+    MetaSQLQuery errm(_errCheckBeforePostingBatchQry);
+    XSqlQuery errq = errm.toQuery(errp);
+    QList<QVariant> checked;
+    while (errq.next())
+    {
+      if (errq.value("ok").toBool())
+        checked.append(errq.value("docid"));
+    }
+    if (ErrorReporter::error(QtCriticalMsg, this,
+                             tr("Cannot Post %1").arg(_data->_doctypefull),
+                             errq, __FILE__, __LINE__))
+      return false;
+
+    for (int i = docids.size() - 1; i >= 0; i--)
+    {
+      if (! checked.contains(docids.at(i)))
       {
-        rollback.exec();
+        QString docnumber = docnumbers.value(docids.at(i).toInt());
         ErrorReporter::error(QtCriticalMsg, this,
                              tr("Cannot Post %1").arg(docnumber),
-                             storedProcErrorLookup(_postFunction, result),
+                             _errCheckBeforePostingMsg.arg(docnumber),
                              __FILE__, __LINE__);
-        return false;
+        docids.removeAt(i);
       }
-      if (_distributeInventory &&
-          (distributeInventory::SeriesAdjust(result, this) == XDialog::Rejected))
+    }
+  }
+
+  bool allPosted = true;
+  for (int start = 0; start < docids.size(); start += POSTCHUNKSIZE)
+  {
+    QList<QVariant> chunk = docids.mid(start, POSTCHUNKSIZE);
+    message(tr("Posting %1 %2 to %3 of %4")
+              .arg(_data->_doctypefull).arg(start + 1)
+              .arg(start + chunk.size()).arg(docids.size()));
+
+    ChunkResult result = postChunk(chunk);
+    if (result == ChunkPosted)
+      continue;
+    else if (result == ChunkCanceled)
+    {
+      message("");
+      QMessageBox::information(this, tr("Posting Canceled"),
+                               tr("Transaction Canceled") );
+      return false;
+    }
+
+    for (int i = 0; i < chunk.size(); i++)
+    {
+      int docid = chunk.at(i).toInt();
+      message(tr("Posting %1 #%2").arg(_data->_doctypefull,
+                                       docnumbers.value(docid)));
+      if (! postOneDoc(docid, docnumbers.value(docid)))
+        allPosted = false;
+    }
+  }
+  message("");
+
+  return allPosted;
+}
+
+/* Try to post a list of documents in one transaction. Returns
+   ChunkFailed with nothing posted if any of them could not be posted
+   cleanly, or ChunkCanceled if the user canceled a distribution.
+*/
+printMulticopyDocument::ChunkResult printMulticopyDocument::postChunk(const QList<QVariant> &docids)
+{
+  XSqlQuery("BEGIN;");
+
+  XSqlQuery rollback;
+  rollback.prepare("ROLLBACK;");
+
+  ParameterList postp;
+  postp.append("docids", QVariant(docids));
+  MetaSQLQuery postm(_postBatchQuery);
+  XSqlQuery postq = postm.toQuery(postp);
+
+  QList<QVariant> postedIds;
+  QList<QVariant> series;
+  while (postq.next())
+  {
+    if (postq.value("result").toInt() < 0)
+    {
+      rollback.exec();
+      return ChunkFailed;
+    }
+    postedIds.append(postq.value("docid"));
+    series.append(postq.value("result"));
+  }
+  if (postq.lastError().type() != QSqlError::NoError ||
+      postedIds.size() != docids.size())
+  {
+    rollback.exec();
+    return ChunkFailed;
+  }
+
+  if (_distributeInventory)
+  {
+    // only visit the series that actually left something to distribute
+    XSqlQuery distq;
+    distq.prepare("SELECT DISTINCT itemlocdist_series"
+                  "  FROM itemlocdist"
+                  " WHERE itemlocdist_series = ANY (:series);");
+    QStringList serieslist;
+    for (int i = 0; i < series.size(); i++)
+      serieslist.append(series.at(i).toString());
+    distq.bindValue(":series", "{" + serieslist.join(",") + "}");
+    distq.exec();
+    while (distq.next())
+    {
+      if (distributeInventory::SeriesAdjust(distq.value("itemlocdist_series").toInt(),
+                                            this) == XDialog::Rejected)
       {
         rollback.exec();
-        QMessageBox::information(this, tr("Posting Canceled"),
-                                 tr("Transaction Canceled") );
-        return false;
+        return ChunkCanceled;
       }
     }
-    else if (postq.lastError().type() != QSqlError::NoError)
+    if (distq.lastError().type() != QSqlError::NoError)
     {
       rollback.exec();
-      ErrorReporter::error(QtCriticalMsg, this,
-                           tr("Cannot Post %1").arg(docnumber),
-                           postq, __FILE__, __LINE__);
-      return false;
+      return ChunkFailed;
     }
+  }
 
-    XSqlQuery("COMMIT;");
+  XSqlQuery("COMMIT;");
 
-    emit posted(_data->_docid);
-  }
+  for (int i = 0; i < postedIds.size(); i++)
+    emit posted(postedIds.at(i).toInt());
 
-  return true;
+  return ChunkPosted;
 }
 
 void printMulticopyDocument::sPrint()
@@ -311,6 +607,16 @@ void printMulticopyDocument::sPrint()
   bool mpStartedInitialized = _data->_mpIsInitialized;
 
   _data->_printed.clear();
+  _data->_reportDefs.clear();
+  _data->_watermarkOnly.clear();
+
+  _data->_postQueue.clear();
+  _data->_postDocnumbers.clear();
+  _data->_batchPosting = ! _postBatchQuery.isEmpty() &&
+                         (_askBeforePostingQry.isEmpty() ||
+                          ! _askBeforePostingBatchQry.isEmpty()) &&
+                         (_errCheckBeforePostingQry.isEmpty() ||
+                          ! _errCheckBeforePostingBatchQry.isEmpty());
 
   MetaSQLQuery  docinfom(_docinfoQueryString);
   ParameterList alldocsp = getParamsDocList();
@@ -329,10 +635,13 @@ void printMulticopyDocument::sPrint()
     message("");
   }
 
+  _data->_batchPosting = false;
+  sPostQueued();
+
 //  if (! mpStartedInitialized)
   if (!_data->_captive)
   {
-    orReport::endMultiPrint(_data->_printer);
+    _data->endPrinting();
     _data->_mpIsInitialized = false;
   }
 
@@ -368,37 +677,76 @@ void printMulticopyDocument::sPrint()
     return;
 }
 
+/* Copies usually differ only by watermark, so the document is rendered
+   once per distinct set of the other parameters and every copy is
+   printed from that rendering. When the form uses the watermark
+   parameter only for the page watermark, it is rendered as a marker
+   and replaced on the finished pages copy by copy.
+*/
+#define WATERMARKMARKER "\x01xtuple-watermark\x01"
+
+static bool markerInText(ORODocument *doc)
+{
+  for (int page = 0; page < doc->pages(); page++)
+  {
+    OROPage *orpage = doc->page(page);
+    for (int i = 0; i < orpage->primitives(); i++)
+    {
+      OROTextBox *text = dynamic_cast<OROTextBox*>(orpage->primitive(i));
+      if (text && text->text().contains(WATERMARKMARKER))
+        return true;
+    }
+  }
+  return false;
+}
+
 bool printMulticopyDocument::sPrintOneDoc(XSqlQuery *docq)
 {
   QString reportname = docq->value("reportname").toString();
   QString docnumber  = docq->value("docnumber").toString();
   bool    printedOk  = false;
 
-  if (! _data->_mpIsInitialized)
+  QDomDocument def;
+  if (! _data->reportDefinition(reportname, def))
   {
-    bool userCanceled = false;
-    if (orReport::beginMultiPrint(_data->_printer, userCanceled) == false)
-    {
-      if(!userCanceled)
-        systemError(this, tr("Could not initialize printing system for multiple reports."));
-      return false;
-    }
-  }
-
-  orReport report(reportname);
-  if (! report.isValid())
     QMessageBox::critical(this, tr("Cannot Find Form"),
                           tr("<p>Cannot find form '%1' for %2 %3. "
                              "It cannot be printed until the Form "
                              "Assignment is updated to remove references "
                              "to this Form or the Form is created.")
                            .arg(reportname, _data->_doctypefull, docnumber));
-  else
+    return false;
+  }
+
+  QHash<QString, ORODocument*> rendered;
+  for (int i = 0; i < _data->_copies->numCopies(); i++)
   {
-    for (int i = 0; i < _data->_copies->numCopies(); i++)
+    bool deferWatermark = _data->_watermarkOnly.value(reportname);
+    ParameterList copyp = getParamsOneCopy(i, docq);
+    ParameterList renderp;
+    QStringList   key;
+    QString       watermark;
+    for (int p = 0; p < copyp.count(); p++)
+    {
+      if (deferWatermark && copyp.name(p) == "watermark")
+        watermark = copyp.value(p).toString();
+      else
+      {
+        renderp.append(copyp.name(p), copyp.value(p));
+        key.append(copyp.name(p) + "=" + copyp.value(p).toString());
+      }
+    }
+    if (deferWatermark)
+      renderp.append("watermark", QString(WATERMARKMARKER));
+
+    ORODocument *doc = rendered.value(key.join("\n"));
+    if (! doc)
     {
-      report.setParamList(getParamsOneCopy(i, docq));
-      if (! report.isValid())
+      ORPreRender pre;
+      pre.setDom(def);
+      pre.setParamList(renderp);
+      doc = pre.generate();
+      if (! doc)
       {
         ErrorReporter::error(QtCriticalMsg, this, tr("Invalid Parameters"),
                              tr("<p>Report '%1' cannot be run. Parameters "
@@ -407,19 +755,54 @@ bool printMulticopyDocument::sPrintOneDoc(XSqlQuery *docq)
         printedOk = false;
         continue;
       }
-      else if (report.print(_data->_printer, ! _data->_mpIsInitialized))
-      {
-        _data->_mpIsInitialized = true;
-        printedOk = true;
-      }
-      else
+      else if (deferWatermark && markerInText(doc))
       {
-        report.reportError(this);
-        printedOk = false;
+        // the form prints the watermark in a field, too; render each copy
+        delete doc;
+        _data->_watermarkOnly.insert(reportname, false);
+        i--;
         continue;
       }
+      rendered.insert(key.join("\n"), doc);
     }
+
+    QStringList marked;
+    for (int page = 0; deferWatermark && page < doc->pages(); page++)
+    {
+      OROPage *orpage = doc->page(page);
+      marked.append(orpage->watermarkText());
+      orpage->setWatermarkText(QString(marked.last())
+                                       .replace(WATERMARKMARKER, watermark));
+    }
+
+    bool userCanceled = false;
+    if (! _data->beginPrinting(doc, userCanceled))
+    {
+      if (! userCanceled)
+        systemError(this, tr("Could not initialize printing system for multiple reports."));
+      printedOk = false;
+      break;
+    }
+
+    ORPrintRender render;
+    render.setPrinter(_data->_printer);
+    render.setPainter(_data->_painter);
+    if (render.render(doc))
+      printedOk = true;
+    else
+    {
+      ErrorReporter::error(QtCriticalMsg, this, tr("Cannot Print"),
+                           tr("<p>Could not print %1 %2 on %3.")
+                             .arg(_data->_doctypefull, docnumber,
+                                  _data->_printer->printerName()),
+                           __FILE__, __LINE__);
+      printedOk = false;
+    }
+
+    for (int page = 0; page < marked.size(); page++)
+      doc->page(page)->setWatermarkText(marked.at(page));
   }
+  qDeleteAll(rendered);
 
   if (printedOk)
     emit finishedPrinting(docq->value("docid").toInt());
@@ -70,6 +70,7 @@ class printMulticopyDocument : public XDialog
     virtual void    sAddToPrintedList(XSqlQuery *docq);
     virtual bool    sMarkOnePrinted(XSqlQuery *docq);
     virtual bool    sPostOneDoc(XSqlQuery  *docq);
+    virtual bool    sPostQueued();
     virtual void    sPrint();
     virtual bool    sPrintOneDoc(XSqlQuery *docq);
     virtual void    setDoctype(QString doctype);
@@ -103,6 +104,13 @@ class printMulticopyDocument : public XDialog
     QString _markOnePrintedQry;
     QString _postFunction;
     QString _postQuery;
+    QString _postBatchQuery;
+    QString _askBeforePostingBatchQry;
+    QString _errCheckBeforePostingBatchQry;
+
+    enum ChunkResult { ChunkPosted, ChunkCanceled, ChunkFailed };
+    virtual ChunkResult postChunk(const QList<QVariant> &docids);
+    virtual bool postOneDoc(int docid, QString docnumber);
 
   private:
 };
@@ -347,6 +347,8 @@ enum SetResponse salesOrderItem:: set(const ParameterList &pParams)
   QVariant  param;
   bool      valid;
 
+  _priceCache.clear();
+
   _prev->setEnabled(true);
   _next->setEnabled(true);
   _next->setText(tr("Next"));
@@ -839,6 +841,8 @@ void salesOrderItem::prepare()
 
 void salesOrderItem::clear()
 {
+  _priceCache.clear();
+
   if (_supplyOrderId > -1)
   {
     disconnect(_woIndentedList,    SIGNAL(populateMenu(QMenu*,QTreeWidgetItem*,int)), this, SLOT(sPopulateWoMenu(QMenu*, QTreeWidgetItem*)));
@@ -1605,7 +1609,6 @@ void salesOrderItem::sDeterminePrice()
 
 void salesOrderItem::sDeterminePrice(bool force)
 {
-  XSqlQuery salesDeterminePrice;
   // Determine if we can or should update the price
   if ( _mode == cView ||
        _mode == cViewQuote ||
@@ -1660,72 +1663,91 @@ void salesOrderItem::sDeterminePrice(bool force)
         _updatePrice = false;
     }
   }
-  // Go get the new price information
-  // For configured items, update characteristic pricing
-  if ( _item->isConfigured() )
+  // Go get the new price information, for the item and every
+  // characteristic of a configured item in the same query
+  QStringList key;
+  key << QString::number(_item->id()) << QString::number(_custid)
+      << QString::number(_shiptoid)   << _qtyOrdered->text()
+      << QString::number(_qtyUOM->id()) << QString::number(_priceUOM->id())
+      << QString::number(_customerPrice->id())
+      << _customerPrice->effective().toString(Qt::ISODate)
+      << asOf.toString(Qt::ISODate)   << QString::number(_warehouse->id());
+
+  int charCount = _item->isConfigured() ? _itemchar->rowCount() : 0;
+  QString charprices;
+  for (int i = 0; i < charCount; i++)
   {
-    disconnect(_itemchar, SIGNAL(itemChanged(QStandardItem *)), this, SLOT(sRecalcPrice()));
-    _charVars.replace(QTY, _qtyOrdered->toDouble() * _qtyinvuomratio);
-
-    QModelIndex idx1, idx2, idx3;
-    salesDeterminePrice.prepare("SELECT itemcharprice(:item_id,:char_id,:value,:cust_id,:shipto_id,:qty,:curr_id,:effective,:asof)::numeric(16,4) AS price;");
+    charprices += QString(", itemcharprice(:item_id, :char_id%1, :value%1, :cust_id,"
+                          " :shipto_id, :charqty, :curr_id, :effective,"
+                          " :asof)::numeric(16,4) AS charprice%1").arg(i);
+    key << _itemchar->data(_itemchar->index(i, CHAR_ID), Qt::UserRole).toString()
+        << _itemchar->data(_itemchar->index(i, CHAR_VALUE), Qt::DisplayRole).toString();
+  }
 
-    for (int i = 0; i < _itemchar->rowCount(); i++)
+  Price result;
+  bool found = _priceCache.contains(key.join("\t"));
+  if (found)
+    result = _priceCache.value(key.join("\t"));
+  else
+  {
+    XSqlQuery itemprice;
+    itemprice.prepare( "SELECT *" + charprices + " FROM "
+                       "itemIpsPrice(:item_id, :cust_id, :shipto_id, :qty, :qtyUOM, :priceUOM,"
+                       "             :curr_id, :effective, :asof, :warehouse);" );
+    itemprice.bindValue(":cust_id", _custid);
+    itemprice.bindValue(":shipto_id", _shiptoid);
+    itemprice.bindValue(":qty", _qtyOrdered->toDouble());
+    itemprice.bindValue(":charqty", _qtyOrdered->toDouble() * _qtyinvuomratio);
+    itemprice.bindValue(":qtyUOM", _qtyUOM->id());
+    itemprice.bindValue(":priceUOM", _priceUOM->id());
+    itemprice.bindValue(":item_id", _item->id());
+    itemprice.bindValue(":curr_id", _customerPrice->id());
+    itemprice.bindValue(":effective", _customerPrice->effective());
+    itemprice.bindValue(":asof", asOf);
+    itemprice.bindValue(":warehouse", _warehouse->id());
+    for (int i = 0; i < charCount; i++)
     {
-      idx1 = _itemchar->index(i, CHAR_ID);
-      idx2 = _itemchar->index(i, CHAR_VALUE);
-      idx3 = _itemchar->index(i, CHAR_PRICE);
-      salesDeterminePrice.bindValue(":item_id", _item->id());
-      salesDeterminePrice.bindValue(":char_id", _itemchar->data(idx1, Qt::UserRole));
-      salesDeterminePrice.bindValue(":value", _itemchar->data(idx2, Qt::DisplayRole));
-      salesDeterminePrice.bindValue(":cust_id", _custid);
-      salesDeterminePrice.bindValue(":shipto_id", _shiptoid);
-      salesDeterminePrice.bindValue(":qty", _qtyOrdered->toDouble() * _qtyinvuomratio);
-      salesDeterminePrice.bindValue(":curr_id", _customerPrice->id());
-      salesDeterminePrice.bindValue(":effective", _customerPrice->effective());
-      salesDeterminePrice.bindValue(":asof", asOf);
-      salesDeterminePrice.exec();
-      if (salesDeterminePrice.first())
-      {
-        _itemchar->setData(idx3, salesDeterminePrice.value("price").toString(), Qt::DisplayRole);
-        _itemchar->setData(idx3, QVariant(_charVars), Qt::UserRole);
-      }
-      else if (salesDeterminePrice.lastError().type() != QSqlError::NoError)
-      {
-        systemError(this, salesDeterminePrice.lastError().databaseText(), __FILE__, __LINE__);
-        return;
-      }
+      itemprice.bindValue(QString(":char_id%1").arg(i),
+                          _itemchar->data(_itemchar->index(i, CHAR_ID), Qt::UserRole));
+      itemprice.bindValue(QString(":value%1").arg(i),
+                          _itemchar->data(_itemchar->index(i, CHAR_VALUE), Qt::DisplayRole));
     }
-    connect(_itemchar, SIGNAL(itemChanged(QStandardItem *)), this, SLOT(sRecalcPrice()));
+    itemprice.exec();
+    if (itemprice.first())
+    {
+      found = true;
+      result.price = itemprice.value("itemprice_price").toDouble();
+      result.type  = itemprice.value("itemprice_type").toString();
+      for (int i = 0; i < charCount; i++)
+        result.charPrices << itemprice.value(QString("charprice%1").arg(i)).toString();
+      _priceCache.insert(key.join("\t"), result);
+    }
+    else if (itemprice.lastError().type() != QSqlError::NoError)
+    {
+      systemError(this, itemprice.lastError().databaseText(), __FILE__, __LINE__);
+      return;
+    }
+  }
 
-    // Total up price for configured item characteristics
-    QModelIndex idx;
+  // For configured items, update characteristic pricing
+  if (found && charCount > 0)
+  {
+    disconnect(_itemchar, SIGNAL(itemChanged(QStandardItem *)), this, SLOT(sRecalcPrice()));
+    _charVars.replace(QTY, _qtyOrdered->toDouble() * _qtyinvuomratio);
 
-    for (int i = 0; i < _itemchar->rowCount(); i++)
+    for (int i = 0; i < charCount; i++)
     {
-      idx        = _itemchar->index(i, CHAR_PRICE);
-      charTotal += _itemchar->data(idx, Qt::DisplayRole).toDouble();
+      QModelIndex idx = _itemchar->index(i, CHAR_PRICE);
+      _itemchar->setData(idx, result.charPrices.at(i), Qt::DisplayRole);
+      _itemchar->setData(idx, QVariant(_charVars), Qt::UserRole);
+      charTotal += result.charPrices.at(i).toDouble();
     }
+    connect(_itemchar, SIGNAL(itemChanged(QStandardItem *)), this, SLOT(sRecalcPrice()));
   }
-  // Now get item price information
-  XSqlQuery itemprice;
-  itemprice.prepare( "SELECT * FROM "
-                     "itemIpsPrice(:item_id, :cust_id, :shipto_id, :qty, :qtyUOM, :priceUOM,"
-                     "             :curr_id, :effective, :asof, :warehouse);" );
-  itemprice.bindValue(":cust_id", _custid);
-  itemprice.bindValue(":shipto_id", _shiptoid);
-  itemprice.bindValue(":qty", _qtyOrdered->toDouble());
-  itemprice.bindValue(":qtyUOM", _qtyUOM->id());
-  itemprice.bindValue(":priceUOM", _priceUOM->id());
-  itemprice.bindValue(":item_id", _item->id());
-  itemprice.bindValue(":curr_id", _customerPrice->id());
-  itemprice.bindValue(":effective", _customerPrice->effective());
-  itemprice.bindValue(":asof", asOf);
-  itemprice.bindValue(":warehouse", _warehouse->id());
-  itemprice.exec();
-  if (itemprice.first())
+
+  if (found)
   {
-    if (itemprice.value("itemprice_price").toDouble() == -9999.0)
+    if (result.price == -9999.0)
     {
       if (!_updatePrice)
       {
@@ -1759,8 +1781,8 @@ void salesOrderItem::sDeterminePrice(bool force)
     }
     else
     {
-      double price = itemprice.value("itemprice_price").toDouble();
-      _priceType = itemprice.value("itemprice_type").toString();
+      double price = result.price;
+      _priceType = result.type;
       if (_priceType == "N" || _priceType == "D" || _priceType == "P")  // nominal, discount, or list price
         _priceMode = "D";
       else  // markup or list cost
@@ -1777,8 +1799,6 @@ void salesOrderItem::sDeterminePrice(bool force)
       _scheduledDateCache = _scheduledDate->date();
     }
   }
-  else if (itemprice.lastError().type() != QSqlError::NoError)
-            systemError(this, itemprice.lastError().databaseText(), __FILE__, __LINE__);
 
   sCheckSupplyOrder();
 }
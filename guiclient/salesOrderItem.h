@@ -12,6 +12,7 @@
 #define SALESORDERITEM_H
 
 #include "guiclient.h"
+#include <QHash>
 #include <QStandardItemModel>
 #include "xdialog.h"
 #include <parameter.h>
@@ -141,6 +142,17 @@ class salesOrderItem : public XDialog, public Ui::salesOrderItem
     // For holding variables for characteristic pricing
     QList<QVariant> _charVars;
 
+    /* prices already looked up while this line item is being edited,
+       keyed by everything sDeterminePrice() passes to the server
+     */
+    struct Price
+    {
+      double      price;
+      QString     type;
+      QStringList charPrices;
+    };
+    QHash<QString, Price> _priceCache;
+
     enum
     {
       CHAR_ID    = 0,
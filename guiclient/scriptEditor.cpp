@@ -21,6 +21,7 @@
 #include "guiErrorCheck.h"
 #include "jsHighlighter.h"
 #include "package.h"
+#include "scriptcache.h"
 #include "storedProcErrorLookup.h"
 
 #define DEBUG false
@@ -271,6 +272,7 @@ bool scriptEditor::sSaveToDB()
     return false;
   }
 
+  ScriptCache::notifyChanged();
   _document->setModified(false);
   if (_package->id() != _pkgheadidOrig &&
       QMessageBox::question(this, tr("Move to different package?"),
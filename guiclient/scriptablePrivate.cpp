@@ -15,13 +15,16 @@
 #include <QScriptEngine>
 #include <QScriptEngineDebugger>
 
+#include "scriptcache.h"
 #include "scripttoolbox.h"
 #include "../scriptapi/qeventproto.h"
 #include "../scriptapi/parameterlistsetup.h"
 
 ScriptablePrivate::ScriptablePrivate(bool dialog, QWidget* parent)
-  : _engine(0), _debugger(0), _scriptLoaded(false), _dialog(dialog), _parent(parent)
+  : _engine(0), _debugger(0), _scriptLoaded(false), _dialog(dialog), _parent(parent),
+    _scriptMsecs(0), _shown(false)
 {
+  _openTime.start();
   ScriptToolbox::setLastWindow(parent);
 }
 
@@ -35,13 +38,12 @@ QScriptEngine *ScriptablePrivate::engine()
 {
   if(!_engine)
   {
-    _engine = new QScriptEngine(_parent);
+    _engine = omfgThis->takeScriptEngine(_parent);
     if (_preferences->boolean("EnableScriptDebug"))
     {
       _debugger = new QScriptEngineDebugger(_parent);
       _debugger->attachTo(_engine);
     }
-    omfgThis->loadScriptGlobals(_engine);
     QScriptValue mywindow = _engine->newQObject(_parent);
     _engine->globalObject().setProperty("mywindow", mywindow);
     if(_dialog)
@@ -57,19 +59,12 @@ QScriptEngine *ScriptablePrivate::engine()
 void ScriptablePrivate::loadScript(const QString& oName)
 {
   qDebug() << "Looking for a script " << oName;
-  XSqlQuery scriptq;
-  scriptq.prepare("SELECT script_source, script_order"
-            "  FROM script"
-            " WHERE((script_name=:script_name)"
-            "   AND (script_enabled))"
-            " ORDER BY script_order;");
-  scriptq.bindValue(":script_name", oName);
-  scriptq.exec();
-  while(scriptq.next())
+  QList<ScriptCache::Script> scripts = ScriptCache::instance()->scripts(oName);
+  for (int i = 0; i < scripts.size(); i++)
   {
     if(engine())
     {
-      QString script = scriptHandleIncludes(scriptq.value("script_source").toString());
+      QString script = scriptHandleIncludes(scripts.at(i).source);
       QScriptValue result = _engine->evaluate(script, _parent->objectName());
       if (_engine->hasUncaughtException())
       {
@@ -88,6 +83,9 @@ void ScriptablePrivate::loadScriptEngine()
     return;
   _scriptLoaded = true;
 
+  QTime scriptTime;
+  scriptTime.start();
+
   QStringList scriptList;
 
   // load scripts by class heirarchy name
@@ -110,8 +108,11 @@ void ScriptablePrivate::loadScriptEngine()
   }
 
   scriptList.removeDuplicates();
+  ScriptCache::instance()->prefetch(scriptList);
   for (int i = 0; i < scriptList.size(); ++i)
     loadScript(scriptList.at(i));
+
+  _scriptMsecs += scriptTime.elapsed();
 }
 
 enum SetResponse ScriptablePrivate::callSet(const ParameterList & params)
@@ -132,6 +133,13 @@ enum SetResponse ScriptablePrivate::callSet(const ParameterList & params)
 
 void ScriptablePrivate::callShowEvent(QEvent *event)
 {
+  if (! _shown && _parent && omfgThis->_timeWindowOpen)
+    qDebug() << "window" << _parent->objectName() << "opened in"
+             << _openTime.elapsed() << "msec," << _scriptMsecs
+             << "msec loading scripts, script engine pool"
+             << (omfgThis->_useScriptEnginePool ? "on" : "off");
+  _shown = true;
+
   if(_engine && (_engine->globalObject().property("showEvent").isFunction()))
   {
     QScriptValueList args;
@@ -17,6 +17,7 @@ class QScriptEngineDebugger;
 class QEvent;
 
 #include <QString>
+#include <QTime>
 
 #include "guiclient.h"
 #include "parameter.h"
@@ -43,6 +44,9 @@ class ScriptablePrivate
 
   private:
     QWidget *_parent;
+    QTime    _openTime;     // -timeWindowOpen: construction to first show
+    int      _scriptMsecs;  // -timeWindowOpen: spent in loadScriptEngine
+    bool     _shown;
 };
 
 #endif
@@ -39,6 +39,7 @@
 #include "creditCard.h"
 #include "creditcardprocessor.h"
 #include "mqlutil.h"
+#include "scriptcache.h"
 #include "storedProcErrorLookup.h"
 #include "xdialog.h"
 #include "xmainwindow.h"
@@ -1589,22 +1590,15 @@ QString scriptHandleIncludes(QString source)
           name = words.at(1);
 
         line.replace(i, "// " + line.at(i));
-        XSqlQuery inclq;
-        inclq.prepare("SELECT script_source "
-                      "FROM script "
-                      "WHERE ((script_name=:name)"
-                      "  AND  ((script_order=:order) OR (:order = -1))"
-                      "  AND  script_enabled) "
-                      "ORDER BY script_order;");
-        inclq.bindValue(":name",  name);
-        inclq.bindValue(":order", order);
-        inclq.exec();
+        QList<ScriptCache::Script> scripts = ScriptCache::instance()->scripts(name);
         bool found = false;
-        while (inclq.next())
+        for (int j = 0; j < scripts.size(); j++)
         {
+          if (order != -1 && scripts.at(j).order != order)
+            continue;
           found = true;
           line.replace(i,
-                       line.at(i) + "\n" + scriptHandleIncludes(inclq.value("script_source").toString()));
+                       line.at(i) + "\n" + scriptHandleIncludes(scripts.at(j).source));
         }
         if (found)
           line.replace(i,
@@ -10,9 +10,12 @@
 
 #include "syncCompanies.h"
 
+#include <QApplication>
 #include <QMessageBox>
 #include <QProgressDialog>
 #include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
 #include <QVariant>
 #include <QStatusBar>
 
@@ -20,6 +23,7 @@
 #include <metasql.h>
 #include <openreports.h>
 #include <currcluster.h>
+#include <xsqlthread.h>
 
 #include <QDebug>
 
@@ -28,6 +32,8 @@
 
 #define DEBUG   false
 
+#define SYNCINSERTCHUNK 500
+
 // TODO: XDialog should have a default implementation that returns FALSE
 bool syncCompanies::userHasPriv(const int pMode)
 {
@@ -122,9 +128,409 @@ void syncCompanies::sFillList()
   }
 }
 
+/* syncCompanyFetch reads everything sSync() needs from one child database
+   on its own connection, so several children can be read at the same
+   time. It checks that the child can be synchronized, then reads the
+   profit centers, subaccounts, Chart of Accounts, and the G/L summary for
+   every selected period in a handful of queries. The results are applied
+   to the parent database by syncCompanies::apply() in the GUI thread.
+ */
+class syncCompanyFetch : public XSqlThread
+{
+  public:
+    syncCompanyFetch(QObject *parent = 0)
+      : XSqlThread(parent),
+        _item(0),
+        _companyid(-1),
+        _currid(-1)
+    {
+    }
+
+    XTreeWidgetItem  *_item;
+    int               _companyid;
+    int               _currid;
+    QString           _number;
+    QString           _database;
+    QString           _dbURL;
+    QString           _username;
+    QString           _serverVersion;
+    QList<QDate>      _periodStarts;
+    QList<QDate>      _periodEnds;
+
+    QString           _errorTitle;
+    QString           _errorText;
+    QList<QSqlRecord> _prftcntr;
+    QList<QSqlRecord> _subaccnt;
+    QList<QSqlRecord> _accnt;
+    QList<QSqlRecord> _gltrans;
+
+  protected:
+    void run()
+    {
+      {
+        QSqlDatabase db = openDatabase();
+        if (db.isOpen())
+          fetch(db);
+      }
+      closeDatabase();
+    }
+
+    bool select(QSqlQuery &q, QList<QSqlRecord> &records)
+    {
+      if (! q.exec())
+      {
+        setLastError(q.lastError());
+        return false;
+      }
+      while (q.next() && ! isCancelled())
+        records.append(q.record());
+      return true;
+    }
+
+    bool problem(const QString &title, const QString &text)
+    {
+      _errorTitle = title;
+      _errorText  = text;
+      return false;
+    }
+
+    /* use QSqlQuery instead of XSqlQuery so the error listeners,
+       which update the GUI, don't get called from this thread */
+    bool fetch(QSqlDatabase db)
+    {
+      QSqlQuery rmq(db);
+      rmq.prepare("SELECT usrpriv_id "
+                  "FROM usrpriv JOIN priv ON (usrpriv_priv_id=priv_id) "
+                  "WHERE ((usrpriv_username=:username)"
+                  "  AND  (priv_name='MaintainChartOfAccounts')) "
+                  "UNION "
+                  "SELECT priv_id"
+                  "  FROM priv, grppriv, usrgrp"
+                  " WHERE((usrgrp_grp_id=grppriv_grp_id)"
+                  "   AND (grppriv_priv_id=priv_id)"
+                  "   AND (usrgrp_username=:username)"
+                  "   AND (priv_name='MaintainChartOfAccounts')) ;");
+      rmq.bindValue(":username", _username);
+      if (! rmq.exec())
+      {
+        setLastError(rmq.lastError());
+        return false;
+      }
+      else if (! rmq.first())
+        return problem(syncCompanies::tr("No Privilege"),
+                       syncCompanies::tr("You do not have permission to view or manage "
+                                         "the Chart of Accounts on the child database."));
+
+      if (! rmq.exec("SELECT fetchMetricText('ServerVersion') AS result;"))
+      {
+        setLastError(rmq.lastError());
+        return false;
+      }
+      else if (rmq.first() &&
+               rmq.value(0).toString() != _serverVersion)
+        return problem(syncCompanies::tr("Versions Incompatible"),
+                       syncCompanies::tr("<p>The version of the child database is not "
+                                         "the same as the version of the parent "
+                                         "database (%1 vs. %2). The data cannot safely "
+                                         "be synchronized.")
+                       .arg(rmq.value(0).toString(), _serverVersion));
+
+      rmq.prepare("SELECT company_id FROM company WHERE (company_number=:number);");
+      rmq.bindValue(":number", _number);
+      if (! rmq.exec())
+      {
+        setLastError(rmq.lastError());
+        return false;
+      }
+      else if (! rmq.first())
+        return problem(syncCompanies::tr("No Corresponding Company"),
+                       syncCompanies::tr("<p>The child database does not appear to have "
+                                         "a Company %1 defined. The data cannot safely "
+                                         "be synchronized.").arg(_number));
+
+      // every selected period has to exist in the child
+      rmq.prepare("SELECT period_id, period_start, period_end"
+                  "  FROM period"
+                  " WHERE (period_start BETWEEN :first AND :last);");
+      rmq.bindValue(":first", _periodStarts.first());
+      rmq.bindValue(":last",  _periodStarts.last());
+      if (! rmq.exec())
+      {
+        setLastError(rmq.lastError());
+        return false;
+      }
+      QStringList periodids;
+      QList<QDate> starts;
+      QList<QDate> ends;
+      while (rmq.next())
+      {
+        starts.append(rmq.value("period_start").toDate());
+        ends.append(rmq.value("period_end").toDate());
+        periodids.append(rmq.value("period_id").toString());
+      }
+      for (int i = 0; i < _periodStarts.size(); i++)
+      {
+        bool found = false;
+        for (int j = 0; ! found && j < starts.size(); j++)
+          found = starts.at(j) == _periodStarts.at(i) &&
+                  ends.at(j)   == _periodEnds.at(i);
+        if (! found)
+          return problem(syncCompanies::tr("No Corresponding Period"),
+                         syncCompanies::tr("<p>The child database for Company %1 (%2) "
+                                           "does not appear to have an Accounting "
+                                           "Period starting on %3 and ending on %4.")
+                         .arg(_number, _database,
+                              _periodStarts.at(i).toString(Qt::ISODate),
+                              _periodEnds.at(i).toString(Qt::ISODate)));
+      }
+
+      QSqlQuery prftq(db);
+      prftq.prepare("SELECT DISTINCT accnt_profit AS prftcntr_number, prftcntr_descrip "
+                    "FROM accnt JOIN prftcntr ON (accnt_profit=prftcntr_number) "
+                    "WHERE (accnt_company=:accnt_company);");
+      prftq.bindValue(":accnt_company", _number);
+      if (! select(prftq, _prftcntr))
+        return false;
+
+      QSqlQuery subq(db);
+      subq.prepare("SELECT DISTINCT accnt_sub AS subaccnt_number, subaccnt_descrip "
+                   "FROM accnt JOIN subaccnt ON (accnt_sub=subaccnt_number) "
+                   "WHERE (accnt_company=:accnt_company);");
+      subq.bindValue(":accnt_company", _number);
+      if (! select(subq, _subaccnt))
+        return false;
+
+      QSqlQuery accntq(db);
+      accntq.prepare("SELECT accnt_number, accnt_descrip, accnt_comments,"
+                     "       accnt_profit, accnt_sub, accnt_type, accnt_extref,"
+                     "       accnt_company, accnt_forwardupdate,"
+                     "       accnt_subaccnttype_code, accnt_curr_id "
+                     "FROM accnt "
+                     "WHERE (accnt_company=:accnt_company);");
+      accntq.bindValue(":accnt_company", _number);
+      if (! select(accntq, _accnt))
+        return false;
+
+      // debits and credits are summarized separately, as before
+      QSqlQuery glq(db);
+      glq.prepare(QString("SELECT accnt_company, accnt_profit, accnt_number, accnt_sub,"
+                          "       period_start, period_end, gltrans_date, gltrans_source,"
+                          "       SUM(gltrans_amount) AS amount "
+                          "FROM gltrans "
+                          "JOIN accnt  ON (gltrans_accnt_id=accnt_id) "
+                          "JOIN period ON (gltrans_date BETWEEN period_start AND period_end) "
+                          "WHERE ((period_id IN (%1))"
+                          "  AND  (accnt_company=:accnt_company)"
+                          "  AND  (gltrans_amount != 0)"
+                          "  AND  (gltrans_posted)"
+                          "  AND  (NOT gltrans_deleted)) "
+                          "GROUP BY accnt_company, accnt_profit, accnt_number, accnt_sub,"
+                          "         period_start, period_end, gltrans_date, gltrans_source,"
+                          "         (gltrans_amount < 0);")
+                  .arg(periodids.join(",")));
+      glq.bindValue(":accnt_company", _number);
+      if (! select(glq, _gltrans))
+        return false;
+
+      return ! isCancelled();
+    }
+};
+
+/* copy records into a temporary table SYNCINSERTCHUNK rows per statement */
+static bool loadSyncTable(const QString &table, const QList<QSqlRecord> &records,
+                          QSqlError &error)
+{
+  if (records.isEmpty())
+    return true;
+
+  QStringList columns;
+  for (int c = 0; c < records.first().count(); c++)
+    columns.append(records.first().fieldName(c));
+
+  for (int start = 0; start < records.size(); start += SYNCINSERTCHUNK)
+  {
+    int end = qMin(records.size(), start + SYNCINSERTCHUNK);
+    QStringList rows;
+    for (int r = start; r < end; r++)
+    {
+      QStringList placeholders;
+      for (int c = 0; c < columns.size(); c++)
+        placeholders.append(QString(":r%1c%2").arg(r - start).arg(c));
+      rows.append("(" + placeholders.join(",") + ")");
+    }
+
+    XSqlQuery insq;
+    insq.prepare(QString("INSERT INTO %1 (%2) VALUES %3;")
+                 .arg(table, columns.join(","), rows.join(",")));
+    for (int r = start; r < end; r++)
+      for (int c = 0; c < columns.size(); c++)
+        insq.bindValue(QString(":r%1c%2").arg(r - start).arg(c),
+                       records.at(r).value(c));
+    insq.exec();
+    if (insq.lastError().type() != QSqlError::NoError)
+    {
+      error = insq.lastError();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#define SYNCACCNTKEY(a, b) \
+  "((" a ".accnt_company=" b ".accnt_company)" \
+  " AND (" a ".accnt_profit IS NOT DISTINCT FROM " b ".accnt_profit)" \
+  " AND (" a ".accnt_number=" b ".accnt_number)" \
+  " AND (" a ".accnt_sub IS NOT DISTINCT FROM " b ".accnt_sub))"
+
+/* apply what was fetched from one child. the caller holds the transaction.
+   returns false, with the failing query's error, if anything fails.
+ */
+bool syncCompanies::apply(syncCompanyFetch *fetch, int sequence, QSqlError &error)
+{
+  XSqlQuery syncq;
+  QStringList setup;
+  setup << "CREATE TEMPORARY TABLE syncprftcntr ON COMMIT DROP AS"
+           " SELECT prftcntr_number, prftcntr_descrip FROM prftcntr LIMIT 0;"
+        << "CREATE TEMPORARY TABLE syncsubaccnt ON COMMIT DROP AS"
+           " SELECT subaccnt_number, subaccnt_descrip FROM subaccnt LIMIT 0;"
+        << "CREATE TEMPORARY TABLE syncaccnt ON COMMIT DROP AS"
+           " SELECT accnt_number, accnt_descrip, accnt_comments,"
+           "        accnt_profit, accnt_sub, accnt_type, accnt_extref,"
+           "        accnt_company, accnt_forwardupdate,"
+           "        accnt_subaccnttype_code, accnt_curr_id"
+           "   FROM accnt LIMIT 0;"
+        << "CREATE TEMPORARY TABLE syncgltrans ON COMMIT DROP AS"
+           " SELECT accnt_company, accnt_profit, accnt_number, accnt_sub,"
+           "        period_start, period_end, gltrans_date, gltrans_source,"
+           "        gltrans_amount AS amount"
+           "   FROM accnt, period, gltrans LIMIT 0;";
+  for (int i = 0; i < setup.size(); i++)
+  {
+    syncq.exec(setup.at(i));
+    if (syncq.lastError().type() != QSqlError::NoError)
+    {
+      error = syncq.lastError();
+      return false;
+    }
+  }
+
+  if (! loadSyncTable("syncprftcntr", fetch->_prftcntr, error) ||
+      ! loadSyncTable("syncsubaccnt", fetch->_subaccnt, error) ||
+      ! loadSyncTable("syncaccnt",    fetch->_accnt,    error) ||
+      ! loadSyncTable("syncgltrans",  fetch->_gltrans,  error))
+    return false;
+
+  QStringList upsert;
+  // make sure that we don't fail because of missing supporting data
+  upsert << "INSERT INTO prftcntr (prftcntr_number, prftcntr_descrip)"
+           " SELECT DISTINCT ON (prftcntr_number) prftcntr_number, prftcntr_descrip"
+           "   FROM syncprftcntr"
+           "  WHERE (prftcntr_number NOT IN (SELECT prftcntr_number FROM prftcntr));"
+        << "INSERT INTO subaccnt (subaccnt_number, subaccnt_descrip)"
+           " SELECT DISTINCT ON (subaccnt_number) subaccnt_number, subaccnt_descrip"
+           "   FROM syncsubaccnt"
+           "  WHERE (subaccnt_number NOT IN (SELECT subaccnt_number FROM subaccnt));"
+        << "UPDATE accnt SET"
+           "    accnt_descrip=s.accnt_descrip,"
+           "    accnt_comments=s.accnt_comments,"
+           "    accnt_type=s.accnt_type,"
+           "    accnt_extref=s.accnt_extref,"
+           "    accnt_forwardupdate=s.accnt_forwardupdate,"
+           "    accnt_subaccnttype_code=s.accnt_subaccnttype_code,"
+           "    accnt_curr_id=s.accnt_curr_id"
+           "  FROM syncaccnt s"
+           " WHERE " SYNCACCNTKEY("accnt", "s") ";"
+        << "INSERT INTO accnt ("
+           "    accnt_id, accnt_number, accnt_descrip,"
+           "    accnt_comments, accnt_profit, accnt_sub,"
+           "    accnt_type, accnt_extref, accnt_company,"
+           "    accnt_forwardupdate,"
+           "    accnt_subaccnttype_code, accnt_curr_id)"
+           " SELECT NEXTVAL('accnt_accnt_id_seq'), s.accnt_number, s.accnt_descrip,"
+           "    s.accnt_comments, s.accnt_profit, s.accnt_sub,"
+           "    s.accnt_type, s.accnt_extref, s.accnt_company,"
+           "    s.accnt_forwardupdate,"
+           "    s.accnt_subaccnttype_code, s.accnt_curr_id"
+           "   FROM syncaccnt s"
+           "  WHERE NOT EXISTS(SELECT 1 FROM accnt a"
+           "                    WHERE " SYNCACCNTKEY("a", "s") ");";
+  for (int i = 0; i < upsert.size(); i++)
+  {
+    syncq.exec(upsert.at(i));
+    if (syncq.lastError().type() != QSqlError::NoError)
+    {
+      error = syncq.lastError();
+      return false;
+    }
+  }
+
+  // Clear old data from the earliest selected period on
+  syncq.prepare("DELETE FROM trialbal "
+                "WHERE (trialbal_period_id IN ("
+                "  SELECT period_id "
+                "  FROM period "
+                "  WHERE (period_start >= :startdate))) "
+                " AND (trialbal_accnt_id IN ("
+                "  SELECT accnt_id "
+                "  FROM accnt "
+                "  WHERE ((accnt_id=trialbal_accnt_id) "
+                "   AND (accnt_company=:company_number))));"
+                "DELETE FROM gltranssync "
+                "WHERE ((gltrans_date >= :startdate)"
+                " AND (gltranssync_company_id=:company_id));");
+  syncq.bindValue(":company_id",     fetch->_companyid);
+  syncq.bindValue(":startdate",      fetch->_periodStarts.first());
+  syncq.bindValue(":company_number", fetch->_number);
+  syncq.exec();
+  if (syncq.lastError().type() != QSqlError::NoError)
+  {
+    error = syncq.lastError();
+    return false;
+  }
+
+  syncq.prepare("INSERT INTO gltranssync ("
+                "  gltrans_exported, gltrans_created, "
+                "  gltrans_date, gltrans_sequence, "
+                "  gltrans_accnt_id, gltrans_source, "
+                "  gltrans_docnumber, gltrans_misc_id, "
+                "  gltrans_amount, gltrans_notes, "
+                "  gltrans_journalnumber, gltrans_posted, "
+                "  gltrans_doctype, gltrans_rec, "
+                "  gltrans_username, gltrans_deleted, "
+                "  gltranssync_company_id, "
+                "  gltranssync_period_id, gltranssync_curr_amount, "
+                "  gltranssync_curr_id, gltranssync_curr_rate) "
+                "SELECT false, now(), g.gltrans_date, :sequence, "
+                "  a.accnt_id, g.gltrans_source, '', -1, "
+                "  currToBase(:curr_id, g.amount, g.gltrans_date), "
+                "  :notes, -1, false, "
+                "  '', false, getEffectiveXtUser(), false, "
+                "  :company_id, p.period_id, "
+                "  g.amount, :curr_id, currRate(:curr_id, g.gltrans_date) "
+                "  FROM syncgltrans g"
+                "  JOIN accnt a  ON " SYNCACCNTKEY("a", "g")
+                "  JOIN period p ON ((p.period_start=g.period_start)"
+                "                AND (p.period_end=g.period_end))"
+                " ORDER BY g.gltrans_date, g.gltrans_source,"
+                "          formatGlAccountLong(a.accnt_id);");
+  syncq.bindValue(":sequence",   sequence);
+  syncq.bindValue(":curr_id",    fetch->_currid);
+  syncq.bindValue(":company_id", fetch->_companyid);
+  syncq.bindValue(":notes", tr("Data imported from Company %1 (%2)")
+                              .arg(fetch->_number, fetch->_database));
+  syncq.exec();
+  if (syncq.lastError().type() != QSqlError::NoError)
+  {
+    error = syncq.lastError();
+    return false;
+  }
+
+  return true;
+}
+
 void syncCompanies::sSync()
 {
-  XSqlQuery syncSync;
   if (DEBUG)
     qDebug("syncCompanies::sSync()");
 
@@ -150,7 +556,53 @@ void syncCompanies::sSync()
     return;
   }
 
+  // Loop and build manually to ensure proper order
+  QList<XTreeWidgetItem*> period;
+  for (int i = 0; i < _period->topLevelItemCount(); i++)
+  {
+    if (_period->topLevelItem(i)->isSelected())
+    {
+      bool inserted = false;
+      QDate _periodStart = _period->topLevelItem(i)->rawValue("period_start").toDate();
+      for (int j = 0; j < period.size(); j++)
+      {
+        XTreeWidgetItem *p = (XTreeWidgetItem*)(period[j]);
+        QDate periodStart = p->rawValue("period_start").toDate();
+        if (_periodStart < periodStart)
+        {
+          period.insert(j, _period->topLevelItem(i));
+          inserted = true;
+          break;
+        }
+      }
+      if (!inserted)
+        period.append(_period->topLevelItem(i));
+    }
+  }
+
+  QList<QDate> periodStarts;
+  QList<QDate> periodEnds;
+  for (int j = 0; j < period.size(); j++)
+  {
+    XTreeWidgetItem *p = (XTreeWidgetItem*)(period[j]);
+    if (p->rawValue("period_closed").toBool())
+    {
+      QMessageBox::warning(this, tr("Period Closed"),
+                           tr("Period %1 to %2 is closed and may not  "
+                              "be synchronized.")
+                           .arg(p->rawValue("period_start").toString())
+                           .arg(p->rawValue("period_end").toString())
+                           );
+      return;
+    }
+    periodStarts.append(p->rawValue("period_start").toDate());
+    periodEnds.append(p->rawValue("period_end").toDate());
+  }
+
+  /* Log in to every child first, starting to read each one as soon as
+     its login succeeds, then apply them one at a time. */
   int errorCount = 0;
+  QList<syncCompanyFetch*> fetches;
   QList<XTreeWidgetItem*> company = _company->selectedItems();
   for (int i = 0; i < company.size(); i++)
   {
@@ -227,7 +679,7 @@ void syncCompanies::sSync()
     if (DEBUG)
       qDebug("syncCompanies::sSync() dbURL before login2 = %s", qPrintable(dbURL));
 
-    progress.setLabelText(tr("Synchronizing Company %1 (%2)")
+    progress.setLabelText(tr("Logging in to Company %1 (%2)")
                                        .arg(c->rawValue("company_number").toString())
                                        .arg(dbURL));
 
@@ -257,633 +709,168 @@ void syncCompanies::sSync()
       qDebug("syncCompanies::sSync() dbURL after login2 = %s", qPrintable(dbURL));
     parseDatabaseURL(dbURL, protocol, host, db, port);
 
-    QSqlDatabase testDB = QSqlDatabase::addDatabase("QPSQL7", db);
-    testDB.setHostName(host);
-    testDB.setDatabaseName(db);
-    testDB.setUserName(newdlg.username());
-    testDB.setPassword(newdlg.password());
-    testDB.setPort(port.toInt());
-    if (testDB.open())
-    {
-      if (DEBUG)
-        qDebug("syncCompanies::sSync() opened testDB!");
+    syncCompanyFetch *fetch = new syncCompanyFetch(this);
+    fetch->_item          = c;
+    fetch->_companyid     = c->id("company_number");
+    fetch->_currid        = currid;
+    fetch->_number        = c->rawValue("company_number").toString();
+    fetch->_database      = c->rawValue("company_database").toString();
+    fetch->_dbURL         = dbURL;
+    fetch->_username      = newdlg.username();
+    fetch->_serverVersion = _metrics->value("ServerVersion");
+    fetch->_periodStarts  = periodStarts;
+    fetch->_periodEnds    = periodEnds;
+    fetch->setConnection(host, db, port.toInt(),
+                         newdlg.username(), newdlg.password());
+    fetch->start();
+    fetches.append(fetch);
+  } // for each selected company
 
-      XSqlQuery rmq(testDB);
-      rmq.prepare("SELECT usrpriv_id "
-                  "FROM usrpriv JOIN priv ON (usrpriv_priv_id=priv_id) "
-                  "WHERE ((usrpriv_username=:username)"
-                  "  AND  (priv_name='MaintainChartOfAccounts')) "
-                  "UNION "
-                  "SELECT priv_id"
-                  "  FROM priv, grppriv, usrgrp"
-                  " WHERE((usrgrp_grp_id=grppriv_grp_id)"
-                  "   AND (grppriv_priv_id=priv_id)"
-                  "   AND (usrgrp_username=:username)"
-                  "   AND (priv_name='MaintainChartOfAccounts')) ;");
-      rmq.bindValue(":username", newdlg.username());
-      rmq.exec();
-      if (rmq.first())
-        ; // good - keep going
-      else if (rmq.lastError().type() != QSqlError::NoError)
-      {
-        systemError(this, rmq.lastError().databaseText(), __FILE__, __LINE__);
-        errorCount++;
-        continue;
-      }
-      else
-      {
-        QMessageBox::warning(this, tr("No Privilege"),
-                             tr("You do not have permission to view or manage "
-                                "the Chart of Accounts on the child database."));
-        errorCount++;
-        continue;
-      }
+  progress.setLabelText(tr("Reading from %1 Companies...").arg(fetches.size()));
+  progress.setMaximum(fetches.size());
+  progress.setValue(0);
+  for (int i = 0; i < fetches.size(); i++)
+  {
+    while (! fetches.at(i)->wait(100))
+    {
+      qApp->processEvents();
+      if (progress.wasCanceled())
+        for (int j = i; j < fetches.size(); j++)
+          fetches.at(j)->cancel();
+    }
+    progress.setValue(i + 1);
+  }
 
-      rmq.prepare("SELECT fetchMetricText('ServerVersion') AS result;");
-      rmq.exec();
-      if (rmq.first())
-      {
-        if (rmq.value("result").toString() != _metrics->value("ServerVersion"))
-        {
-          QMessageBox::warning(this, tr("Versions Incompatible"),
-                               tr("<p>The version of the child database is not "
-                                  "the same as the version of the parent "
-                                  "database (%1 vs. %2). The data cannot safely "
-                                  "be synchronized.")
-                               .arg(rmq.value("result").toString())
-                               .arg(_metrics->value("ServerVersion")));
-          errorCount++;
-          continue;
-        }
-      }
-      else if (rmq.lastError().type() != QSqlError::NoError)
-      {
-        systemError(this, rmq.lastError().databaseText(), __FILE__, __LINE__);
-        continue;
-      }
+  for (int i = 0; i < fetches.size() && ! progress.wasCanceled(); i++)
+  {
+    syncCompanyFetch *fetch = fetches.at(i);
+    XTreeWidgetItem  *c     = fetch->_item;
 
-      rmq.prepare("SELECT * FROM company WHERE (company_number=:number);");
-      rmq.bindValue(":number", c->rawValue("company_number"));
-      rmq.exec();
-      if (rmq.first())
-        ; // nothing to do
-      else if (rmq.lastError().type() != QSqlError::NoError)
-      {
-        systemError(this, rmq.lastError().databaseText(), __FILE__, __LINE__);
-        errorCount++;
-        continue;
-      }
+    if (fetch->lastError().type() != QSqlError::NoError)
+    {
+      if (fetch->lastError().type() == QSqlError::ConnectionError)
+        QMessageBox::warning(this, tr("Could Not Connect"),
+                             tr("<p>Could not connect to the child database "
+                                "with these connection parameters."));
       else
-      {
-        QMessageBox::warning(this, tr("No Corresponding Company"),
-                             tr("<p>The child database does not appear to have "
-                                "a Company %1 defined. The data cannot safely "
-                                "be synchronized.")
-                             .arg(c->rawValue("company_number").toString()));
-        errorCount++;
-        continue;
-      }
-
-      // make sure that we don't fail because of missing supporting data
-      rmq.prepare("SELECT DISTINCT accnt_profit, prftcntr_descrip "
-                  "FROM accnt JOIN prftcntr ON (accnt_profit=prftcntr_number) "
-                  "WHERE (accnt_company=:accnt_company);");
-      rmq.bindValue(":accnt_company", c->rawValue("company_number"));
-      rmq.exec();
-      syncSync.prepare("SELECT * FROM prftcntr WHERE prftcntr_number=:prftcntr_number;");
-      while (rmq.next())
-      {
-        syncSync.bindValue(":prftcntr_number", rmq.value("accnt_profit"));
-        syncSync.exec();
-        if (syncSync.first())
-          ; // nothing to do
-        else if (syncSync.lastError().type() != QSqlError::NoError)
-        {
-          systemError(this, syncSync.lastError().databaseText(), __FILE__, __LINE__);
-          errorCount++;
-          // don't break/continue - do as much as we can
-        }
-        else
-        {
-          syncSync.prepare("INSERT INTO prftcntr (prftcntr_number, prftcntr_descrip)"
-                    "VALUES (:prftcntr_number, :prftcntr_descrip);");
-          syncSync.bindValue(":prftcntr_number",  rmq.value("accnt_profit"));
-          syncSync.bindValue(":prftcntr_descrip", rmq.value("prftcntr_descrip"));
-          syncSync.exec();
-          if (syncSync.lastError().type() != QSqlError::NoError)
-          {
-            systemError(this, syncSync.lastError().databaseText(), __FILE__, __LINE__);
-            errorCount++;
-            // don't break/continue - do as much as we can
-          }
-        }
-      } // next profit center
-      if (rmq.lastError().type() != QSqlError::NoError)
-      {
-	systemError(this, rmq.lastError().databaseText(), __FILE__, __LINE__);
-        errorCount++;
-	return;
-      }
-
-      rmq.prepare("SELECT DISTINCT accnt_sub "
-                  "FROM accnt JOIN subaccnt ON (accnt_sub=subaccnt_number) "
-                  "WHERE (accnt_company=:accnt_company);");
-      rmq.bindValue(":accnt_company", c->rawValue("company_number"));
-      rmq.exec();
-      syncSync.prepare("SELECT * FROM subaccnt WHERE subaccnt_number=:subaccnt_number;");
-      while (rmq.next())
-      {
-        syncSync.bindValue(":subaccnt_number", rmq.value("accnt_sub"));
-        syncSync.exec();
-        if (syncSync.first())
-          ; // nothing to do
-        else if (syncSync.lastError().type() != QSqlError::NoError)
-        {
-          systemError(this, syncSync.lastError().databaseText(), __FILE__, __LINE__);
-          errorCount++;
-          // don't break/continue - do as much as we can
-        }
-        else
-        {
-          syncSync.prepare("INSERT INTO subaccnt (subaccnt_number, subaccnt_descrip)"
-                    "VALUES (:subaccnt_number, :subaccnt_descrip);");
-          syncSync.bindValue(":subaccnt_number",  rmq.value("accnt_sub"));
-          syncSync.bindValue(":subaccnt_descrip", rmq.value("subaccnt_descrip"));
-          syncSync.exec();
-          if (syncSync.lastError().type() != QSqlError::NoError)
-          {
-            systemError(this, syncSync.lastError().databaseText(), __FILE__, __LINE__);
-            errorCount++;
-            // don't break/continue - do as much as we can
-          }
-        }
-      } // next profit center
-      if (rmq.lastError().type() != QSqlError::NoError)
-      {
-	systemError(this, rmq.lastError().databaseText(), __FILE__, __LINE__);
-        errorCount++;
-	return;
-      }
-
-      // Now for what we really want - if the periods match then upsert trialbal
-      XSqlQuery rollback;
-      rollback.prepare("ROLLBACK;");
-
-      XSqlQuery conv;
-      XSqlQuery ltxn;
-      ltxn.exec("BEGIN;");
-
-      int sequence = -1;
-      XSqlQuery seq;
-      seq.exec("SELECT fetchGLSequence() AS sequence;");
-      if (seq.first())
-        sequence = seq.value("sequence").toInt();
-      else if (seq.lastError().type() != QSqlError::NoError)
-      {
-        systemError(this, seq.lastError().databaseText(), __FILE__, __LINE__);
-        errorCount++;
-        return;
-      }
-
-      // Loop and build manually to ensure proper order
-      QList<XTreeWidgetItem*> period;
-      for (int i = 0; i < _period->topLevelItemCount(); i++)
-      {
-        if (_period->topLevelItem(i)->isSelected())
-        {
-          bool inserted = false;
-          QDate _periodStart = _period->topLevelItem(i)->rawValue("period_start").toDate();
-          for (int j = 0; j < period.size(); j++)
-          {
-            XTreeWidgetItem *p = (XTreeWidgetItem*)(period[j]);
-            QDate periodStart = p->rawValue("period_start").toDate();
-            if (_periodStart < periodStart)
-            {
-              period.insert(j, _period->topLevelItem(i));
-              inserted = true;
-              break;
-            }
-          }
-          if (!inserted)
-            period.append(_period->topLevelItem(i));
-        }
-      }
-
-      for (int j = 0; j < period.size(); j++)
-      {
-        XTreeWidgetItem *p = (XTreeWidgetItem*)(period[j]);
-
-        if (progress.wasCanceled())
-        {
-          rollback.exec();
-          break;
-        }
-
-        progress.setLabelText(tr("Synchronizing Company %1 (%2) \n"
-                                 "Period %3")
-                          .arg(c->rawValue("company_number").toString())
-                          .arg(dbURL)
-                          .arg(p->rawValue("period_name").toString()));
+        systemError(this, fetch->lastError().databaseText(), __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
+    else if (! fetch->_errorTitle.isEmpty())
+    {
+      QMessageBox::warning(this, fetch->_errorTitle, fetch->_errorText);
+      errorCount++;
+      continue;
+    }
 
-        if (p->rawValue("period_closed").toBool())
-        {
-          rollback.exec();
-          QMessageBox::warning(this, tr("Period Closed"),
-                               tr("Period %1 to %2 is closed and may not  "
-                                  "be synchronized.")
-                               .arg(p->rawValue("period_start").toString())
-                               .arg(p->rawValue("period_end").toString())
-                               );
-          errorCount++;
-          break;
-        }
+    progress.setLabelText(tr("Synchronizing Company %1 (%2)")
+                                       .arg(c->rawValue("company_number").toString())
+                                       .arg(fetch->_dbURL));
+    qApp->processEvents();
+
+    // Now for what we really want - if the periods match then upsert trialbal
+    XSqlQuery rollback;
+    rollback.prepare("ROLLBACK;");
+
+    XSqlQuery ltxn;
+    ltxn.exec("BEGIN;");
+
+    int sequence = -1;
+    XSqlQuery seq;
+    seq.exec("SELECT fetchGLSequence() AS sequence;");
+    if (seq.first())
+      sequence = seq.value("sequence").toInt();
+    else if (seq.lastError().type() != QSqlError::NoError)
+    {
+      rollback.exec();
+      systemError(this, seq.lastError().databaseText(), __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
 
-        XSqlQuery rperiod(testDB);
-        rperiod.prepare("SELECT * "
-                        "FROM period "
-                        "WHERE ((period_start=:start)"
-                        "  AND  (period_end=:end));");
-        rperiod.bindValue(":start", p->rawValue("period_start"));
-        rperiod.bindValue(":end",   p->rawValue("period_end"));
-        rperiod.exec();
-        if (rperiod.first())
-        {
-          if (progress.wasCanceled())
-          {
-            rollback.exec();
-            break;
-          }
-
-          progress.setLabelText(tr("Synchronizing Company %1 (%2) \n"
-                                   "Period %3: Clearing old data...")
-                            .arg(c->rawValue("company_number").toString())
-                            .arg(dbURL)
-                            .arg(p->rawValue("period_name").toString()));
-          // Clear old data
-          XSqlQuery tbsync;
-          tbsync.prepare("DELETE FROM trialbal "
-                         "WHERE (trialbal_period_id IN ("
-                         "  SELECT period_id "
-                         "  FROM period "
-                         "  WHERE (period_start >= :startdate))) "
-                         " AND (trialbal_accnt_id IN ("
-                         "  SELECT accnt_id "
-                         "  FROM accnt "
-                         "  WHERE ((accnt_id=trialbal_accnt_id) "
-                         "   AND (accnt_company=:company_number))));"
-                         "DELETE FROM gltranssync "
-                         "WHERE ((gltrans_date >= :startdate)"
-                         " AND (gltranssync_company_id=:company_id));");
-          tbsync.bindValue(":company_id", c->id("company_number"));
-          tbsync.bindValue(":startdate", p->rawValue("period_start").toDate());
-          tbsync.bindValue(":company_number", c->rawValue("company_number"));
-          tbsync.bindValue(":period_id", p->id());
-          tbsync.exec();
-          if (tbsync.lastError().type() != QSqlError::NoError)
-          {
-            rollback.exec();
-            systemError(this, rperiod.lastError().databaseText(),
-                        __FILE__, __LINE__);
-            errorCount++;
-            break;
-          }
-        }
-        else if (rperiod.lastError().type() != QSqlError::NoError)
-        {
-          rollback.exec();
-          systemError(this, rperiod.lastError().databaseText(),
-                      __FILE__, __LINE__);
-          errorCount++;
-          break;
-        }
-        else
-        {
-          rollback.exec();
-          QMessageBox::warning(this, tr("No Corresponding Period"),
-                               tr("<p>The child database for Company %1 (%2) "
-                                  "does not appear to have an Accounting "
-                                  "Period starting on %3 and ending on %4.")
-                               .arg(c->rawValue("company_number").toString())
-                               .arg(c->rawValue("company_database").toString())
-                               .arg(p->rawValue("period_start").toString())
-                               .arg(p->rawValue("period_end").toString())
-                               );
-          errorCount++;
-          break;
-        }
+    QSqlError applyError;
+    if (! apply(fetch, sequence, applyError))
+    {
+      rollback.exec();
+      systemError(this, applyError.databaseText(), __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
 
-        if (progress.wasCanceled())
-        {
-          rollback.exec();
-          break;
-        }
+    if (progress.wasCanceled())
+    {
+      rollback.exec();
+      break;
+    }
 
-        progress.setLabelText(tr("Synchronizing Company %1 (%2): \n"
-                                 "Period: %3 \n"
-                                 "Updating Chart of Accounts...")
+    progress.setLabelText(tr("Synchronizing Company %1 (%2): Posting into trial balances...")
                           .arg(c->rawValue("company_number").toString())
-                          .arg(dbURL)
-                          .arg(p->rawValue("period_name").toString()));
-
-        int accntid = -1;
-        XSqlQuery raccnt(testDB);
-        raccnt.prepare("SELECT * "
-                       "FROM accnt "
-                       "WHERE (accnt_company=:accnt_company);");
-        raccnt.bindValue(":accnt_company", c->rawValue("company_number"));
-        raccnt.exec();
-        progress.setMaximum(raccnt.size());
-        while (raccnt.next())
-        {
-          XSqlQuery laccnt;
-          laccnt.prepare("SELECT * "
-                         "FROM accnt "
-                         "WHERE ((accnt_company=:accnt_company)"
-                         "  AND  (accnt_profit=:accnt_profit)"
-                         "  AND  (accnt_number=:accnt_number)"
-                         "  AND  (accnt_sub=:accnt_sub));");
-          laccnt.bindValue(":accnt_company",raccnt.value("accnt_company"));
-          laccnt.bindValue(":accnt_profit", raccnt.value("accnt_profit"));
-          laccnt.bindValue(":accnt_number", raccnt.value("accnt_number"));
-          laccnt.bindValue(":accnt_sub",    raccnt.value("accnt_sub"));
-          laccnt.exec();
-
-          XSqlQuery laccntups;  // update/insert local account table
-          if (laccnt.first())
-          {
-            laccntups.prepare("UPDATE accnt SET "
-                              "    accnt_descrip=:accnt_descrip,"
-                              "    accnt_comments=:accnt_comments,"
-                              "    accnt_type=:accnt_type,"
-                              "    accnt_extref=:accnt_extref,"
-                              "    accnt_forwardupdate=:accnt_forwardupdate,"
-                              "    accnt_subaccnttype_code=:accnt_subaccnttype_code,"
-                              "    accnt_curr_id=:accnt_curr_id "
-                              "WHERE (accnt_id=:accnt_id);");
-            laccntups.bindValue(":accnt_id",	laccnt.value("accnt_id"));
-            accntid = laccnt.value("accnt_id").toInt();
-          }
-          else if (laccnt.lastError().type() != QSqlError::NoError)
-          {
-            rollback.exec();
-            systemError(this, laccnt.lastError().databaseText(),
-                        __FILE__, __LINE__);
-            errorCount++;
-            break;
-          }
-          else
-          {
-            laccntups.prepare("INSERT INTO accnt ("
-                              "    accnt_id, accnt_number, accnt_descrip,"
-                              "    accnt_comments, accnt_profit, accnt_sub,"
-                              "    accnt_type, accnt_extref, accnt_company, "
-                              "    accnt_forwardupdate, "
-                              "    accnt_subaccnttype_code, accnt_curr_id) "
-                              "VALUES ("
-                              "    :accnt_id, :accnt_number,:accnt_descrip,"
-                              "    :accnt_comments,:accnt_profit,:accnt_sub,"
-                              "    :accnt_type,:accnt_extref,:accnt_company, "
-                              "    :accnt_forwardupdate, "
-                              "    :accnt_subaccnttype_code,:accnt_curr_id);");
-            syncSync.prepare("SELECT NEXTVAL('accnt_accnt_id_seq') AS accnt_id;");
-            syncSync.exec();
-            if (syncSync.first())
-            {
-              laccntups.bindValue(":accnt_id",	syncSync.value("accnt_id"));
-              accntid = syncSync.value("accnt_id").toInt();
-            }
-            else if (syncSync.lastError().type() != QSqlError::NoError)
-            {
-              systemError(this, syncSync.lastError().databaseText(), __FILE__, __LINE__);
-              errorCount++;
-              break;
-            }
-          }
-
-          laccntups.bindValue(":accnt_number",	  raccnt.value("accnt_number"));
-          laccntups.bindValue(":accnt_descrip",	  raccnt.value("accnt_descrip"));
-          laccntups.bindValue(":accnt_comments",  raccnt.value("accnt_comments"));
-          laccntups.bindValue(":accnt_profit",	  raccnt.value("accnt_profit"));
-          laccntups.bindValue(":accnt_sub",	  raccnt.value("accnt_sub"));
-          laccntups.bindValue(":accnt_type",	  raccnt.value("accnt_type"));
-          laccntups.bindValue(":accnt_extref",	  raccnt.value("accnt_extref"));
-          laccntups.bindValue(":accnt_company",	  raccnt.value("accnt_company"));
-          laccntups.bindValue(":accnt_forwardupdate",raccnt.value("accnt_forwardupdate"));
-          laccntups.bindValue(":accnt_subaccnttype_code",raccnt.value("accnt_subaccnttype_code"));
-          laccntups.bindValue(":accnt_curr_id",	  raccnt.value("accnt_curr_id"));
-
-          laccntups.exec();
-          if (laccntups.lastError().type() != QSqlError::NoError)
-          {
-            rollback.exec();
-            systemError(this, laccntups.lastError().databaseText(),
-                        __FILE__, __LINE__);
-            errorCount++;
-            break;
-          }
-
-          // Import trans detail
-          QDate prevDate = omfgThis->startOfTime();
-          XSqlQuery rgl(testDB);
-          XSqlQuery lgl;
-          rgl.prepare("SELECT *, formatGlAccountLong(gltrans_accnt_id) AS f_accnt "
-                      " FROM ( "
-                      "SELECT gltrans_accnt_id, gltrans_date, gltrans_source, "
-                      "  SUM(gltrans_amount) AS amount "
-                      "FROM gltrans, period "
-                      "WHERE ((period_id=:period_id) "
-                      "  AND (gltrans_accnt_id=:accnt_id) "
-                      "  AND (gltrans_amount < 0) "
-                      "  AND (gltrans_posted) "
-                      "  AND (NOT gltrans_deleted) "
-                      "  AND (gltrans_date "
-                      "       BETWEEN period_start AND period_end)) "
-                      "GROUP BY gltrans_accnt_id, gltrans_source, gltrans_date "
-                      "UNION ALL "
-                      "SELECT gltrans_accnt_id, gltrans_date,  gltrans_source, "
-                      "  SUM(gltrans_amount) AS amount "
-                      "  FROM gltrans, period "
-                      "WHERE ((period_id=:period_id) "
-                      "  AND (gltrans_accnt_id=:accnt_id) "
-                      "  AND (gltrans_amount > 0) "
-                      "  AND (gltrans_posted) "
-                      "  AND (NOT gltrans_deleted) "
-                      "  AND (gltrans_date "
-                      "       BETWEEN period_start AND period_end)) "
-                      "GROUP BY gltrans_accnt_id, gltrans_source, gltrans_date) data "
-                      "ORDER BY gltrans_date, gltrans_source, f_accnt; ");
-          rgl.bindValue(":period_id", rperiod.value("period_id"));
-          rgl.bindValue(":accnt_id",  raccnt.value("accnt_id"));
-          rgl.exec();
-          while (rgl.next())
-          {
-            // Fetch conversion rate for the date
-            if (rgl.value("gltrans_date").toDate() != prevDate)
-            {
-              if (progress.wasCanceled())
-              {
-                rollback.exec();
-                break;
-              }
-
-              progress.setLabelText(tr("Synchronizing Company %1 (%2) \n"
-                                       "Period: %3\n"
-                                       "Account: %4")
-                                .arg(c->rawValue("company_number").toString())
-                                .arg(dbURL)
-                                .arg(p->rawValue("period_name").toString())
-                                .arg(rgl.value("f_accnt").toString()));
-              conv.prepare("SELECT currRate(:curr_id, :date) AS curr_rate; ");
-              conv.bindValue(":curr_id", currid);
-              conv.bindValue(":date", rgl.value("gltrans_date"));
-              conv.exec();
-              if (conv.first())
-                ; // Keep going
-              else if (conv.lastError().type() != QSqlError::NoError)
-              {
-                rollback.exec();
-                QMessageBox::warning(this, tr("No Conversion Rate"),
-                                     tr("The parent database for Company %1 (%2) "
-                                        "does not appear to have a conversion rate "
-                                        "for %3 on %4.")
-                                     .arg(c->rawValue("company_number").toString())
-                                     .arg(c->rawValue("company_database").toString())
-                                     .arg(c->text("currency"))
-                                     .arg(p->rawValue("period_end").toString())
-                                     );
-                errorCount++;
-                break;
-              }
-            }
-
-            prevDate = rgl.value("gltrans_date").toDate();
-
-            lgl.prepare("INSERT INTO gltranssync ("
-                        "  gltrans_exported, gltrans_created, "
-                        "  gltrans_date, gltrans_sequence, "
-                        "  gltrans_accnt_id, gltrans_source, "
-                        "  gltrans_docnumber, gltrans_misc_id, "
-                        "  gltrans_amount, gltrans_notes, "
-                        "  gltrans_journalnumber, gltrans_posted, "
-                        "  gltrans_doctype, gltrans_rec, "
-                        "  gltrans_username, gltrans_deleted, "
-                        "  gltranssync_company_id, "
-                        "  gltranssync_period_id, gltranssync_curr_amount, "
-                        "  gltranssync_curr_id, gltranssync_curr_rate) "
-                        "VALUES ( "
-                        "  false, now(),:date, :sequence, "
-                        "  :accnt_id,:source, '', -1, "
-                        "  currToBase(:curr_id, :amount, :date), "
-                        "  :notes, -1, false, "
-                        "  '', false, getEffectiveXtUser(), false, "
-                        "  :company_id, :period_id, "
-                        "  :amount, :curr_id, :curr_rate);");
-            lgl.bindValue(":sequence", sequence);
-            lgl.bindValue(":accnt_id", accntid);
-            lgl.bindValue(":company_id", c->id("company_number"));
-            lgl.bindValue(":period_id", p->id());
-            lgl.bindValue(":source", rgl.value("gltrans_source"));
-            lgl.bindValue(":notes", tr("Data imported from Company %1 (%2)")
-                          .arg(c->rawValue("company_number").toString())
-                          .arg(c->rawValue("company_database").toString()));
-            lgl.bindValue(":date", rgl.value("gltrans_date"));
-            lgl.bindValue(":amount", rgl.value("amount"));
-            lgl.bindValue(":curr_id", currid);
-            lgl.bindValue(":curr_rate", conv.value("curr_rate"));
-            lgl.exec();
-            if (lgl.lastError().type() != QSqlError::NoError)
-            {
-              rollback.exec();
-              systemError(this, lgl.lastError().databaseText(),
-                          __FILE__, __LINE__);
-              errorCount++;
-              break;
-            }
-          }
-
-          if (progress.wasCanceled())
-          {
-            rollback.exec();
-            break;
-          }
-
-          progress.setValue(progress.value()+1);
-        } // for each remote ledger account
-        if (raccnt.lastError().type() != QSqlError::NoError)
-        {
-          rollback.exec();
-          systemError(this, raccnt.lastError().databaseText(),
-                      __FILE__, __LINE__);
-          errorCount++;
-          break;
-        }
-      } // for each selected period
-
-      if (progress.wasCanceled())
-      {
-        rollback.exec();
-        break;
-      }
-
-      progress.setLabelText(tr("Synchronizing Company %1 (%2): Posting into trial balances...")
-                            .arg(c->rawValue("company_number").toString())
-                            .arg(dbURL));
-      // Post into trial balance
-      XSqlQuery post;
-      post.prepare("SELECT postIntoTrialBalanceSync(:sequence, :notes); ");
-      post.bindValue(":sequence", sequence);
-      post.bindValue(":company_id", c->id("company_number"));
-      post.bindValue(":notes", tr("Currency Rounding Discrepency Adjustment"));
-      post.exec();
-      if (post.lastError().type() != QSqlError::NoError)
-      {
-        rollback.exec();
-        systemError(this, post.lastError().databaseText(),
-                    __FILE__, __LINE__);
-        errorCount++;
-        break;
-      }
-
-      XSqlQuery tbs;
-      tbs.exec("SELECT trialbal_id FROM trialbalsync WHERE (trialbal_dirty); ");
-      if (tbs.lastError().type() != QSqlError::NoError)
-      {
-        rollback.exec();
-        systemError(this, tbs.lastError().databaseText(),
-                    __FILE__, __LINE__);
-        errorCount++;
-        break;
-      }
-
-      progress.setLabelText(tr("Synchronizing Company %1 (%2)\n"
-                               "Forward updating trial balances...")
-                                         .arg(c->rawValue("company_number").toString())
-                                         .arg(dbURL));
-      progress.setMaximum(tbs.size());
-      while(tbs.next())
-      {
-        post.prepare("SELECT forwardUpdateTrialBalanceSync(:trialbal_id); ");
-        post.bindValue(":trialbal_id", tbs.value("trialbal_id"));
-        post.exec();
-        if (post.lastError().type() != QSqlError::NoError)
-        {
-          rollback.exec();
-          systemError(this, post.lastError().databaseText(),
-                      __FILE__, __LINE__);
-          errorCount++;
-          break;
-        }
+                          .arg(fetch->_dbURL));
+    qApp->processEvents();
+    // Post into trial balance
+    XSqlQuery post;
+    post.prepare("SELECT postIntoTrialBalanceSync(:sequence, :notes); ");
+    post.bindValue(":sequence", sequence);
+    post.bindValue(":company_id", c->id("company_number"));
+    post.bindValue(":notes", tr("Currency Rounding Discrepency Adjustment"));
+    post.exec();
+    if (post.lastError().type() != QSqlError::NoError)
+    {
+      rollback.exec();
+      systemError(this, post.lastError().databaseText(),
+                  __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
 
-        if (progress.wasCanceled())
-        {
-          rollback.exec();
-          break;
-        }
+    progress.setLabelText(tr("Synchronizing Company %1 (%2)\n"
+                             "Forward updating trial balances...")
+                                       .arg(c->rawValue("company_number").toString())
+                                       .arg(fetch->_dbURL));
+    qApp->processEvents();
+    post.prepare("SELECT forwardUpdateTrialBalanceSync(trialbal_id) FROM trialbalsync WHERE (trialbal_dirty); ");
+    post.exec();
+    if (post.lastError().type() != QSqlError::NoError)
+    {
+      rollback.exec();
+      systemError(this, post.lastError().databaseText(),
+                  __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
 
-        progress.setValue(progress.value()+1);
-      }
+    XSqlQuery tbs;
+    tbs.exec("SELECT trialbal_id "
+             "FROM trialbalsync "
+             " JOIN period ON (trialbal_period_id=period_id) "
+             "WHERE ((NOT trialbalsync_curr_posted) "
+             " AND (trialbalsync_curr_id != baseCurrId()))"
+             "ORDER BY period_end;");
+    if (tbs.lastError().type() != QSqlError::NoError)
+    {
+      rollback.exec();
+      systemError(this, tbs.lastError().databaseText(),
+                  __FILE__, __LINE__);
+      errorCount++;
+      continue;
+    }
 
-      post.prepare("SELECT forwardUpdateTrialBalanceSync(trialbal_id) FROM trialbalsync WHERE (trialbal_dirty); ");
+    progress.setLabelText(tr("Synchronizing Company %1 (%2)\n"
+                             "Posting currency revaluation adjustments...")
+                                       .arg(c->rawValue("company_number").toString())
+                                       .arg(fetch->_dbURL));
+    progress.setMaximum(tbs.size());
+    progress.setValue(0);
+    progress.setAutoReset(false);
+
+    // adjustments have to be posted in period order
+    bool failed = false;
+    while(! failed && tbs.next())
+    {
+      post.prepare("SELECT postCurrAdjustSync(:trialbal_id, :adj_notes); ");
+      post.bindValue(":trialbal_id", tbs.value("trialbal_id"));
+      post.bindValue(":adj_notes", tr("Unrealized Gain/Loss Adjustment"));
       post.exec();
       if (post.lastError().type() != QSqlError::NoError)
       {
@@ -891,65 +878,22 @@ void syncCompanies::sSync()
         systemError(this, post.lastError().databaseText(),
                     __FILE__, __LINE__);
         errorCount++;
-        break;
+        failed = true;
       }
-
-      tbs.exec("SELECT trialbal_id "
-               "FROM trialbalsync "
-               " JOIN period ON (trialbal_period_id=period_id) "
-               "WHERE ((NOT trialbalsync_curr_posted) "
-               " AND (trialbalsync_curr_id != baseCurrId()))"
-               "ORDER BY period_end;");
-      if (tbs.lastError().type() != QSqlError::NoError)
+      else if (progress.wasCanceled())
       {
         rollback.exec();
-        systemError(this, tbs.lastError().databaseText(),
-                    __FILE__, __LINE__);
-        errorCount++;
-        break;
+        failed = true;
       }
-
-      progress.setLabelText(tr("Synchronizing Company %1 (%2)\n"
-                               "Posting currency revaluation adjustments...")
-                                         .arg(c->rawValue("company_number").toString())
-                                         .arg(dbURL));
-      progress.setMaximum(tbs.size());
-      progress.setAutoReset(false);
-
-      while(tbs.next())
-      {
-        post.prepare("SELECT postCurrAdjustSync(:trialbal_id, :adj_notes); ");
-        post.bindValue(":trialbal_id", tbs.value("trialbal_id"));
-        post.bindValue(":adj_notes", tr("Unrealized Gain/Loss Adjustment"));
-        post.exec();
-        if (post.lastError().type() != QSqlError::NoError)
-        {
-          rollback.exec();
-          systemError(this, post.lastError().databaseText(),
-                      __FILE__, __LINE__);
-          errorCount++;
-          break;
-        }
-
-        if (progress.wasCanceled())
-        {
-          rollback.exec();
-          break;
-        }
+      else
         progress.setValue(progress.value()+1);
-      }
+    }
 
+    if (! failed)
       ltxn.exec("COMMIT;");
-    }
-    else
-    {
-      QMessageBox::warning(this, tr("Could Not Connect"),
-                           tr("<p>Could not connect to the child database "
-                              "with these connection parameters."));
-      errorCount++;
-      continue;
-    }
-  } // for each selected company
+  } // for each company read
+
+  qDeleteAll(fetches);
 
   progress.accept();
   if (progress.wasCanceled())
@@ -17,6 +17,9 @@
 
 #include "ui_syncCompanies.h"
 
+class QSqlError;
+class syncCompanyFetch;
+
 class syncCompanies : public XWidget, public Ui::syncCompanies
 {
     Q_OBJECT
@@ -36,6 +39,9 @@ class syncCompanies : public XWidget, public Ui::syncCompanies
 
     virtual void sFillList();
     virtual void sSync();
+
+  protected:
+    virtual bool apply(syncCompanyFetch *fetch, int sequence, QSqlError &error);
 };
 
 #endif // SYNCCOMPANIES_H
@@ -37,6 +37,7 @@ unpostedPurchaseOrders::unpostedPurchaseOrders(QWidget* parent, const char*, Qt:
   setNewVisible(true);
   setQueryOnStartEnabled(true);
   setAutoUpdateEnabled(true);
+  setAutoUpdateChannels(QStringList() << "pohead" << "poitem");
   setSearchVisible(true);
 
   if (_metrics->boolean("MultiWhs"))
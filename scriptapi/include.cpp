@@ -9,7 +9,7 @@
  */
 
 #include "include.h"
-#include <xsqlquery.h>
+#include "scriptcache.h"
 
 /*! \file include.cpp
 
@@ -53,30 +53,28 @@ void setupInclude(QScriptEngine *engine)
 QScriptValue includeScript(QScriptContext *context, QScriptEngine *engine)
 {
   int count = 0;
-  XSqlQuery scriptq;
-  scriptq.prepare("SELECT script_id, script_source AS src"
-                  "  FROM script"
-                  " WHERE ((script_name=:script_name)"
-                  "   AND  (script_enabled))"
-                  " ORDER BY script_order;");
 
   context->setActivationObject(context->parentContext()->activationObject());
   context->setThisObject(context->parentContext()->thisObject());
 
+  QStringList names;
+  for (int i = 0; i < context->argumentCount(); i++)
+    names.append(context->argument(i).toString());
+  ScriptCache::instance()->prefetch(names);
+
   for (; count < context->argumentCount(); count++)
   {
-    QString scriptname = context->argument(count).toString();
-    scriptq.bindValue(":script_name", scriptname);
-    scriptq.exec();
-    while (scriptq.next())
+    QString scriptname = names.at(count);
+    QList<ScriptCache::Script> scripts = ScriptCache::instance()->scripts(scriptname);
+    for (int i = 0; i < scripts.size(); i++)
     {
-      QScriptValue result = engine->evaluate(scriptq.value("src").toString(),
+      QScriptValue result = engine->evaluate(scripts.at(i).source,
                                              scriptname,
                                              1);
       if (engine->hasUncaughtException())
       {
         qWarning() << "uncaught exception in" << scriptname
-                   << "(id" << scriptq.value("script_id").toInt()
+                   << "(id" << scripts.at(i).id
                    << ") at line"
                    << engine->uncaughtExceptionLineNumber() << ":"
                    << result.toString();
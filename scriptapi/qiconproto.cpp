@@ -11,7 +11,7 @@
 #include "qiconproto.h"
 #include "xsqlquery.h"
 
-#include <quuencode.h>
+#include "imagecache.h"
 
 #include <QIcon>
 #include <QImage>
@@ -59,18 +59,9 @@ void QIconProto::addDbImage(const QString& name)
   QIcon *item = qscriptvalue_cast<QIcon*>(thisObject());
   if (item)
   {
-    QImage img;
-    XSqlQuery image;
-    image.prepare( "SELECT image_data "
-                   "FROM image "
-                   "WHERE (image_name=:name);" );
-    image.bindValue(":name", name);
-    image.exec();
-    if (image.first())
-    {
-      img.loadFromData(QUUDecode(image.value("image_data").toString()));
+    QImage img = ImageCache::instance()->image(name);
+    if (! img.isNull())
       item->addPixmap(QPixmap::fromImage(img));
-    }
   }
 }
 
@@ -118,8 +118,7 @@ void CrmClusterLineEdit::silentSetId(const int pId)
     idQ.exec();
     if (idQ.first())
     {
-      if (_completer)
-        static_cast<QSqlQueryModel* >(_completer->model())->setQuery(QSqlQuery());
+      clearCompleter();
 
       _id = pId;
       _valid = true;
@@ -107,7 +107,8 @@ void docAttach::set(const ParameterList &pParams)
   {
     XSqlQuery qry;
     _urlid = param.toInt();
-    qry.prepare("SELECT url_source, url_source_id, url_title, url_url, url_stream "
+    qry.prepare("SELECT url_source, url_source_id, url_title, url_url,"
+                "       COALESCE(OCTET_LENGTH(url_stream), 0) > 0 AS url_stored "
                 "  FROM url"
                 " WHERE (url_id=:url_id);" );
     qry.bindValue(":url_id", _urlid);
@@ -125,7 +126,7 @@ void docAttach::set(const ParameterList &pParams)
         _docType->setCurrentIndex(5);
         _filetitle->setText(qry.value("url_title").toString());
         _file->setText(url.toString());
-        if (qry.value("url_stream").toString().length())
+        if (qry.value("url_stored").toBool())
         {
           _fileList->setEnabled(false);
           _file->setEnabled(false);
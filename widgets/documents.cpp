@@ -9,9 +9,12 @@
  */
 
 #include <QDesktopServices>
+#include <QEventLoop>
 #include <QMessageBox>
 #include <QDebug>
 #include <QDialog>
+#include <QProgressDialog>
+#include <QSqlError>
 #include <QUrl>
 #include <QMenu>
 #include <QFileInfo>
@@ -25,6 +28,7 @@
 #include "mqlutil.h"
 
 #include "documents.h"
+#include "documenttransfer.h"
 #include "errorReporter.h"
 #include "imageview.h"
 #include "imageAssignment.h"
@@ -283,7 +287,7 @@ void Documents::sOpenDoc(QString mode)
     }
 
     XSqlQuery qfile;
-    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url, url_stream"
+    qfile.prepare("SELECT url_id, url_source_id, url_source, url_title, url_url"
                   " FROM url"
                   " WHERE (url_id=:url_id);");
 
@@ -313,19 +317,37 @@ void Documents::sOpenDoc(QString mode)
       if (! tdir.exists(filePath))
         tdir.mkpath(filePath);
 
-      if (!tfile.open(QIODevice::WriteOnly))
+      DocumentTransfer transfer;
+      transfer.setDownload(qfile.value("url_id").toInt(), tfile.fileName());
+
+      QProgressDialog progress(tr("Retrieving %1...").arg(fileName),
+                               tr("Cancel"), 0, 100, this);
+      progress.setWindowModality(Qt::WindowModal);
+      progress.setMinimumDuration(500);
+      connect(&transfer, SIGNAL(progress(int)), &progress, SLOT(setValue(int)));
+      connect(&progress, SIGNAL(canceled()),    &transfer, SLOT(cancel()));
+
+      QEventLoop loop;
+      connect(&transfer, SIGNAL(finished()), &loop, SLOT(quit()));
+      transfer.start();
+      loop.exec();
+      progress.reset();
+
+      if (transfer.isCancelled())
+        return;
+      else if (transfer.lastError().type() != QSqlError::NoError)
       {
         QMessageBox::warning( this, tr("File Open Error"),
-                             tr("Could Not Create File %1.").arg(tfile.fileName()) );
+                             tr("Could Not Create File %1.<br>%2")
+                               .arg(tfile.fileName(), transfer.lastError().text()));
         return;
       }
-      tfile.write(qfile.value("url_stream").toByteArray());
+
       QUrl urldb;
       urldb.setUrl(tfile.fileName());
 #ifndef Q_WS_WIN
       urldb.setScheme("file");
 #endif
-      tfile.close();
       if (! QDesktopServices::openUrl(urldb))
       {
         QMessageBox::warning(this, tr("File Open Error"),
@@ -13,7 +13,7 @@
 #include <QPixmap>
 #include <QScrollArea>
 
-#include <quuencode.h>
+#include "imagecache.h"
 
 #define DEBUG   false
 
@@ -59,18 +59,13 @@ void ImageCluster::sRefresh()
   }
   else
   {
-    XSqlQuery data;
-    data.prepare("SELECT image_data FROM image WHERE image_id=:image_id");
-    data.bindValue(":image_id", id());
-    data.exec();
-    if (data.first())
+    QImage tmpImage = ImageCache::instance()->image(id());
+    if (! tmpImage.isNull())
     {
       if (DEBUG)
-        qDebug("ImageCluster::sRefresh() has picture %s, %d",
+        qDebug("ImageCluster::sRefresh() has picture %s, %dx%d",
                qPrintable(_description->text().right(128)),
-               data.value("image_data").toString().length());
-      QImage tmpImage;
-      tmpImage.loadFromData(QUUDecode(data.value("image_data").toString()));
+               tmpImage.width(), tmpImage.height());
       _image->setPixmap(QPixmap::fromImage(tmpImage));
     }
   }
@@ -23,6 +23,8 @@
 #include <QScrollArea>
 #include <quuencode.h>
 
+#include "imagecache.h"
+
 imageview::imageview(QWidget* parent, const char* name, bool modal, Qt::WFlags fl)
     : QDialog(parent, fl)
 {
@@ -190,6 +192,7 @@ void imageview::sSave()
   }
 
   newImage.exec();
+  ImageCache::notifyChanged();
 
   done(_imageviewid);
 }
@@ -422,7 +422,7 @@ void ItemLineEdit::silentSetId(const int pId)
     if (completer())
     {
       disconnect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
-      static_cast<QSqlQueryModel* >(completer()->model())->setQuery(QSqlQuery());
+      clearCompleter();
     }
 
     _itemNumber = item.value("item_number").toString();
@@ -538,77 +538,40 @@ void ItemLineEdit::sCopy()
   return;
 }
 
-void ItemLineEdit::sHandleCompleter()
+QString ItemLineEdit::completerSql(ParameterList &bindings, const QString &stripped)
 {
-  if (DEBUG) qDebug("%s::sHandleCompleter() entered", qPrintable(objectName()));
-  if (!hasFocus())
-    return;
-
-  QString stripped = text().trimmed().toUpper();
-  if (stripped.isEmpty())
-    return;
-
-  int width = 0;
-  QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
-  QTreeView * view = static_cast<QTreeView *>(_completer->popup());
-  _parsed = true;
-  XSqlQuery numQ;
-
   if (_useQuery)
   {
-    numQ.prepare(QString("SELECT *"
-                         "  FROM (%1) data"
-                         " WHERE (POSITION(:number IN item_number)=1)"
-                         " LIMIT 10")
-                 .arg(QString(_sql)).remove(";"));
-    numQ.bindValue(":number", stripped);
-  }
-  else
-  {
-    QString pre( "SELECT DISTINCT item_id, item_number, "
-                 "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
-                 "item_upccode AS description " );
-
-    QStringList clauses;
-    clauses = _extraClauses;
-    clauses << "((POSITION(:searchString IN item_number) = 1)"
-            " OR (POSITION(:searchString IN item_upccode) = 1))";
-    numQ.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
-                              .replace(";"," ORDER BY item_number LIMIT 10;"));
-    numQ.bindValue(":searchString", QString(text().trimmed().toUpper()));
+    bindings.append("number", stripped);
+    return QString("SELECT *"
+                   "  FROM (%1) data"
+                   " WHERE (POSITION(:number IN item_number)=1)"
+                   " LIMIT %2")
+           .arg(QString(_sql).remove(";")).arg(COMPLETERFETCH);
   }
 
-  numQ.exec();
-  if (numQ.first())
-  {
-    int numberCol = numQ.record().indexOf("item_number");
-    int descripCol = numQ.record().indexOf("itemdescrip");
-    model->setQuery(numQ);
-    _completer->setCompletionPrefix(stripped);
-    for (int i = 0; i < model->columnCount(); i++)
-    {
-      if ( (i == numberCol) ||
-           (i == descripCol) )
-      {
-        view->resizeColumnToContents(i);
-        width += view->columnWidth(i);
-      }
-      else
-        view->hideColumn(i);
-    }
-  }
-  else
-    model->setQuery(QSqlQuery());
+  QString pre( "SELECT DISTINCT item_id, item_number, "
+               "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
+               "item_upccode AS description " );
+
+  QStringList clauses;
+  clauses = _extraClauses;
+  clauses << "((POSITION(:searchString IN item_number) = 1)"
+          " OR (POSITION(:searchString IN item_upccode) = 1))";
+  bindings.append("searchString", stripped);
+  return buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
+                              .replace(";", QString(" ORDER BY item_number LIMIT %1;").arg(COMPLETERFETCH));
+}
 
-  if (width > 350)
-    width = 350;
+bool ItemLineEdit::completerMatches(const QSqlRecord &record, const QString &stripped) const
+{
+  return record.value("item_number").toString().startsWith(stripped) ||
+         (! _useQuery && record.value("description").toString().startsWith(stripped));
+}
 
-  QRect rect;
-  rect.setHeight(height());
-  rect.setWidth(width);
-  rect.setBottomLeft(QPoint(0, height() - 2));
-  _completer->complete(rect);
-  _parsed = false;
+QStringList ItemLineEdit::completerColumns() const
+{
+  return QStringList() << "item_number" << "itemdescrip";
 }
 
 void ItemLineEdit::sUpdateMenu()
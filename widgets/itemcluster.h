@@ -162,7 +162,6 @@ friend class ItemLineEditDelegate;
     Q_INVOKABLE bool    isFractional();
 
   public slots:
-    void sHandleCompleter();
     void sInfo();
     void sCopy();
     void sList();
@@ -196,6 +195,11 @@ friend class ItemLineEditDelegate;
     itemSearch* searchFactory();
     void sUpdateMenu();
 
+  protected:
+    QString     completerSql(ParameterList &bindings, const QString &stripped);
+    bool        completerMatches(const QSqlRecord &record, const QString &stripped) const;
+    QStringList completerColumns() const;
+
   private:
     void constructor();
 
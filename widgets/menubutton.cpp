@@ -11,12 +11,10 @@
 #include "menubutton.h"
 
 #include <parameter.h>
-#include <quuencode.h>
+#include "imagecache.h"
 #include <xsqlquery.h>
 
 #include <QImage>
-#include <QMessageBox>
-#include <QSqlError>
 #include <QtScript>
 #include <QVBoxLayout>
 
@@ -131,24 +129,12 @@ void MenuButton::setImage(const QString & image)
 
   if (_shown)
   {
-    XSqlQuery qry;
-    qry.prepare("SELECT image_data "
-                "FROM image "
-                "WHERE (image_name=:image);");
-    qry.bindValue(":image", _image);
-    qry.exec();
-    if (qry.first())
+    QImage img = ImageCache::instance()->image(_image);
+    if (! img.isNull())
     {
-      QImage img;
-      img.loadFromData(QUUDecode(qry.value("image_data").toString()));
       _button->setIcon(QIcon(QPixmap::fromImage(img)));
       return;
     }
-    else if (qry.lastError().type() != QSqlError::NoError)
-      QMessageBox::critical(this, tr("A System Error occurred at %1::%2.")
-                            .arg(__FILE__)
-                            .arg(__LINE__),
-                            qry.lastError().databaseText());
     _button->setIcon(QIcon(QPixmap(":/widgets/images/folder_zoom_64.png")));
   }
 }
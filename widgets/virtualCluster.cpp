@@ -8,18 +8,23 @@
  * to be bound by its terms.
  */
 
+#include <QApplication>
 #include <QDebug>
+#include <QDateTime>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QKeySequence>
 #include <QMessageBox>
+#include <QPointer>
 #include <QSqlError>
 #include <QSqlRecord>
+#include <QStandardItemModel>
 #include <QVBoxLayout>
 
 #include "xlineedit.h"
 #include "xcheckbox.h"
 #include "xsqlquery.h"
+#include "xsqlthread.h"
 #include "xsqltablemodel.h"
 #include "shortcuts.h"
 
@@ -27,6 +32,37 @@
 
 #define DEBUG false
 
+#define COMPLETERDELAY      250   // msec of keyboard silence before querying
+#define COMPLETERSHOW        10   // rows shown in the popup
+#define COMPLETERCACHETTL    60   // seconds a cached prefix stays usable
+#define COMPLETERCACHESIZE  100   // prefixes cached per completer query
+
+/* completer results shared by every cluster running the same query. a
+   prefix whose result came back short of COMPLETERFETCH rows is complete,
+   so any longer prefix can be answered by filtering it locally.
+ */
+struct CompleterCacheEntry
+{
+  QList<QSqlRecord> rows;
+  bool              complete;
+  QDateTime         fetched;
+};
+static QHash<QString, QHash<QString, CompleterCacheEntry> > _completerCache;
+
+/* every cluster shares one completer thread, and with it one connection,
+   since only the cluster the user is typing in looks anything up.
+   _completerOwner is the cluster whose query the thread is running.
+ */
+static QPointer<XSqlThread>             _completerThread;
+static QPointer<VirtualClusterLineEdit> _completerOwner;
+
+static XSqlThread *completerThread()
+{
+  if (! _completerThread)
+    _completerThread = new XSqlThread(qApp);
+  return _completerThread;
+}
+
 void VirtualCluster::init()
 {
     _number = 0;
@@ -287,6 +323,12 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     _showInactive = false;
     _completerId = 0;
 
+    _completing = false;
+    _completerTimer = new QTimer(this);
+    _completerTimer->setSingleShot(true);
+    _completerTimer->setInterval(COMPLETERDELAY);
+    connect(_completerTimer, SIGNAL(timeout()), this, SLOT(sCompleterTimeout()));
+
     setTableAndColumnNames(pTabName, pIdColumn, pNumberColumn, pNameColumn, pDescripColumn, pActiveColumn);
 
     if (pExtra && QString(pExtra).trimmed().length())
@@ -303,7 +345,7 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     {
       if (!_x_metrics->boolean("DisableAutoComplete"))
       {
-        QSqlQueryModel* hints = new QSqlQueryModel(this);
+        QStandardItemModel* hints = new QStandardItemModel(this);
         _completer = new QCompleter(hints,this);
         _completer->setWidget(this);
         QTreeView* view = new QTreeView(this);
@@ -500,59 +542,192 @@ void VirtualClusterLineEdit::setMenu(QMenu *menu)
   _menu = menu;
 }
 
+/* Completion runs off the GUI thread once the user stops typing for
+   COMPLETERDELAY msec. Prefixes already answered, or narrowed from a
+   complete cached answer, are shown immediately without a query.
+ */
 void VirtualClusterLineEdit::sHandleCompleter()
 {
-  if (!hasFocus())
+  if (!hasFocus() || !_completer)
+    return;
+
+  QString stripped = text().trimmed().toUpper();
+  if (stripped.isEmpty())
+  {
+    _completerTimer->stop();
+    return;
+  }
+
+  _parsed = false;
+
+  ParameterList bindings;
+  QList<QSqlRecord> rows;
+  if (cachedCompletion(completerSql(bindings, stripped), stripped, rows))
+  {
+    _completerTimer->stop();
+    showCompleter(rows, stripped);
+  }
+  else
+    _completerTimer->start();
+}
+
+void VirtualClusterLineEdit::sCompleterTimeout()
+{
+  if (!hasFocus() || !_completer)
     return;
 
   QString stripped = text().trimmed().toUpper();
   if (stripped.isEmpty())
     return;
 
+  ParameterList bindings;
+  QString sql = completerSql(bindings, stripped);
+
+  QList<QSqlRecord> rows;
+  if (cachedCompletion(sql, stripped, rows))
+  {
+    showCompleter(rows, stripped);
+    return;
+  }
+
+  if (_completing && _completerPrefix == stripped && _completerSql == sql)
+    return;
+
+  // the new query replaces whatever the thread is running, ours or not
+  XSqlThread *thread = completerThread();
+  if (_completerOwner)
+  {
+    disconnect(thread, 0, _completerOwner, 0);
+    _completerOwner->_completing = false;
+  }
+  _completerOwner = this;
+  _completing     = true;
+
+  _completerPrefix = stripped;
+  _completerSql    = sql;
+  _completerRows.clear();
+
+  thread->setSql(sql, bindings);
+  thread->setBatchSize(COMPLETERFETCH);
+  connect(thread, SIGNAL(rowsReady(const QList<QSqlRecord> &)),
+          this,   SLOT(sCompleterRows(const QList<QSqlRecord> &)));
+  connect(thread, SIGNAL(queryFinished()), this, SLOT(sCompleterFinished()));
+  thread->runQuery();
+}
+
+void VirtualClusterLineEdit::sCompleterRows(const QList<QSqlRecord> &records)
+{
+  if (_completing)
+    _completerRows.append(records);
+}
+
+void VirtualClusterLineEdit::sCompleterFinished()
+{
+  if (! _completing)
+    return;
+
+  XSqlThread *thread = completerThread();
+  disconnect(thread, 0, this, 0);
+  _completerOwner = 0;
+  _completing     = false;
+
+  if (thread->isCancelled())
+    return;
+  else if (thread->lastError().type() != QSqlError::NoError)
+  {
+    if (DEBUG)
+      qDebug() << objectName() << "::sCompleterFinished() error"
+               << thread->lastError().text();
+    return;
+  }
+
+  QHash<QString, CompleterCacheEntry> &typeCache = _completerCache[_completerSql];
+  if (typeCache.size() >= COMPLETERCACHESIZE)
+    typeCache.clear();
+
+  CompleterCacheEntry entry;
+  entry.rows     = _completerRows;
+  entry.complete = _completerRows.size() < COMPLETERFETCH;
+  entry.fetched  = QDateTime::currentDateTime();
+  typeCache.insert(_completerPrefix, entry);
+
+  // the user may have kept typing while the query ran
+  if (hasFocus() && text().trimmed().toUpper() == _completerPrefix)
+    showCompleter(_completerRows, _completerPrefix);
+  _completerRows.clear();
+}
+
+/* Find rows for stripped in the cache, either stored under stripped itself
+   or filtered from a complete result for a shorter prefix. Narrowing is
+   only done for plain text since the server matches a regular expression.
+ */
+bool VirtualClusterLineEdit::cachedCompletion(const QString &sql, const QString &stripped, QList<QSqlRecord> &rows)
+{
+  if (! _completerCache.contains(sql))
+    return false;
+
+  QHash<QString, CompleterCacheEntry> &typeCache = _completerCache[sql];
+  QDateTime oldest = QDateTime::currentDateTime().addSecs(-COMPLETERCACHETTL);
+
+  if (typeCache.contains(stripped) && typeCache.value(stripped).fetched >= oldest)
+  {
+    rows = typeCache.value(stripped).rows;
+    return true;
+  }
+
+  if (QRegExp::escape(stripped) != stripped)
+    return false;
+
+  for (int len = stripped.length() - 1; len > 0; len--)
+  {
+    QHash<QString, CompleterCacheEntry>::const_iterator it = typeCache.find(stripped.left(len));
+    if (it != typeCache.end() && it.value().complete && it.value().fetched >= oldest)
+    {
+      rows.clear();
+      for (int i = 0; i < it.value().rows.size(); i++)
+        if (completerMatches(it.value().rows.at(i), stripped))
+          rows.append(it.value().rows.at(i));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void VirtualClusterLineEdit::showCompleter(const QList<QSqlRecord> &rows, const QString &stripped)
+{
   int width = 0;
-  QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
+  QStandardItemModel* model = static_cast<QStandardItemModel *>(_completer->model());
   QTreeView * view = static_cast<QTreeView *>(_completer->popup());
   _parsed = true;
-  XSqlQuery numQ;
-  numQ.prepare(_query + _numClause +
-               (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
-               ((_hasActive && ! _showInactive) ? _activeClause : "") +
-               QString(" ORDER BY %1 LIMIT 10;").arg(_numColName));
-  numQ.bindValue(":number", "^" + stripped);
-  numQ.exec();
-  if (numQ.first())
+  model->clear();
+  if (! rows.isEmpty())
   {
-    int numberCol = numQ.record().indexOf("number");
-    int nameCol = numQ.record().indexOf("name");
-    int descripCol = numQ.record().indexOf("description");
-    model->setQuery(numQ);
-    _completer->setCompletionPrefix(stripped);
-
-    for (int i = 0; i < model->columnCount(); i++)
+    QStringList visible = completerColumns();
+    for (int r = 0; r < rows.size() && r < COMPLETERSHOW; r++)
     {
-      if ( (i != numberCol) &&
-           (!_hasName || i != nameCol ) &&
-           (!_hasDescription || i != descripCol) )
+      QList<QStandardItem*> items;
+      for (int c = 0; c < rows.at(r).count(); c++)
       {
-        view->hideColumn(i);
+        QStandardItem *item = new QStandardItem();
+        item->setData(rows.at(r).value(c), Qt::DisplayRole);
+        items.append(item);
       }
+      model->appendRow(items);
     }
+    _completer->setCompletionPrefix(stripped);
 
-    view->resizeColumnToContents(numberCol);
-    width += view->columnWidth(numberCol);
-    if (_hasName)
-    {
-      view->resizeColumnToContents(nameCol);
-      width += view->columnWidth(nameCol);
-    }
-    if (_hasDescription)
+    for (int i = 0; i < model->columnCount(); i++)
     {
-      view->resizeColumnToContents(descripCol);
-      width += view->columnWidth(descripCol);
+      bool show = visible.contains(rows.at(0).fieldName(i));
+      view->setColumnHidden(i, ! show);
+      if (show)
+      {
+        view->resizeColumnToContents(i);
+        width += view->columnWidth(i);
+      }
     }
   }
-  else
-    model->setQuery(QSqlQuery());
 
   if (width > 350)
     width = 350;
@@ -565,6 +740,37 @@ void VirtualClusterLineEdit::sHandleCompleter()
   _parsed = false;
 }
 
+QString VirtualClusterLineEdit::completerSql(ParameterList &bindings, const QString &stripped)
+{
+  bindings.append("number", "^" + stripped);
+  return _query + _numClause +
+         (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
+         ((_hasActive && ! _showInactive) ? _activeClause : "") +
+         QString(" ORDER BY %1 LIMIT %2;").arg(_numColName).arg(COMPLETERFETCH);
+}
+
+bool VirtualClusterLineEdit::completerMatches(const QSqlRecord &record, const QString &stripped) const
+{
+  return record.value("number").toString().toUpper().startsWith(stripped);
+}
+
+QStringList VirtualClusterLineEdit::completerColumns() const
+{
+  QStringList columns("number");
+  if (_hasName)
+    columns << "name";
+  if (_hasDescription)
+    columns << "description";
+  return columns;
+}
+
+void VirtualClusterLineEdit::clearCompleter()
+{
+  _completerTimer->stop();
+  if (_completer)
+    static_cast<QStandardItemModel *>(_completer->model())->clear();
+}
+
 void VirtualClusterLineEdit::completerHighlighted(const QModelIndex & index)
 {
   _completerId = _completer->completionModel()->data(index.sibling(index.row(), 0)).toInt();
@@ -733,8 +939,7 @@ void VirtualClusterLineEdit::silentSetId(const int pId)
     idQ.exec();
     if (idQ.first())
     {
-      if (_completer)
-        static_cast<QSqlQueryModel* >(_completer->model())->setQuery(QSqlQuery());
+      clearCompleter();
 
       _id = pId;
       _valid = true;
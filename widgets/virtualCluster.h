@@ -31,6 +31,8 @@
 #include <QMenu>
 #include <QPushButton>
 #include <QSqlQueryModel>
+#include <QSqlRecord>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
 
@@ -42,6 +44,8 @@ class VirtualClusterLineEdit;
 #define DESCRIPTION     3
 #define ACTIVE          4
 
+#define COMPLETERFETCH  50      // rows a completer query may return
+
 class XTUPLEWIDGETS_EXPORT VirtualList : public QDialog
 {
     Q_OBJECT
@@ -275,12 +279,30 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
 
         virtual void silentSetId(const int);
 
+        virtual QString     completerSql(ParameterList &bindings, const QString &stripped);
+        virtual bool        completerMatches(const QSqlRecord &record, const QString &stripped) const;
+        virtual QStringList completerColumns() const;
+        void clearCompleter();
+
         QSqlQueryModel* _model;
 
+    private slots:
+        void sCompleterTimeout();
+        void sCompleterRows(const QList<QSqlRecord> &records);
+        void sCompleterFinished();
+
     private:
         void positionMenuLabel();
+        bool cachedCompletion(const QString &sql, const QString &stripped, QList<QSqlRecord> &rows);
+        void showCompleter(const QList<QSqlRecord> &rows, const QString &stripped);
 
         QString _cText;
+
+        QTimer                 *_completerTimer;
+        bool                    _completing;
+        QString                 _completerPrefix;
+        QString                 _completerSql;
+        QList<QSqlRecord>       _completerRows;
 };
 
 /*
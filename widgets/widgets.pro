@@ -16,7 +16,7 @@ dynamic {
     CONFIG += dll # this is technically redundant as plugin implies dll however it fixes a cross-compile problem
     DESTDIR = $$[QT_INSTALL_PLUGINS]/designer
     QMAKE_LIBDIR = ../lib $$OPENRPT_LIBDIR $$QMAKE_LIBDIR
-    LIBS += -lxtuplecommon -lwrtembed -lrenderer -lMetaSQL -lopenrptcommon
+    LIBS += -lxtuplecommon -lwrtembed -lrenderer -lMetaSQL -lopenrptcommon $${PGSQLLIB}
     DEFINES += MAKEDLL
     MOC_DIR = tmp/dll
     OBJECTS_DIR = tmp/dll
@@ -192,6 +192,7 @@ SOURCES += widgets.cpp \
     xtextedit.cpp \
     xtreeview.cpp \
     xtreewidget.cpp \
+    xtreewidgetexport.cpp \
     xtreewidgetprogress.cpp \
     xurllabel.cpp \
 
@@ -284,6 +285,7 @@ HEADERS += widgets.h \
     xtextedit.h \
     xtreeview.h \
     xtreewidget.h \
+    xtreewidgetexport.h \
     xtreewidgetprogress.h \
     xurllabel.h \
 
@@ -170,6 +170,41 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
     XComboBoxPrivate *_data;
     void init();
 
+  private:
+    void populateCached(XComboBoxTypes pType, const QString &pSql);
+    void finishPopulate(int pSelected);
+};
+
+/* XComboBoxCache keeps the rows of the lookup tables behind the
+   XComboBoxTypes for the whole session so every combo of a given type
+   after the first fills from memory. The slots forget the types affected
+   by the matching GUIClient update signals; XComboBox::populate() forgets
+   the type it repopulates.
+*/
+class XTUPLEWIDGETS_EXPORT XComboBoxCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static XComboBoxCache *instance();
+
+    void invalidate(XComboBox::XComboBoxTypes pType);
+
+  public slots:
+    void clear();
+
+    void sBankAccountsUpdated();
+    void sContractsUpdated();
+    void sItemGroupsUpdated();
+    void sProjectsUpdated();
+    void sReportsChanged();
+    void sSalesRepUpdated();
+    void sStandardPeriodsUpdated();
+    void sTaxAuthsUpdated();
+    void sUserUpdated();
+
+  private:
+    XComboBoxCache();
 };
 
 // TODO: is this necessary for script exposure?
@@ -9,6 +9,7 @@
  */
 
 #include "xtextedit.h"
+#include <QApplication>
 #include <QTextCursor>
 #include <QContextMenuEvent>
 #include <QColor>
@@ -29,6 +30,17 @@ XTextEdit::~XTextEdit()
 {   
 }
 
+/* the spell checker became ready after these were drawn */
+void XTextEdit::rehighlightAll()
+{
+  foreach (QWidget *widget, QApplication::allWidgets())
+  {
+    XTextEdit *edit = qobject_cast<XTextEdit*>(widget);
+    if (edit && edit->_highlighter)
+      edit->_highlighter->rehighlight();
+  }
+}
+
 void XTextEdit::setDataWidgetMap(XDataWidgetMapper* m)
 {
   disconnect(this, SIGNAL(textChanged()), this, SLOT(updateMapperData()));
@@ -178,6 +190,8 @@ void XTextEditHighlighter::highlightBlock(const QString &text)
       {
          QStringList widgetWords = widgetText.split(QRegExp("([^\\w,^\\\\]|(?=\\\\))+"),
                                                        QString::SkipEmptyParts);
+         // every occurrence of a word is underlined at once, so check each once
+         widgetWords.removeDuplicates();
          foreach(QString word, widgetWords)
          {            
             if (word.length() > 1 && !word.startsWith('\\'))
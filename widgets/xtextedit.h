@@ -37,6 +37,7 @@ class XTUPLEWIDGETS_EXPORT XTextEdit : public QTextEdit
     virtual QString fieldName()   const { return _fieldName; };
 
     static GuiClientInterface *_guiClientInterface;
+    static void rehighlightAll();
 
     Q_INVOKABLE bool spellEnabled() const { return _spellStatus; }
 
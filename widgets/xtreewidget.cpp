@@ -8,6 +8,7 @@
  * to be bound by its terms.
  */
 
+#include <algorithm>
 #include <limits>
 
 #include "xtreewidget.h"
@@ -15,31 +16,34 @@
 #include <QAction>
 #include <QApplication>
 #include <QAbstractItemView>
+#include <QBuffer>
 #include <QClipboard>
+#include <QColor>
 #include <QDate>
 #include <QDateTime>
 #include <QDrag>
+#include <QEventLoop>
+#include <QFile>
 #include <QFileDialog>
 #include <QFont>
+#include <QHash>
 #include <QHeaderView>
+#include <QLocale>
 #include <QMenu>
 #include <QMimeData>
 #include <QMouseEvent>
 #include <QProgressBar>
+#include <QPointer>
 #include <QPushButton>
+#include <QScrollBar>
+#include <QSet>
 #include <QSqlError>
 #include <QSqlRecord>
-#include <QTextCharFormat>
-#include <QTextCursor>
-#include <QTextDocument>
-#include <QTextDocumentWriter>
 #include <QTextEdit>
-#include <QTextTable>
-#include <QTextTableCell>
-#include <QTextTableFormat>
 #include <QtScript>
 #include <QMessageBox>
 
+#include "xtreewidgetexport.h"
 #include "xtreewidgetprogress.h"
 #include "xtsettings.h"
 #include "xsqlquery.h"
@@ -77,8 +81,6 @@
 
 GuiClientInterface *XTreeWidget::_guiClientInterface = 0;
 
-static QTreeWidgetItem *searchChildren(XTreeWidgetItem *item, int pId);
-
 // cint() and round() regarding Issue #8897
 #include <cmath>
 
@@ -99,6 +101,95 @@ static double round(double r, int places)
   return cint(r*off)/off;
 }
 
+/* XTreeWidgetTotals remembers what populateCalculatedColumns() read from
+   each top-level row the last time it ran, in flat per-column arrays. After
+   a sort, or when rows are added, it only reads the rows it hasn't seen
+   and redraws the running balances from the first row that moved. An edit
+   re-reads only the edited cells of the total columns.
+*/
+class XTreeWidgetTotals
+{
+  public:
+    struct Column {
+      Column() : col(-1), running(false), scale(0) {}
+
+      int             col;
+      bool            running;  // xtrunningrole, otherwise xttotalrole
+      QVector<double> value;    // per row: raw value or totalForItem()
+      QVector<double> init;     // per row: running or total init role
+      QVector<int>    set;      // per row: running or total set
+      QVector<int>    scales;   // per row: Xt::ScaleRole
+      QVector<double> balance;  // per row: the running balance shown
+      QVector<int>    setIds;   // per set, in order of first appearance
+      QVector<double> sums;     // per set: total or closing balance
+      int             scale;    // largest scale in a total column
+
+      // start over with no sets, keeping the per-row arrays
+      void clearSums()
+      {
+        setIds.clear();
+        sums.clear();
+      }
+
+      // add one row's value to the accumulator for its set
+      double accumulate(int row)
+      {
+        int slot = setIds.indexOf(set.at(row));
+        if (slot < 0)
+        {
+          slot = setIds.size();
+          setIds.append(set.at(row));
+          sums.append(init.at(row));
+        }
+        sums[slot] += value.at(row);
+        return sums.at(slot);
+      }
+    };
+
+    XTreeWidgetTotals() : valid(false) {}
+
+    // read one row's values for column from its item
+    static void read(Column &column, int row, QTreeWidgetItem *rowItem)
+    {
+      XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(rowItem);
+      if (! item)
+      {
+        column.value[row]  = 0.0;
+        column.init[row]   = 0.0;
+        column.set[row]    = 0;
+        column.scales[row] = 0;
+      }
+      else if (column.running)
+      {
+        // assume that Xt::RunningSetRole exists if xtrunningrole exists
+        column.set[row]    = item->data(column.col, Xt::RunningSetRole).toInt();
+        column.init[row]   = item->data(column.col, Xt::RunningInitRole).toDouble();
+        column.value[row]  = item->data(column.col, Xt::RawRole).toDouble();
+        column.scales[row] = item->data(column.col, Xt::ScaleRole).toInt();
+      }
+      else
+      {
+        // assume that Xt::TotalSetRole exists if xttotalrole exists
+        column.set[row]    = item->data(column.col, Xt::TotalSetRole).toInt();
+        column.init[row]   = item->data(column.col, Xt::TotalInitRole).toDouble();
+        column.value[row]  = item->totalForItem(column.col, column.set.at(row));
+        column.scales[row] = item->data(column.col, Xt::ScaleRole).toInt();
+      }
+    }
+
+    void invalidate()
+    {
+      valid = false;
+      rows.clear();
+      rowIndex.clear();
+    }
+
+    bool                          valid;
+    QVector<QTreeWidgetItem *>    rows;       // top-level rows, in order
+    QHash<QTreeWidgetItem *, int> rowIndex;   // row -> position in rows
+    QVector<Column>               columns;
+};
+
 XTreeWidget::XTreeWidget(QWidget *pParent) :
   QTreeWidget(pParent)
 {
@@ -113,6 +204,7 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   _sord    = Qt::AscendingOrder;
   _linear  = false;
   _alwaysLinear = true;
+  _useColumnStore = false;
 
   _colIdx     = 0;  // querycol = _colIdx[xtreecol]
   _colRole    = 0;  // querycol = _colRole[xtreecol][roleid]
@@ -121,7 +213,12 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   for (int i = 0; i < ROWROLE_COUNT; i++)
     _rowRole[i] = 0;
   _progress = 0;
-  _subtotals = 0;
+  _plan = 0;
+  _moreRowsRequested = false;
+  _idIndexValid = false;
+  _lastSearchRow = 0;
+  _totals = 0;
+  _keepTotals = false;
 
   setUniformRowHeights(true); //#13439 speed improvement if all rows are known to be the same height
   setContextMenuPolicy(Qt::CustomContextMenu);
@@ -142,6 +239,15 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   connect(this,           SIGNAL(itemChanged(QTreeWidgetItem*, int)),                       SLOT(sItemChanged(QTreeWidgetItem*, int)));
   connect(this,           SIGNAL(itemClicked(QTreeWidgetItem*, int)),                       SLOT(sItemClicked(QTreeWidgetItem*, int)));
   connect(&_workingTimer, SIGNAL(timeout()), this, SLOT(populateWorker()));
+  connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(sScrolled(int)));
+  connect(model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,    SLOT(sRowsInserted(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,    SLOT(sRowsAboutToBeRemoved(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this,    SLOT(sDataChanged(const QModelIndex &, const QModelIndex &)));
+  connect(model(), SIGNAL(modelReset()),    this, SLOT(sInvalidateIndex()));
+  connect(model(), SIGNAL(layoutChanged()), this, SLOT(sInvalidateIndex()));
 
   emit valid(FALSE);
   setColumnCount(0);
@@ -173,17 +279,8 @@ XTreeWidget::~XTreeWidget()
   qApp->restoreOverrideCursor();
 
   cleanupAfterPopulate();
-
-  if (_subtotals)
-  {
-    for (int i = 0; i < _subtotals->size(); i++)
-    {
-      delete (*_subtotals)[i];
-      _subtotals->replace(i, 0);
-    }
-    delete _subtotals;
-    _subtotals = 0;
-  }
+  qDeleteAll(_mergeItems);
+  delete _totals;
 
   if (_x_preferences)
   {
@@ -243,11 +340,20 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
 
   pQuery.seek(-1);
 
+  if (popstyle == Merge && _roles.size() <= 0)
+    args._workingPopstyle = popstyle = Replace;
+
   if (popstyle == Replace)
   {
     clear();
     _workingParams.clear();
   }
+  else if (popstyle == Merge)
+  {
+    qDeleteAll(_mergeItems);
+    _mergeItems.clear();
+    _workingParams.clear();
+  }
   _workingParams.append(args);
 
   _linear = _alwaysLinear;
@@ -257,6 +363,355 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
     _workingTimer.start(WORKERINTERVAL);
 }
 
+/* XTreeWidgetRows gives populateWorker() the same view of the rows
+   whether they come from an XSqlQuery or from an XTreeWidgetRecordStream.
+   positions in a stream count every row it was handed, including those
+   release() has already dropped.
+*/
+class XTreeWidgetRows
+{
+  public:
+    XTreeWidgetRows(const XTreeWidgetPopulateParams &args)
+      : _query(args._workingQuery), _stream(args._workingStream.data())
+    {
+    }
+
+    int at() const
+    {
+      if (! _stream)
+        return _query.at();
+      if (_stream->_pos < 0)
+        return QSql::BeforeFirstRow;
+      if (_stream->_pos >= _stream->_base + _stream->_records.size())
+        return QSql::AfterLastRow;
+      return _stream->_pos;
+    }
+
+    bool first()
+    {
+      if (! _stream)
+        return _query.first();
+      if (_stream->_records.isEmpty())
+        return false;
+      _stream->_pos = _stream->_base;
+      return true;
+    }
+
+    // a stream that runs dry waits at the position of the next row
+    bool next()
+    {
+      if (! _stream)
+        return _query.next();
+      if (_stream->_pos + 1 < _stream->_base + _stream->_records.size())
+      {
+        _stream->_pos++;
+        return true;
+      }
+      _stream->_pos = _stream->_base + _stream->_records.size();
+      return false;
+    }
+
+    int count() const
+    {
+      if (! _stream)
+        return _query.count();
+      return _stream->_first.count();
+    }
+
+    int size() const
+    {
+      if (! _stream)
+        return _query.size();
+      return _stream->_finished ? _stream->_base + _stream->_records.size() : 0;
+    }
+
+    QSqlRecord record() const
+    {
+      if (! _stream)
+        return _query.record();
+      return _stream->_first;
+    }
+
+    QVariant value(int i) const
+    {
+      if (! _stream)
+        return _query.value(i);
+      return _stream->_records.at(_stream->_pos - _stream->_base).value(i);
+    }
+
+    /* drop the stream's rows before the current one once populateWorker()
+       has turned them into items, so the result isn't held twice
+    */
+    void release()
+    {
+      if (! _stream)
+        return;
+      int used = qMin(_stream->_pos - _stream->_base, _stream->_records.size());
+      if (used <= 0)
+        return;
+      _stream->_records.erase(_stream->_records.begin(),
+                              _stream->_records.begin() + used);
+      _stream->_base += used;
+    }
+
+    // true if more rows may still arrive
+    bool waiting() const
+    {
+      return _stream && ! _stream->_finished;
+    }
+
+  private:
+    XSqlQuery                _query;
+    XTreeWidgetRecordStream *_stream;
+};
+
+/* XTreeWidgetPopulatePlan is worked out once per query from _colIdx and
+   _colRole so the per-row loop in populateWorker() only visits the roles
+   the query actually returned and doesn't build a QLocale, parse a
+   numeric role name or look up a named color for every cell.
+*/
+class XTreeWidgetPopulatePlan
+{
+  public:
+    struct CellRole {
+      int  field;   // query column holding the value
+      int  role;    // Qt:: or Xt:: role to set on the cell
+      bool color;   // the value is a color name for namedColor()
+    };
+
+    struct Column {
+      int             col;              // tree column
+      int             field;            // query column with the raw value or -1
+      int             displayField;     // 0 for none, like _colRole
+      int             nullField;
+      int             numericField;     // xtnumericrole read for each row
+      int             runningField;
+      int             totalField;
+      int             alignField;
+      int             scale;            // unless numericField says otherwise
+      bool            numeric;
+      bool            scaled;           // numeric, running or total
+      QVariant        alignment;        // header alignment if no alignField
+      QList<CellRole> roles;
+    };
+
+    XTreeWidgetPopulatePlan() : yes(yesStr), no(noStr) {}
+
+    int scale(const QString &numericrole)
+    {
+      QHash<QString, int>::const_iterator it = _scales.constFind(numericrole);
+      if (it != _scales.constEnd())
+        return it.value();
+      int result = decimalPlaces(numericrole);
+      _scales.insert(numericrole, result);
+      return result;
+    }
+
+    QColor color(const QString &name)
+    {
+      QHash<QString, QColor>::const_iterator it = _colors.constFind(name);
+      if (it != _colors.constEnd())
+        return it.value();
+      QColor result = namedColor(name);
+      _colors.insert(name, result);
+      return result;
+    }
+
+    QVector<Column> columns;
+    QLocale         locale;
+    QString         yes;
+    QString         no;
+
+  private:
+    QHash<QString, int>    _scales;
+    QHash<QString, QColor> _colors;
+};
+
+/*!
+  Start populating the tree from rows that will be passed to
+  populateRecords() as they become available, typically from a query
+  running on another thread. Call endPopulate() after the last row.
+  The progress bar is shown immediately so the user can cancel;
+  cancelling emits populateCancelled().
+
+  With \a popstyle Merge the current rows stay on screen until the last
+  row arrives. Then only the rows that were added, removed, changed or
+  moved are updated, which suits periodic refreshes.
+
+  A source that reads its rows a page at a time calls populatePaused()
+  after each page. The tree emits moreRowsWanted() when the user scrolls
+  near the end of the rows it has, and allRowsWanted() when it needs the
+  rest of them to sort or export. setPopulateTotals() supplies the totals
+  of the whole result until then.
+*/
+void XTreeWidget::beginPopulate(int pIndex, bool pUseAltId, PopulateStyle popstyle)
+{
+  XTreeWidgetPopulateParams args;
+  args._workingStream    = QSharedPointer<XTreeWidgetRecordStream>(new XTreeWidgetRecordStream());
+  args._workingIndex     = pIndex;
+  args._workingUseAlt    = pUseAltId;
+  args._workingPopstyle  = popstyle;
+
+  if (popstyle == Merge && _roles.size() <= 0)
+    args._workingPopstyle = popstyle = Replace;
+
+  if (popstyle == Replace)
+  {
+    clear();
+    _workingParams.clear();
+  }
+  else if (popstyle == Merge)
+  {
+    qDeleteAll(_mergeItems);
+    _mergeItems.clear();
+    _workingParams.clear();
+  }
+  _workingParams.append(args);
+  _populateTotals.clear();
+  _moreRowsRequested = false;
+
+  _linear = false;
+  if (! _progress)
+  {
+    _progress = new XTreeWidgetProgress(this);
+    connect(_progress, SIGNAL(cancel()), &_workingTimer, SLOT(stop()));
+    connect(_progress, SIGNAL(cancel()), this, SLOT(sPopulateCancelled()));
+  }
+  _progress->setValue(0);
+  _progress->setMaximum(0);
+  if (popstyle != Merge)  // refresh quietly in place
+    _progress->show();
+}
+
+void XTreeWidget::populateRecords(const QList<QSqlRecord> &records)
+{
+  if (_workingParams.isEmpty() || ! _workingParams.last()._workingStream)
+  {
+    qWarning("%s::populateRecords() called without beginPopulate()",
+             qPrintable(objectName()));
+    return;
+  }
+
+  XTreeWidgetRecordStream *stream = _workingParams.last()._workingStream.data();
+  if (stream->_finished)
+    return;
+
+  if (stream->_base == 0 && stream->_records.isEmpty() && ! records.isEmpty())
+    stream->_first = records.first();
+  stream->_records.append(records);
+  if (! _workingTimer.isActive())
+    _workingTimer.start(WORKERINTERVAL);
+}
+
+/* the rows read so far are all there is until moreRowsWanted() or
+   allRowsWanted() brings more, so stop showing the tree as busy
+*/
+void XTreeWidget::populatePaused()
+{
+  _moreRowsRequested = false;
+  if (_progress)
+    _progress->hide();
+}
+
+/* totals of the whole result keyed by column name, shown in the totals
+   row while a paged source hasn't handed over all of its rows
+*/
+void XTreeWidget::setPopulateTotals(const QVariantMap &totals)
+{
+  _populateTotals = totals;
+  if (! _workingTimer.isActive() && rowsPending() &&
+      _workingParams.last()._workingPopstyle != Merge)
+  {
+    takeTotalRows();
+    populateCalculatedColumns();
+  }
+}
+
+void XTreeWidget::endPopulate()
+{
+  if (_workingParams.isEmpty() || ! _workingParams.last()._workingStream)
+    return;
+
+  _workingParams.last()._workingStream->_finished = true;
+
+  // finish now if the caller expects the tree to be filled on return
+  _linear = _alwaysLinear;
+  if (_linear)
+    populateWorker();
+  else if (! _workingTimer.isActive())
+    _workingTimer.start(WORKERINTERVAL);
+}
+
+// ignore rows that were already on their way when the user cancelled
+void XTreeWidget::sPopulateCancelled()
+{
+  for (int i = 0; i < _workingParams.size(); i++)
+    if (_workingParams.at(i)._workingStream)
+      _workingParams.at(i)._workingStream->_finished = true;
+
+  // a partial merge would remove rows that just weren't read yet
+  if (! _workingParams.isEmpty() && _workingParams.first()._workingPopstyle == Merge)
+  {
+    _workingParams.clear();
+    qDeleteAll(_mergeItems);
+    _mergeItems.clear();
+    cleanupAfterPopulate();
+  }
+
+  emit populateCancelled();
+}
+
+// ask for the next page when the user nears the end of the rows read so far
+void XTreeWidget::sScrolled(int value)
+{
+  if (_moreRowsRequested || ! rowsPending())
+    return;
+
+  QScrollBar *bar = verticalScrollBar();
+  if (value >= bar->maximum() - bar->pageStep())
+  {
+    _moreRowsRequested = true;
+    emit moreRowsWanted();
+  }
+}
+
+// true while populateRecords() may still hand over more rows
+bool XTreeWidget::rowsPending() const
+{
+  return ! _workingParams.isEmpty() &&
+         ! _workingParams.last()._workingStream.isNull() &&
+         ! _workingParams.last()._workingStream->_finished;
+}
+
+/* wait for the rows a paged source hasn't handed over yet, e.g. before
+   exporting. returns false if the user cancelled instead.
+*/
+bool XTreeWidget::fetchAllRows()
+{
+  if (! rowsPending())
+    return true;
+
+  QPointer<XTreeWidget> self(this);
+  QEventLoop loop;
+  connect(this, SIGNAL(populated()),         &loop, SLOT(quit()));
+  connect(this, SIGNAL(populateCancelled()), &loop, SLOT(quit()));
+  if (_progress)
+    _progress->show();
+  emit allRowsWanted();
+  loop.exec();
+
+  return self && _workingParams.isEmpty();
+}
+
+// remove the totals row populateCalculatedColumns() added
+void XTreeWidget::takeTotalRows()
+{
+  QString totalrole("totalrole");
+  for (int i = topLevelItemCount() - 1; i >= 0; i--)
+    if (topLevelItem(i)->data(0, Qt::UserRole).toString() == totalrole)
+      delete takeTopLevelItem(i);
+}
+
 void XTreeWidget::populateWorker()
 {
   if (_workingParams.isEmpty())
@@ -268,10 +723,10 @@ void XTreeWidget::populateWorker()
   }
 
   XTreeWidgetPopulateParams args = _workingParams.first();
-  XSqlQuery     pQuery     = args._workingQuery;
+  XTreeWidgetRows pQuery(args);
   int           pIndex     = args._workingIndex;
   bool          pUseAltId  = args._workingUseAlt;
-  //PopulateStyle popstyle   = args._workingPopstyle;
+  PopulateStyle popstyle   = args._workingPopstyle;
 
   QList<XTreeWidgetItem*> topLevelItems; //#13439
 
@@ -326,13 +781,6 @@ void XTreeWidget::populateWorker()
       for (int ref = 0; ref < _roles.size(); ++ref)
         (*_colRole)[ref] = new int[COLROLE_COUNT];
 
-      if (! _subtotals)
-      {
-        _subtotals = new QList<QMap<int, double> *>();
-        for (int i = 0; i < _fieldCount; i++)
-          _subtotals->append(new QMap<int, double>());
-      }
-
       QSqlRecord  currRecord = pQuery.record();
 
       // apply indent, hidden and delete roles to col 0 if the caller requested them
@@ -421,6 +869,71 @@ void XTreeWidget::populateWorker()
         }
       }
 
+      int defaultScale = decimalPlaces("");
+      _plan = new XTreeWidgetPopulatePlan();
+      for (int wcol = 0; wcol < _roles.size(); wcol++)
+      {
+        if (! _roles.value(wcol))
+          continue;     // warned above
+
+        const int *colrole = (*_colRole)[wcol];
+        XTreeWidgetPopulatePlan::Column column;
+        column.col              = wcol;
+        column.field            = _colIdx->at(wcol);
+        column.displayField     = colrole[COLROLE_DISPLAY];
+        column.nullField        = colrole[COLROLE_NULL];
+        column.numericField     = qMax(colrole[COLROLE_NUMERIC], 0);
+        column.runningField     = colrole[COLROLE_RUNNING];
+        column.totalField       = colrole[COLROLE_TOTAL];
+        column.alignField       = colrole[COLROLE_TEXTALIGNMENT];
+        column.scale            = colrole[COLROLE_NUMERIC] < 0 ?
+                                  0 - colrole[COLROLE_NUMERIC] : defaultScale;
+        column.numeric          = colrole[COLROLE_NUMERIC] != 0;
+        column.scaled           = column.numeric || column.runningField ||
+                                  column.totalField;
+        column.alignment        = headerItem()->textAlignment(wcol);
+
+        const int optional[][3] = {
+          { COLROLE_FOREGROUND,  Qt::ForegroundRole,  true  },
+          { COLROLE_BACKGROUND,  Qt::BackgroundRole,  true  },
+          { COLROLE_TOOLTIP,     Qt::ToolTipRole,     false },
+          { COLROLE_STATUSTIP,   Qt::StatusTipRole,   false },
+          { COLROLE_FONT,        Qt::FontRole,        false },
+          { COLROLE_RUNNINGINIT, Xt::RunningInitRole, false },
+          { COLROLE_ID,          Xt::IdRole,          false }
+        };
+        for (unsigned int i = 0; i < sizeof(optional) / sizeof(optional[0]); i++)
+        {
+          if (colrole[optional[i][0]])
+          {
+            XTreeWidgetPopulatePlan::CellRole cellrole;
+            cellrole.field = colrole[optional[i][0]];
+            cellrole.role  = optional[i][1];
+            cellrole.color = optional[i][2];
+            column.roles.append(cellrole);
+          }
+        }
+        _plan->columns.append(column);
+      }
+
+      /* merged rows keep their own data. a store shared by the few rows
+         that survive a merge would keep every row of that store alive.
+       */
+      if (_useColumnStore && _roles.size() > 0 && popstyle != Merge)
+      {
+        _store = QSharedPointer<XTreeWidgetColumnStore>(new XTreeWidgetColumnStore(_roles.size()));
+        for (int wcol = 0; wcol < _roles.size(); wcol++)
+        {
+          int numeric = (*_colRole)[wcol][COLROLE_NUMERIC];
+          _store->setColumnAlignment(wcol, headerItem()->textAlignment(wcol));
+          _store->setColumnFormat(wcol, numeric < 0 ? 0 - numeric : defaultScale,
+                                  numeric != 0,
+                                  numeric != 0 ||
+                                  (*_colRole)[wcol][COLROLE_RUNNING] ||
+                                  (*_colRole)[wcol][COLROLE_TOTAL]);
+        }
+      }
+
       if (_rowRole[ROWROLE_INDENT])
         setIndentation( 10);
       else
@@ -430,17 +943,18 @@ void XTreeWidget::populateWorker()
       {
         _progress = new XTreeWidgetProgress(this);
         connect(_progress, SIGNAL(cancel()), &_workingTimer, SLOT(stop()));
+        connect(_progress, SIGNAL(cancel()), this, SLOT(sPopulateCancelled()));
       }
       if (_progress)
       {
         _progress->setValue(0);
-        _progress->setMaximum(pQuery.size());
-        _progress->show();
+        _progress->setMaximum(qMax(pQuery.size(), 0));
+        if (popstyle != Merge)
+          _progress->show();
       }
     }
   }
 
-  int defaultScale = decimalPlaces("");
   int cnt = 0;
 
   if (pQuery.at() >= 0) // if the query returned any rows at all
@@ -449,8 +963,9 @@ void XTreeWidget::populateWorker()
       ++cnt;
       if (!_linear && cnt % WORKERROWS == 0)
       {
-        this->addTopLevelItems(topLevelItems); //#13439
+        addPopulatedItems(topLevelItems, popstyle); //#13439
         _progress->setValue(pQuery.at());
+        pQuery.release();
         return;
       }
 
@@ -477,6 +992,11 @@ void XTreeWidget::populateWorker()
       QObject *parentItem = 0;
       XTreeWidgetItem *previousItem = _last;
       _last = new XTreeWidgetItem((XTreeWidgetItem*)0, id, altId);
+      if (_store)
+      {
+        _last->_store    = _store;
+        _last->_storeRow = _store->appendRow();
+      }
 
       if (indent == 0)
         parentItem = this;
@@ -511,106 +1031,120 @@ void XTreeWidget::populateWorker()
       }
 
       bool allNull = (indent > 0);
-      for (int col = 0; col < _roles.size(); col++)
+      bool deleted = _rowRole[ROWROLE_DELETED] &&
+                     pQuery.value(_rowRole[ROWROLE_DELETED]).toBool();
+      if (DEBUG && _rowRole[ROWROLE_DELETED])
+        qDebug("%s::populate() found xtdeleterole, value = %d",
+                qPrintable(objectName()), deleted);
+
+      for (int c = 0; c < _plan->columns.size(); c++)
       {
-        QVariantMap *role = _roles.value(col);
-        if (!role)
-        {
-          qWarning("XTreeWidget::populate() there is no role for column %d", col);
-          continue;
-        }
+        const XTreeWidgetPopulatePlan::Column &column = _plan->columns.at(c);
+        int col = column.col;
 
         QVariant rawValue;
-        if(_colIdx->at(col) >=0)  //#13439 optimization - only try to retrieve value if index is valid
-          rawValue = pQuery.value(_colIdx->at(col));
+        if (column.field >= 0)  //#13439 optimization - only try to retrieve value if index is valid
+          rawValue = pQuery.value(column.field);
 
-        _last->setData(col, Xt::RawRole, rawValue);
+        if (_store)
+          _store->setRaw(_last->_storeRow, col, rawValue);
+        else
+          _last->setData(col, Xt::RawRole, rawValue);
 
-        // TODO: this isn't necessary for all columns so do less often?
-        int     scale        = defaultScale;
-        QString numericrole  = "";
-        if ((*_colRole)[col][COLROLE_NUMERIC])
+        int     scale   = column.scale;
+        QString numericrole;
+        bool    percent = false;
+        if (column.numericField)
         {
-          // Negative NUMERIC ROLE => default for column instead of column index
-          // see above
-          if ((*_colRole)[col][COLROLE_NUMERIC] < 0)
-            scale = 0 - (*_colRole)[col][COLROLE_NUMERIC];
-          else
+          numericrole = pQuery.value(column.numericField).toString();
+          scale       = _plan->scale(numericrole);
+          percent     = (numericrole == "percent" || numericrole == "scrap");
+        }
+
+        QVariant display;
+        if (column.displayField)
+          display = pQuery.value(column.displayField);
+
+        if (_store)
+        {
+          // the store formats the display value when the view asks for it
+          if (column.numericField)
           {
-            numericrole  = pQuery.value((*_colRole)[col][COLROLE_NUMERIC]).toString();
-            scale        = decimalPlaces(numericrole);
+            _store->setRole(_last->_storeRow, col, Xt::ScaleRole, scale);
+            if (percent)
+              _store->setRole(_last->_storeRow, col,
+                              XTreeWidgetColumnStore::NumericRoleRole, numericrole);
           }
+          if (! display.isNull())
+            _store->setRole(_last->_storeRow, col,
+                            XTreeWidgetColumnStore::DisplayValueRole, display);
+          else if (rawValue.isNull() && column.nullField)
+            _store->setRole(_last->_storeRow, col,
+                            XTreeWidgetColumnStore::NullTextRole,
+                            pQuery.value(column.nullField));
         }
-
-        if ((*_colRole)[col][COLROLE_NUMERIC] ||
-            (*_colRole)[col][COLROLE_RUNNING] ||
-            (*_colRole)[col][COLROLE_TOTAL])
-          _last->setData(col, Xt::ScaleRole, scale);
-
-        /* if qtdisplayrole IS NULL then let the raw value shine through.
-           this allows UNIONS to do interesting things, like put dates and
-           text into the same visual column without SQL errors.
-        */
-        if ((*_colRole)[col][COLROLE_DISPLAY] &&
-            !pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull())
+        else
         {
-          /* this might not handle PostgreSQL NUMERICs properly
-             but at least it will try to handle INTEGERs and DOUBLEs
-             and it will avoid formatting sales order numbers with decimal
-             and group separators
+          if (column.scaled)
+            _last->setData(col, Xt::ScaleRole, scale);
+
+          /* if qtdisplayrole IS NULL then let the raw value shine through.
+             this allows UNIONS to do interesting things, like put dates and
+             text into the same visual column without SQL errors.
           */
-          QVariant field = pQuery.value((*_colRole)[col][COLROLE_DISPLAY]);
-          if (field.type() == QVariant::Int)
+          if (! display.isNull())
+          {
+            /* this might not handle PostgreSQL NUMERICs properly
+               but at least it will try to handle INTEGERs and DOUBLEs
+               and it will avoid formatting sales order numbers with decimal
+               and group separators
+            */
+            if (display.type() == QVariant::Int)
+              _last->setData(col, Qt::DisplayRole,
+                            _plan->locale.toString(display.toInt()));
+            else if (display.type() == QVariant::Double)
+              _last->setData(col, Qt::DisplayRole,
+                            _plan->locale.toString(display.toDouble(),
+                                                   'f', scale));
+            else
+              _last->setData(col, Qt::DisplayRole, display.toString());
+          }
+          else if (rawValue.isNull())
+          {
+            _last->setData(col, Qt::DisplayRole,
+                          column.nullField ?
+                          pQuery.value(column.nullField).toString() : "");
+          }
+          else if (percent)
+          {
             _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(field.toInt()));
-          else if (field.type() == QVariant::Double)
+                            _plan->locale.toString(rawValue.toDouble() * 100.0,
+                                                   'f', scale));
+          }
+          else if (column.numeric || rawValue.type() == QVariant::Double)
+          {
+            // Issue #8897
             _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(field.toDouble(),
-                                             'f', scale));
+                            _plan->locale.toString(round(rawValue.toDouble(), scale),
+                                                   'f', scale));
+          }
+          else if (rawValue.type() == QVariant::Bool)
+          {
+            _last->setData(col, Qt::DisplayRole,
+                          rawValue.toBool() ? _plan->yes : _plan->no);
+          }
           else
-            _last->setData(col, Qt::DisplayRole, field.toString());
-        }
-        else if (rawValue.isNull())
-        {
-          _last->setData(col, Qt::DisplayRole,
-                        (*_colRole)[col][COLROLE_NULL] ?
-                        pQuery.value((*_colRole)[col][COLROLE_NULL]).toString() :
-                        "");
-        }
-        else if ((*_colRole)[col][COLROLE_NUMERIC] &&
-                 ((numericrole == "percent") ||
-                  (numericrole == "scrap")))
-        {
-          _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(rawValue.toDouble() * 100.0,
-                                           'f', scale));
-        }
-        else if ((*_colRole)[col][COLROLE_NUMERIC] || rawValue.type() == QVariant::Double)
-        {
-          // Issue #8897
-          _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(round(rawValue.toDouble(), scale),
-                                           'f', scale));
-        }
-        else if (rawValue.type() == QVariant::Bool)
-        {
-          _last->setData(col, Qt::DisplayRole,
-                        rawValue.toBool() ? yesStr : noStr);
-        }
-        else
-        {
-          _last->setData(col, Qt::EditRole, rawValue);
+          {
+            _last->setData(col, Qt::EditRole, rawValue);
+          }
         }
 
         if (indent)
         {
-          if (!(*_colRole)[col][COLROLE_DISPLAY] ||
-              ((*_colRole)[col][COLROLE_DISPLAY] &&
-               pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull()))
+          if (display.isNull())
             allNull &= (rawValue.isNull() || rawValue.toString().isEmpty());
           else
-            allNull &= pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull() ||
-                       pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).toString().isEmpty();
+            allNull &= display.toString().isEmpty();
 
           if (DEBUG)
             qDebug("%s::populate() allNull = %d at %d for rawValue %s",
@@ -618,111 +1152,54 @@ void XTreeWidget::populateWorker()
                     qPrintable( rawValue.toString()));
         }
 
-        if ((*_colRole)[col][COLROLE_FOREGROUND])
-        {
-          QVariant fg = pQuery.value((*_colRole)[col][COLROLE_FOREGROUND]);
-          if (!fg.isNull())
-            _last->setData(col, Qt::ForegroundRole, namedColor(fg.toString()));
-        }
-
-        if ((*_colRole)[col][COLROLE_BACKGROUND])
-        {
-          QVariant bg = pQuery.value((*_colRole)[col][COLROLE_BACKGROUND]);
-          if (!bg.isNull())
-            _last->setData(col, Qt::BackgroundRole, namedColor(bg.toString()));
-        }
-
-        if ((*_colRole)[col][COLROLE_TEXTALIGNMENT])
+        if (column.alignField)
         {
-          QVariant alignment = pQuery.value((*_colRole)[col][COLROLE_TEXTALIGNMENT]);
+          QVariant alignment = pQuery.value(column.alignField);
           if (!alignment.isNull())
-            _last->setData(col, Qt::TextAlignmentRole, alignment);
-        }
-        else
-          _last->setData(col, Qt::TextAlignmentRole, headerItem()->textAlignment(col));
-
-        if ((*_colRole)[col][COLROLE_TOOLTIP])
-        {
-          QVariant tooltip = pQuery.value((*_colRole)[col][COLROLE_TOOLTIP]);
-          if (!tooltip.isNull() )
-            _last->setData(col, Qt::ToolTipRole, tooltip);
-        }
-
-        if ((*_colRole)[col][COLROLE_STATUSTIP])
-        {
-          QVariant statustip = pQuery.value((*_colRole)[col][COLROLE_STATUSTIP]);
-          if (!statustip.isNull())
-            _last->setData(col, Qt::StatusTipRole, statustip);
+            setCellData(col, Qt::TextAlignmentRole, alignment);
         }
+        else if (! _store)
+          _last->setData(col, Qt::TextAlignmentRole, column.alignment);
 
-        if ((*_colRole)[col][COLROLE_FONT])
+        for (int r = 0; r < column.roles.size(); r++)
         {
-          QVariant font = pQuery.value((*_colRole)[col][COLROLE_FONT]);
-          if (!font.isNull())
-            _last->setData(col, Qt::FontRole, font);
-        }
-
-        if ((*_colRole)[col][COLROLE_RUNNINGINIT])
-        {
-          QVariant runninginit = pQuery.value((*_colRole)[col][COLROLE_RUNNINGINIT]);
-          if (!runninginit.isNull())
-            _last->setData(col, Xt::RunningInitRole, runninginit);
-        }
-
-        if ((*_colRole)[col][COLROLE_ID])
-        {
-          QVariant id = pQuery.value((*_colRole)[col][COLROLE_ID]);
-          if (!id.isNull())
-            _last->setData(col, Xt::IdRole, id);
+          const XTreeWidgetPopulatePlan::CellRole &cellrole = column.roles.at(r);
+          QVariant value = pQuery.value(cellrole.field);
+          if (value.isNull())
+            continue;
+          if (cellrole.color)
+            setCellData(col, cellrole.role, _plan->color(value.toString()));
+          else
+            setCellData(col, cellrole.role, value);
         }
 
-        if ((*_colRole)[col][COLROLE_RUNNING])
+        if (column.runningField)
         {
-          int set = pQuery.value((*_colRole)[col][COLROLE_RUNNING]).toInt();
-          _last->setData(col, Xt::RunningSetRole, set);
-          /* performance hack - populateCalculatedColumns will repeat this
-             but only redraw if necessary. redraw is much slower than recalc. */
-          if (! _subtotals->at(col)->contains(set))
-          {
-            if ((*_colRole)[col][COLROLE_RUNNINGINIT])
-              (*_subtotals)[col]->insert(set, pQuery.value((*_colRole)[col][COLROLE_RUNNINGINIT]).toDouble());
-            else
-              (*_subtotals)[col]->insert(set, 0.0);
-          }
-          (*(*_subtotals)[col])[set] += rawValue.toDouble();
-          _last->setData(col, Qt::DisplayRole,
-                         QLocale().toString((*_subtotals)[col]->value(set), 'f', scale));
+          int set = pQuery.value(column.runningField).toInt();
+          setCellData(col, Xt::RunningSetRole, set);
         }
 
-        if ((*_colRole)[col][COLROLE_TOTAL])
+        if (column.totalField)
         {
-          _last->setData(col, Xt::TotalSetRole,
-                        pQuery.value((*_colRole)[col][COLROLE_TOTAL]).toInt());
+          setCellData(col, Xt::TotalSetRole,
+                      pQuery.value(column.totalField).toInt());
         }
 
-        if (_rowRole[ROWROLE_DELETED])
+        if (deleted)
         {
-          if (DEBUG)
-            qDebug("%s::populate() found xtdeleterole, value = %s",
-                    qPrintable( objectName()),
-                    qPrintable( pQuery.value(_rowRole[ROWROLE_DELETED]).toString()));
-          if (pQuery.value(_rowRole[ROWROLE_DELETED]).toBool())
-          {
-            _last->setData(col,Xt::DeletedRole, QVariant(true));
-            QFont font = _last->font(col);
-            font.setStrikeOut(true);
-            _last->setFont(col, font);
-            _last->setTextColor(Qt::gray);
-          }
+          _last->setData(col,Xt::DeletedRole, QVariant(true));
+          QFont font = _last->font(col);
+          font.setStrikeOut(true);
+          _last->setFont(col, font);
+          _last->setTextColor(Qt::gray);
         }
-        /*
-        if ((*_colRole)[col][COLROLE_KEY])
-          _last->setData(col, KeyRole, pQuery.value((*_colRole)[col][COLROLE_KEY]));
-        if ((*_colRole)[col][COLROLE_GROUPRUNNING])
-          _last->setData(col, GroupRunningRole, pQuery.value((*_colRole)[col][COLROLE_GROUPRUNNING]));
-        */
       }
 
+      // QTreeWidgetItem::columnCount() only counts columns with item data
+      if (_store && _roles.size() > 0)
+        _last->setData(_roles.size() - 1, Xt::RawRole,
+                       _store->raw(_last->_storeRow, _roles.size() - 1));
+
       if (allNull && indent > 0)
       {
         qWarning("%s::populate() hiding indented row because it's empty",
@@ -743,9 +1220,28 @@ void XTreeWidget::populateWorker()
 
     } while (pQuery.next());
 
-  this->addTopLevelItems(topLevelItems); //#13439
+  addPopulatedItems(topLevelItems, popstyle); //#13439
+
+  // wait for populateRecords() or endPopulate() to restart the timer
+  if (pQuery.waiting())
+  {
+    pQuery.release();
+    _workingTimer.stop();
+    if (! _populateTotals.isEmpty() && popstyle != Merge)
+    {
+      takeTotalRows();          // keep the totals row below the new rows
+      populateCalculatedColumns();
+    }
+    if (_linear)
+      qApp->restoreOverrideCursor();
+    return;
+  }
 
-  setId(pIndex);
+  // a merge keeps the current item if it's still there
+  if (popstyle == Merge)
+    mergePopulatedItems();
+  else
+    setId(pIndex);
   emit valid(currentItem() != 0);
 
   // clean up. we won't reach here until the query is done, even if ! _linear
@@ -757,8 +1253,15 @@ void XTreeWidget::populateWorker()
 
     cleanupAfterPopulate();
 
+    // every row is here to total now, including any added to the old ones
+    if (! _populateTotals.isEmpty() || popstyle == Append)
+    {
+      _populateTotals.clear();
+      takeTotalRows();
+    }
     populateCalculatedColumns();
-    if (sortColumn() >= 0 && header()->isSortIndicatorShown())
+    if (popstyle != Merge &&    // merged rows are already in sort order
+        sortColumn() >= 0 && header()->isSortIndicatorShown())
       sortItems(sortColumn(), header()->sortIndicatorOrder());
 
     if (DEBUG)
@@ -779,6 +1282,10 @@ void XTreeWidget::cleanupAfterPopulate()
     _rowRole[i] = 0;
 
   _last = 0;
+  _store.clear();
+
+  delete _plan;
+  _plan = 0;
 
   // TODO: get rid of this when the code is rewritten
   //       as per above's todo about the QVector<int*>
@@ -800,6 +1307,26 @@ void XTreeWidget::cleanupAfterPopulate()
   _fieldCount = 0;
 }
 
+/* store a value for a cell of the row being populated, either in the
+   column store or directly on the item
+*/
+void XTreeWidget::setCellData(int col, int role, const QVariant &value)
+{
+  if (_store)
+    _store->setRole(_last->_storeRow, col, role, value);
+  else
+    _last->setData(col, role, value);
+}
+
+// a merge holds new rows aside until all of them have been read
+void XTreeWidget::addPopulatedItems(const QList<XTreeWidgetItem *> &items, PopulateStyle popstyle)
+{
+  if (popstyle == Merge)
+    _mergeItems.append(items);
+  else
+    addTopLevelItems(items);
+}
+
 void XTreeWidget::addColumn(const QString &pString, int pWidth, int pAlignment, bool pVisible, const QString pEditColumn, const QString pDisplayColumn, const int scale)
 {
   if (!_settingsLoaded)
@@ -1073,6 +1600,145 @@ bool XTreeWidgetItem::operator>(const XTreeWidgetItem &other) const
   return !(this < other || this == other);
 }
 */
+/* XTreeWidgetSortKey holds the sort value for one top level item,
+   extracted once per sort so comparisons don't have to go back to the
+   QVariant in Xt::RawRole. The ordering mirrors XTreeWidgetItem::operator<
+   with two refinements that make it a strict weak ordering:
+   NULLs sort before everything else and, for strings, nonzero numbers
+   sort before text.
+*/
+class XTreeWidgetSortKey
+{
+  public:
+    enum KeyType { NullKey, BoolKey, NumberKey, LongLongKey,
+                   DateTimeKey, StringKey };
+
+    XTreeWidgetSortKey() : type(NullKey), rank(0), number(0.0),
+                           longlong(0), seq(0), item(0) {}
+
+    KeyType          type;
+    int              rank;
+    double           number;
+    qlonglong        longlong;
+    QDateTime        datetime;
+    QString          string;
+    int              seq;
+    XTreeWidgetItem *item;
+
+    void setValue(const QVariant &v)
+    {
+      if (v.isNull() && v.type() != QVariant::String)
+      {
+        type = NullKey;
+        return;
+      }
+      switch (v.type())
+      {
+        case QVariant::Bool:
+          type   = BoolKey;
+          number = v.toBool() ? 1 : 0;
+          break;
+        case QVariant::Date:
+          type     = DateTimeKey;
+          datetime = QDateTime(v.toDate());
+          break;
+        case QVariant::DateTime:
+          type     = DateTimeKey;
+          datetime = v.toDateTime();
+          break;
+        case QVariant::Double:
+        case QVariant::Int:
+          type   = NumberKey;
+          number = v.toDouble();
+          break;
+        case QVariant::LongLong:
+          type     = LongLongKey;
+          longlong = v.toLongLong();
+          break;
+        case QVariant::String:
+          type   = StringKey;
+          string = v.toString();
+          number = string.toDouble();
+          rank   = (number == 0.0) ? 1 : 0;
+          break;
+        default:
+          type = NullKey;
+      }
+    }
+};
+
+static bool sortKeyLessThan(const XTreeWidgetSortKey &a, const XTreeWidgetSortKey &b)
+{
+  if (a.type != b.type)
+    return a.type < b.type;
+
+  switch (a.type)
+  {
+    case XTreeWidgetSortKey::BoolKey:
+    case XTreeWidgetSortKey::NumberKey:
+      return a.number < b.number;
+    case XTreeWidgetSortKey::LongLongKey:
+      return a.longlong < b.longlong;
+    case XTreeWidgetSortKey::DateTimeKey:
+      return a.datetime < b.datetime;
+    case XTreeWidgetSortKey::StringKey:
+      if (a.rank != b.rank)
+        return a.rank < b.rank;
+      if (a.rank == 0)
+        return a.number < b.number;
+      return a.string < b.string;
+    default:
+      return false;
+  }
+}
+
+/* ties keep their original relative order in both directions */
+static bool sortKeyAscending(const XTreeWidgetSortKey &a, const XTreeWidgetSortKey &b)
+{
+  if (sortKeyLessThan(a, b))
+    return true;
+  if (sortKeyLessThan(b, a))
+    return false;
+  return a.seq < b.seq;
+}
+
+static bool sortKeyDescending(const XTreeWidgetSortKey &a, const XTreeWidgetSortKey &b)
+{
+  if (sortKeyLessThan(b, a))
+    return true;
+  if (sortKeyLessThan(a, b))
+    return false;
+  return a.seq < b.seq;
+}
+
+/* sort items by their raw value in column, keeping ties in their
+   original order
+*/
+static QList<QTreeWidgetItem *> sortedItems(const QList<QTreeWidgetItem *> &items,
+                                            int column, Qt::SortOrder order)
+{
+  QVector<XTreeWidgetSortKey> keys;
+  keys.reserve(items.size());
+  for (int i = 0; i < items.size(); i++)
+  {
+    XTreeWidgetSortKey key;
+    key.setValue(items.at(i)->data(column, Xt::RawRole));
+    key.seq  = i;
+    key.item = items.at(i);
+    keys.append(key);
+  }
+
+  std::stable_sort(keys.begin(), keys.end(),
+                   order == Qt::AscendingOrder ? sortKeyAscending
+                                               : sortKeyDescending);
+
+  QList<QTreeWidgetItem *> sorted;
+  sorted.reserve(keys.size());
+  for (int i = 0; i < keys.size(); i++)
+    sorted.append(keys.at(i).item);
+  return sorted;
+}
+
 void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 {
   int previd = id();
@@ -1090,177 +1756,391 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 
   header()->setSortIndicator(column, order);
 
-  // simple insertion sort using binary search to find the right insertion pt
+  /* a tree that is still reading rows sorts them once it has them all.
+     a paged source only sends the rest when asked.
+   */
+  if (rowsPending())
+  {
+    if (_progress && _workingParams.last()._workingPopstyle != Merge)
+      _progress->show();
+    emit allRowsWanted();
+    return;
+  }
+
+  /* take all of the top level items out at once, extract their sort keys,
+     sort the keys, then put the items back in a single batch.
+     moving items one at a time costs a model update per move.
+   */
   QString totalrole("totalrole");
-  int     itemcount      = topLevelItemCount();
-  XTreeWidgetItem *prev  = dynamic_cast<XTreeWidgetItem *>(topLevelItem(0));
-  for (int i = 1; i < itemcount; i++)
+  _keepTotals = true;   // the same rows come back, only their order changes
+  QList<QTreeWidgetItem *> taken = QTreeWidget::invisibleRootItem()->takeChildren();
+  _keepTotals = false;
+
+  QList<QTreeWidgetItem *> items;
+  QList<QTreeWidgetItem *> others;      // kept after the sorted rows
+  items.reserve(taken.size());
+  for (int i = 0; i < taken.size(); i++)
   {
-    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(topLevelItem(i));
+    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(taken.at(i));
     if (!item)
     {
-      qWarning("removing a non-XTreWidgetItem from an XTreeWidget");
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
+      qWarning("not sorting a non-XTreeWidgetItem in an XTreeWidget");
+      others.append(taken.at(i));
+      continue;
     }
     else if (item->data(0, Qt::UserRole).toString() == totalrole)
     {
       if (DEBUG)
         qDebug("sortItems() removing row %d because it's a totalrole", i);
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
+      delete item;
+      continue;
     }
-    else if (*item < *prev && order == Qt::AscendingOrder)
+    items.append(item);
+  }
+
+  _keepTotals = true;
+  QTreeWidget::addTopLevelItems(sortedItems(items, column, order) + others);
+  _keepTotals = false;
+
+  populateCalculatedColumns();
+
+  setId(previd);
+  emit resorted();
+}
+
+/* rows are matched by id, altId, and how many rows before them had the
+   same id and altId
+*/
+static QString mergeKey(const QTreeWidgetItem *item, QHash<QString, int> &seen)
+{
+  const XTreeWidgetItem *xitem = dynamic_cast<const XTreeWidgetItem *>(item);
+  QString key = xitem ? QString("%1:%2").arg(xitem->id()).arg(xitem->altId())
+                      : QString();
+  return key + ":" + QString::number(seen[key]++);
+}
+
+/* true if two rows, including their children, would look and behave the
+   same. running totals are left out because populateCalculatedColumns()
+   recalculates them after the merge.
+*/
+bool XTreeWidget::sameRow(const QTreeWidgetItem *a, const QTreeWidgetItem *b) const
+{
+  static const int roles[] = {
+    Qt::DisplayRole,     Qt::TextAlignmentRole, Qt::BackgroundRole,
+    Qt::ForegroundRole,  Qt::ToolTipRole,       Qt::StatusTipRole,
+    Qt::FontRole,        Xt::RawRole,           Xt::ScaleRole,
+    Xt::IdRole,          Xt::RunningSetRole,    Xt::RunningInitRole,
+    Xt::TotalSetRole,    Xt::IndentRole,        Xt::DeletedRole
+  };
+
+  if (a->isHidden() != b->isHidden() || a->childCount() != b->childCount())
+    return false;
+
+  for (int col = 0; col < columnCount(); col++)
+  {
+    bool running = headerItem()->data(col, Qt::UserRole).toString() == "xtrunningrole";
+    for (unsigned int r = 0; r < sizeof(roles) / sizeof(roles[0]); r++)
     {
-      int left   = 0;
-      int right  = i;
-      int middle = 0;
-      XTreeWidgetItem *test = 0;
-      while (left <= right)
-      {
-        middle = (left + right) / 2;
-        test   = static_cast<XTreeWidgetItem *>(topLevelItem(middle));
-        if (*test == *item)
-          break;
-        else if (*test < *item)
-        {
-          if (*item < *(static_cast<XTreeWidgetItem *>(topLevelItem(middle + 1))))
-            break;
-          else
-            left = middle + 1;
-        }
-        else
-          right = middle - 1;
-      }
-      // can't call takeTopLevelItem() until after < and == are done
-      if (*item < *test || *item == *test)
-      {
-        if (DEBUG)
-          qDebug("<= so moving %d to %d", i, middle);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle, item);
-      }
-      else
-      {
-        if (DEBUG)
-          qDebug("> so moving %d to %d", i, middle + 1);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle + 1, item);
-      }
+      if (running && roles[r] == Qt::DisplayRole)
+        continue;
+      if (a->data(col, roles[r]) != b->data(col, roles[r]))
+        return false;
     }
-    else if (*item == *prev)
+  }
+
+  for (int i = 0; i < a->childCount(); i++)
+    if (! sameRow(a->child(i), b->child(i)))
+      return false;
+
+  return true;
+}
+
+/* replace the top level items with the rows collected by a Merge populate,
+   touching only the rows that were added, removed, changed or moved.
+   unchanged rows stay in the tree, so the scroll position, selection and
+   expanded state survive the refresh and the view repaints only what
+   changed.
+*/
+void XTreeWidget::mergePopulatedItems()
+{
+  QList<QTreeWidgetItem *> incoming;
+  incoming.reserve(_mergeItems.size());
+  for (int i = 0; i < _mergeItems.size(); i++)
+    incoming.append(_mergeItems.at(i));
+  _mergeItems.clear();
+
+  int col = sortColumn();
+  if (col >= 0 && col < columnCount() && header()->isSortIndicatorShown() &&
+      headerItem()->data(col, Qt::UserRole).toString() != "xtrunningrole")
+    incoming = sortedItems(incoming, col, header()->sortIndicatorOrder());
+
+  QString totalrole("totalrole");
+  QHash<QString, QTreeWidgetItem *> current;
+  QHash<QString, int>               seen;
+  for (int i = 0; i < QTreeWidget::topLevelItemCount(); i++)
+  {
+    QTreeWidgetItem *item = QTreeWidget::topLevelItem(i);
+    if (item->data(0, Qt::UserRole).toString() != totalrole)
+      current.insert(mergeKey(item, seen), item);
+  }
+
+  QSet<QTreeWidgetItem *> wasSelected = QTreeWidget::selectedItems().toSet();
+  QTreeWidgetItem        *wasCurrent  = QTreeWidget::currentItem();
+  QTreeWidgetItem        *newCurrent  = 0;
+  QSet<QTreeWidgetItem *> selected;
+  QSet<QTreeWidgetItem *> expanded;
+
+  QList<QTreeWidgetItem *> target;
+  QSet<QTreeWidgetItem *>  kept;
+  target.reserve(incoming.size());
+  seen.clear();
+  for (int i = 0; i < incoming.size(); i++)
+  {
+    QTreeWidgetItem *item = incoming.at(i);
+    QTreeWidgetItem *old  = current.value(mergeKey(item, seen));
+    if (old && sameRow(old, item))
     {
-      ; // nothing to do - make the > case easier to write
+      delete item;
+      item = old;
+      kept.insert(item);
     }
-    else if (!(*item < *prev) && order == Qt::DescendingOrder)
+    target.append(item);
+
+    if (old)  // carry the state of the old row over to the new one
     {
-      int left   = 0;
-      int right  = i;
-      int middle = 0;
-      XTreeWidgetItem *test = 0;
-      while (left <= right)
-      {
-        middle = (left + right) / 2;
-        test   = static_cast<XTreeWidgetItem *>(topLevelItem(middle));
-        if (*test == *item)
-          break;
-        else if (!(*test < *item))
-        {
-          if (!(*item < *(static_cast<XTreeWidgetItem *>(topLevelItem(middle + 1)))))
-            break;
-          else
-            left = middle + 1;
-        }
-        else
-          right = middle - 1;
-      }
-      // can't call takeTopLevelItem() until after < and == are done
-      if (!(*item < *test) || *item == *test)
-      {
-        if (DEBUG)
-          qDebug(">= so moving %d to %d", i, middle);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle, item);
-      }
-      else
-      {
-        if (DEBUG)
-          qDebug("< so moving %d to %d", i, middle + 1);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle + 1, item);
-      }
+      if (wasSelected.contains(old))
+        selected.insert(item);
+      if (old->childCount() > 0 && old->isExpanded())
+        expanded.insert(item);
+      if (old == wasCurrent)
+        newCurrent = item;
     }
-    // can't reuse item because the thing in position i may have changed
-    prev = static_cast<XTreeWidgetItem *>(topLevelItem(i));
   }
 
-  populateCalculatedColumns();
+  for (int i = QTreeWidget::topLevelItemCount() - 1; i >= 0; i--)
+    if (! kept.contains(QTreeWidget::topLevelItem(i)))
+      delete QTreeWidget::takeTopLevelItem(i);
 
-  setId(previd);
-  emit resorted();
+  for (int i = 0; i < target.size(); )
+  {
+    QTreeWidgetItem *item = target.at(i);
+    if (QTreeWidget::topLevelItem(i) == item)
+      i++;
+    else if (kept.contains(item))
+    {
+      QTreeWidget::takeTopLevelItem(QTreeWidget::indexOfTopLevelItem(item));
+      QTreeWidget::insertTopLevelItem(i, item);
+      i++;
+    }
+    else
+    {
+      QList<QTreeWidgetItem *> added;
+      while (i + added.size() < target.size() &&
+             ! kept.contains(target.at(i + added.size())))
+        added.append(target.at(i + added.size()));
+      QTreeWidget::insertTopLevelItems(i, added);
+      i += added.size();
+    }
+  }
+
+  foreach (QTreeWidgetItem *item, expanded)
+    if (! item->isExpanded())
+      item->setExpanded(true);
+  foreach (QTreeWidgetItem *item, selected)
+    if (! item->isSelected())
+      item->setSelected(true);
+  if (newCurrent && QTreeWidget::currentItem() != newCurrent)
+    selectionModel()->setCurrentIndex(indexFromItem(newCurrent),
+                                      QItemSelectionModel::NoUpdate);
 }
 
 void XTreeWidget::populateCalculatedColumns()
 {
-  QMap<int, QMap<int, double> > totals; // <col <totalset, subtotal> >
-  QMap<int, int> scales;                // keep scale for the col, not col[totalset]
-  for (int col = 0; topLevelItem(0) &&
-       col < topLevelItem(0)->columnCount(); col++)
+  if (! _totals)
+    _totals = new XTreeWidgetTotals();
+  XTreeWidgetTotals &engine = *_totals;
+
+  QVector<XTreeWidgetTotals::Column> columns;
+  for (int col = 0; col < columnCount(); col++)
+  {
+    QString role = headerItem()->data(col, Qt::UserRole).toString();
+    if (role == "xtrunningrole" || role == "xttotalrole")
+    {
+      XTreeWidgetTotals::Column column;
+      column.col     = col;
+      column.running = (role == "xtrunningrole");
+      columns.append(column);
+    }
+  }
+
+  int count = QTreeWidget::topLevelItemCount();
+  if (columns.isEmpty() || count == 0)
+  {
+    engine.invalidate();
+    engine.columns = columns;
+    return;
+  }
+
+  bool sameColumns = engine.valid && columns.size() == engine.columns.size();
+  for (int c = 0; sameColumns && c < columns.size(); c++)
+    sameColumns = columns.at(c).col     == engine.columns.at(c).col &&
+                  columns.at(c).running == engine.columns.at(c).running;
+  if (! sameColumns)
+  {
+    engine.invalidate();
+    engine.columns = columns;
+  }
+
+  // rows ahead of the first one that was moved, added or removed keep
+  // their cached values and running balances
+  QVector<QTreeWidgetItem *> rows(count);
+  for (int row = 0; row < count; row++)
+    rows[row] = QTreeWidget::topLevelItem(row);
+
+  int first = 0;
+  while (first < count && first < engine.rows.size() &&
+         rows.at(first) == engine.rows.at(first))
+    first++;
+
+  QVector<int> from(count - first, -1);       // old position or -1 if new
+  for (int row = first; row < count; row++)
+    from[row - first] = engine.rowIndex.value(rows.at(row), -1);
+
+  for (int row = first; row < engine.rows.size(); row++)
+    engine.rowIndex.remove(engine.rows.at(row));
+  for (int row = first; row < count; row++)
+    engine.rowIndex.insert(rows.at(row), row);
+
+  _keepTotals = true;   // our own changes don't invalidate the cache
+  for (int c = 0; c < engine.columns.size(); c++)
   {
-    if (headerItem()->data(col, Qt::UserRole).toString() == "xtrunningrole")
+    XTreeWidgetTotals::Column &column = engine.columns[c];
+    XTreeWidgetTotals::Column  old    = column;
+    column.value.resize(count);
+    column.init.resize(count);
+    column.set.resize(count);
+    column.scales.resize(count);
+    column.balance.resize(count);
+
+    for (int row = first; row < count; row++)
+    {
+      int oldrow = from.at(row - first);
+      if (oldrow >= 0)
+      {
+        column.value[row]   = old.value.at(oldrow);
+        column.init[row]    = old.init.at(oldrow);
+        column.set[row]     = old.set.at(oldrow);
+        column.scales[row]  = old.scales.at(oldrow);
+        column.balance[row] = old.balance.at(oldrow);
+        continue;
+      }
+
+      XTreeWidgetTotals::read(column, row, rows.at(row));
+    }
+
+    column.clearSums();
+    if (column.running)
     {
-      QMap<int, double> subtotals;
-      // assume that Xt::RunningSetRole exists if xtrunningrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
+      for (int row = 0; row < first; row++)
+        column.accumulate(row);
+      for (int row = first; row < count; row++)
       {
-        int set = topLevelItem(row)->data(col, Xt::RunningSetRole).toInt();
-        if (!subtotals.contains(set))
-          subtotals[set] = topLevelItem(row)->data(col, Xt::RunningInitRole).toDouble();
-        subtotals[set] += topLevelItem(row)->data(col, Xt::RawRole).toDouble();
-
-        // setData apparently knows if the value hasn't changed
-        topLevelItem(row)->setData(col, Qt::DisplayRole,
-                                   QLocale().toString(subtotals[set], 'f',
-                                                      topLevelItem(row)->data(col, Xt::ScaleRole).toInt()));
+        double balance = column.accumulate(row);
+        if (from.at(row - first) >= 0 && balance == column.balance.at(row))
+          continue;
+        column.balance[row] = balance;
+        rows.at(row)->setData(column.col, Qt::DisplayRole,
+                              QLocale().toString(balance, 'f',
+                                                 column.scales.at(row)));
       }
     }
-    else if (headerItem()->data(col, Qt::UserRole).toString() == "xttotalrole")
+    else
     {
-      QMap<int, double> totalset;
-      int colscale = -99999;
-      // assume that Xt::TotalSetRole exists if xttotalrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
+      column.scale = -99999;
+      for (int row = 0; row < count; row++)
       {
-        int set = topLevelItem(row)->data(col, Xt::TotalSetRole).toInt();
-        if (!totalset.contains(set))
-          totalset[set] = topLevelItem(row)->data(col, Xt::TotalInitRole).toInt();
-        totalset[set] += topLevelItem(row)->totalForItem(col, set);
-        if (topLevelItem(row)->data(col, Xt::ScaleRole).toInt() > colscale)
-          colscale = topLevelItem(row)->data(col, Xt::ScaleRole).toInt();
+        column.accumulate(row);
+        if (column.scales.at(row) > column.scale)
+          column.scale = column.scales.at(row);
       }
-      totals.insert(col, totalset);
-      scales.insert(col, colscale);
     }
   }
 
-  // punt: for now only report values of totalset[0] for each totaled col
-  // TODO: figure out how to handle multiple totalsets
-  if (totals.size() > 0)
+  engine.rows  = rows;
+  engine.valid = true;
+
+  // one totals row for each total set, in set order
+  QList<int> sets;
+  int        totalColumns = 0;
+  for (int c = 0; c < engine.columns.size(); c++)
+  {
+    const XTreeWidgetTotals::Column &column = engine.columns.at(c);
+    if (column.running)
+      continue;
+    totalColumns++;
+    for (int s = 0; s < column.setIds.size(); s++)
+      if (! sets.contains(column.setIds.at(s)))
+        sets.append(column.setIds.at(s));
+  }
+  qSort(sets);
+
+  for (int s = 0; s < sets.size(); s++)
   {
-    XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1,
-                                                (totals.size() == 1) ? tr("Total") : tr("Totals"));
+    QString label = (totalColumns == 1) ? tr("Total") : tr("Totals");
+    if (sets.size() > 1)
+      label = ((totalColumns == 1) ? tr("Total %1") : tr("Totals %1")).arg(sets.at(s));
+
+    XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1, label);
     last->setData(0, Qt::UserRole, "totalrole");
-    QMapIterator<int, QMap<int, double> > it(totals);
-    while (it.hasNext())
+    for (int c = 0; c < engine.columns.size(); c++)
     {
-      it.next();
-      last->setData(it.key(), Qt::DisplayRole,
-                    QLocale().toString(it.value().value(0), 'f',
-                                       scales.value(it.key())));
+      const XTreeWidgetTotals::Column &column = engine.columns.at(c);
+      int slot = column.setIds.indexOf(sets.at(s));
+      if (column.running || slot < 0)
+        continue;
+
+      double total = column.sums.at(slot);
+      // a paged tree may not have all of the rows it totals yet
+      QVariantMap *role = _roles.value(column.col);
+      if (sets.at(s) == 0 && role &&
+          _populateTotals.contains(role->value("qteditrole").toString()))
+        total = _populateTotals.value(role->value("qteditrole").toString()).toDouble();
+      last->setData(column.col, Qt::DisplayRole,
+                    QLocale().toString(total, 'f', column.scale));
     }
   }
+  _keepTotals = false;
+}
+
+/*!
+  Returns the total of \a column for \a totalSet, or the closing balance
+  of \a totalSet if \a column has a running total. The values are those
+  shown when the list was last populated or sorted.
+*/
+double XTreeWidget::total(int column, int totalSet) const
+{
+  return totals(column).value(QString::number(totalSet)).toDouble();
+}
+
+/*!
+  Returns the totals of \a column, or its closing running balances, keyed
+  by total set.
+*/
+QVariantMap XTreeWidget::totals(int column) const
+{
+  QVariantMap result;
+  if (! _totals)
+    return result;
+
+  for (int c = 0; c < _totals->columns.size(); c++)
+  {
+    const XTreeWidgetTotals::Column &col = _totals->columns.at(c);
+    if (col.col != column)
+      continue;
+    for (int s = 0; s < col.setIds.size(); s++)
+      result.insert(QString::number(col.setIds.at(s)), col.sums.at(s));
+  }
+  return result;
 }
 
 int XTreeWidget::id() const
@@ -1314,18 +2194,7 @@ void XTreeWidget::setId(int pId, bool pClear)
   else
     flag = QItemSelectionModel::Select;
 
-  XTreeWidgetItem *item  = (XTreeWidgetItem *)topLevelItem(0);
-  QTreeWidgetItem *found = 0;
-  while (item)
-  {
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      break;
-    item = (XTreeWidgetItem *)itemBelow(item);
-  }
+  XTreeWidgetItem *found = indexedItem(pId, ShownSubtrees);
   if (found)
   {
     scrollToItem(found);
@@ -1336,53 +2205,297 @@ void XTreeWidget::setId(int pId, bool pClear)
   }
 }
 
-// This is a static local function to help searching children recursively
-QTreeWidgetItem *searchChildren(XTreeWidgetItem *parent, int pId)
+/*!
+Selects a row with a matching values \a pId and \a pAltId on the first and second columns
+respectively in the result set. If \a pClear is true then any previous selections are cleared.
+*/
+void XTreeWidget::setId(int pId, int pAltId, bool pClear)
+{
+  if (pId < 0)
+    return;
+
+  QItemSelectionModel::SelectionFlag flag;
+  if (pClear)
+    flag = QItemSelectionModel::ClearAndSelect;
+  else
+    flag = QItemSelectionModel::Select;
+
+  XTreeWidgetItem *found = indexedItem(pId, ShownRows, true, pAltId);
+  if (found)
+    selectionModel()->setCurrentIndex(indexFromItem(found),
+                                      flag |
+                                      QItemSelectionModel::Rows);
+}
+
+/* XTreeWidget keeps an id -> item index so setId() and
+   findXTreeWidgetItemWithId() don't have to walk the tree. It's built
+   the first time it's needed and kept up to date from the model's signals
+   after that. Inserted items are only indexed at the next lookup because
+   an XTreeWidgetItem joins the tree before its constructor sets its id.
+*/
+void XTreeWidget::updateIdIndex()
+{
+  if (! _idIndexValid)
+  {
+    _idIndex.clear();
+    _indexedIds.clear();
+    _unindexed.clear();
+    for (int i = 0; i < QTreeWidget::topLevelItemCount(); i++)
+      _unindexed.insert(QTreeWidget::topLevelItem(i));
+    _idIndexValid = true;
+  }
+
+  foreach (QTreeWidgetItem *item, _unindexed)
+    indexItem(item);
+  _unindexed.clear();
+}
+
+void XTreeWidget::indexItem(QTreeWidgetItem *item)
+{
+  XTreeWidgetItem *xitem = dynamic_cast<XTreeWidgetItem *>(item);
+  if (xitem && ! _indexedIds.contains(item))
+  {
+    _idIndex.insert(xitem->_id, item);
+    _indexedIds.insert(item, xitem->_id);
+  }
+  for (int i = 0; i < item->childCount(); i++)
+    indexItem(item->child(i));
+}
+
+// called as items leave the tree, maybe from their destructors
+void XTreeWidget::unindexItem(QTreeWidgetItem *item)
+{
+  QHash<QTreeWidgetItem *, int>::iterator it = _indexedIds.find(item);
+  if (it != _indexedIds.end())
+  {
+    _idIndex.remove(it.value(), item);
+    _indexedIds.erase(it);
+  }
+  _unindexed.remove(item);
+  _searchText.remove(item);
+
+  for (int i = 0; i < item->childCount(); i++)
+    unindexItem(item->child(i));
+}
+
+// row numbers from the top of the tree down to the item
+static QList<int> treePath(const QTreeWidget *tree, const QTreeWidgetItem *item)
+{
+  QList<int> path;
+  for (; item->parent(); item = item->parent())
+    path.prepend(item->parent()->indexOfChild(const_cast<QTreeWidgetItem *>(item)));
+  path.prepend(tree->indexOfTopLevelItem(const_cast<QTreeWidgetItem *>(item)));
+  return path;
+}
+
+/* true if \a item is on screen, i.e. the user could scroll to it: neither
+   it nor any of its parents is hidden and all of its parents are expanded
+*/
+static bool isShownRow(const QTreeWidgetItem *item)
+{
+  for (; item; item = item->parent())
+    if (item->isHidden() || (item->parent() && ! item->parent()->isExpanded()))
+      return false;
+  return true;
+}
+
+/* the first item in tree order with id \a pId, and \a pAltId if
+   \a pUseAltId is true. if \a pAncestor is given only its descendants
+   are considered. \a pScope keeps the lookups that used to walk the
+   visible rows with itemBelow() or indexBelow() to the rows they found:
+   ShownRows only matches rows on screen, ShownSubtrees also matches the
+   collapsed or hidden children of a top level row that isn't hidden, and
+   AllItems matches every item.
+*/
+XTreeWidgetItem *XTreeWidget::indexedItem(int pId, IndexScope pScope,
+                                          bool pUseAltId, int pAltId,
+                                          const QTreeWidgetItem *pAncestor)
+{
+  updateIdIndex();
+
+  XTreeWidgetItem *found     = 0;
+  QList<int>       foundPath;
+  for (QMultiHash<int, QTreeWidgetItem *>::const_iterator it = _idIndex.constFind(pId);
+       it != _idIndex.constEnd() && it.key() == pId; ++it)
+  {
+    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(it.value());
+    if (! item || (pUseAltId && item->_altId != pAltId))
+      continue;
+
+    if (pScope == ShownRows && ! isShownRow(item))
+      continue;
+    else if (pScope == ShownSubtrees)
+    {
+      const QTreeWidgetItem *top = item;
+      while (top->parent())
+        top = top->parent();
+      if (top->isHidden())
+        continue;
+    }
+
+    if (pAncestor)
+    {
+      const QTreeWidgetItem *parent = item->parent();
+      while (parent && parent != pAncestor)
+        parent = parent->parent();
+      if (! parent)
+        continue;
+    }
+
+    // several rows can share an id. this is rare so sort them out here.
+    if (! found)
+      found = item;
+    else
+    {
+      if (foundPath.isEmpty())
+        foundPath = treePath(this, found);
+      QList<int> path = treePath(this, item);
+      if (std::lexicographical_compare(path.begin(), path.end(),
+                                       foundPath.begin(), foundPath.end()))
+      {
+        found     = item;
+        foundPath = path;
+      }
+    }
+  }
+
+  return found;
+}
+
+void XTreeWidget::sRowsInserted(const QModelIndex &parent, int first, int last)
 {
-  if (!parent)
-    return 0;
+  _lastSearch.clear();
+  if (_totals && ! _keepTotals && parent.isValid())
+    _totals->invalidate();     // a row's children count toward its total
 
-  XTreeWidgetItem *item  = 0;
-  QTreeWidgetItem *found = 0;
-  for (int i = 0; i < parent->childCount(); ++i)
+  if (! _idIndexValid)
+    return;
+
+  for (int row = first; row <= last; row++)
+    _unindexed.insert(itemFromIndex(model()->index(row, 0, parent)));
+}
+
+void XTreeWidget::sRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+  _lastSearch.clear();
+
+  /* a removed row may be deleted and its address reused by a new row, so
+     forget what the totals engine knew about it. the totals rows it adds
+     itself don't count.
+   */
+  if (_totals && _totals->valid && ! _keepTotals)
   {
-    item = (XTreeWidgetItem *)parent->child(i);
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      return found;
+    for (int row = first; row <= last && _totals->valid; row++)
+      if (parent.isValid() ||
+          _totals->rowIndex.contains(itemFromIndex(model()->index(row, 0, parent))))
+        _totals->invalidate();
   }
-  return 0;
+
+  if (! _idIndexValid && _searchText.isEmpty())
+    return;
+
+  for (int row = first; row <= last; row++)
+    unindexItem(itemFromIndex(model()->index(row, 0, parent)));
 }
 
-/*!
-Selects a row with a matching values \a pId and \a pAltId on the first and second columns
-respectively in the result set. If \a pClear is true then any previous selections are cleared.
+void XTreeWidget::sDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+  if (_totals && ! _keepTotals)
+    updateTotals(topLeft, bottomRight);
+
+  // an edited row may now match, or stop matching, the last search
+  _lastSearch.clear();
+  if (_searchText.isEmpty())
+    return;
+
+  for (int row = topLeft.row(); row <= bottomRight.row(); row++)
+    _searchText.remove(itemFromIndex(topLeft.sibling(row, 0)));
+}
+
+/* re-read the edited cells of the total and running total columns and
+   recalculate the totals from the cached values of every other cell
 */
-void XTreeWidget::setId(int pId, int pAltId, bool pClear)
+void XTreeWidget::updateTotals(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-  if (pId < 0)
+  XTreeWidgetTotals &engine = *_totals;
+  if (! engine.valid)
     return;
 
-  QItemSelectionModel::SelectionFlag flag;
-  if (pClear)
-    flag = QItemSelectionModel::ClearAndSelect;
-  else
-    flag = QItemSelectionModel::Select;
+  QList<int> changed;
+  for (int c = 0; c < engine.columns.size(); c++)
+    if (engine.columns.at(c).col >= topLeft.column() &&
+        engine.columns.at(c).col <= bottomRight.column())
+      changed.append(c);
+  if (changed.isEmpty())
+    return;
 
-  for (QModelIndex i = indexFromItem(topLevelItem(0)); i.isValid(); i = indexBelow(i))
+  QString    totalrole("totalrole");
+  QList<int> rows;
+  for (int r = topLeft.row(); r <= bottomRight.row(); r++)
   {
-    XTreeWidgetItem *item = (XTreeWidgetItem *)itemFromIndex(i);
-    if (item && item->id() == pId && item->altId() == pAltId)
+    // a child counts toward its top level row's total
+    QTreeWidgetItem *item = itemFromIndex(topLeft.sibling(r, 0));
+    while (item && item->parent())
+      item = item->parent();
+    if (! item || item->data(0, Qt::UserRole).toString() == totalrole)
+      continue;
+
+    int row = engine.rowIndex.value(item, -1);
+    if (row < 0)
     {
-      selectionModel()->setCurrentIndex(i,
-                                        flag |
-                                        QItemSelectionModel::Rows);
+      engine.invalidate();
       return;
     }
+    if (! rows.contains(row))
+      rows.append(row);
+  }
+  if (rows.isEmpty())
+    return;
+
+  qSort(rows);
+  _keepTotals = true;   // our own changes don't invalidate the cache
+  for (int c = 0; c < changed.size(); c++)
+  {
+    XTreeWidgetTotals::Column &column = engine.columns[changed.at(c)];
+    for (int r = 0; r < rows.size(); r++)
+      XTreeWidgetTotals::read(column, rows.at(r), engine.rows.at(rows.at(r)));
+
+    // balances change from the first edited row down
+    if (column.running)
+    {
+      column.clearSums();
+      for (int row = 0; row < engine.rows.size(); row++)
+      {
+        double balance = column.accumulate(row);
+        if (row < rows.first() || balance == column.balance.at(row))
+          continue;
+        column.balance[row] = balance;
+        engine.rows.at(row)->setData(column.col, Qt::DisplayRole,
+                                     QLocale().toString(balance, 'f',
+                                                        column.scales.at(row)));
+      }
+    }
   }
+  _keepTotals = false;
+
+  /* no row has moved, so this only sums the cached values again and
+     redraws the totals rows
+   */
+  takeTotalRows();
+  populateCalculatedColumns();
+}
+
+// rebuild the indexes from scratch the next time they're used
+void XTreeWidget::sInvalidateIndex()
+{
+  _idIndexValid = false;
+  _idIndex.clear();
+  _indexedIds.clear();
+  _unindexed.clear();
+  _searchText.clear();
+  _lastSearch.clear();
+  if (_totals)
+    _totals->invalidate();
 }
 
 QString XTreeWidget:: dragString() const { return _dragString; }
@@ -1403,22 +2516,32 @@ void XTreeWidget::setPopulateLinear(bool alwaysLinear)
   _alwaysLinear = alwaysLinear;
 }
 
+/*!
+  Returns true if populate() keeps cell data in a shared, column-major
+  XTreeWidgetColumnStore instead of on each XTreeWidgetItem.
+*/
+bool XTreeWidget::columnStore() const { return _useColumnStore; }
+
+/*!
+  Make populate() keep cell data in a shared, column-major store with
+  display strings formatted on demand. This greatly reduces memory use and
+  fill time for large result sets. Items still answer data(), rawValue(),
+  id() and altId() as before, and values set explicitly on an item take
+  precedence over the stored ones.
+*/
+void XTreeWidget::setColumnStore(bool useColumnStore)
+{
+  _useColumnStore = useColumnStore;
+}
+
 void XTreeWidget::clear()
 {
   if (DEBUG)
     qDebug("%s::clear()", qPrintable(objectName()));
   if (! _workingTimer.isActive())
     _workingParams.clear();
-  if (_subtotals)
-  {
-    for (int i = 0; i < _subtotals->size(); i++)
-    {
-      delete (*_subtotals)[i];
-      _subtotals->replace(i, 0);
-    }
-    delete _subtotals;
-    _subtotals = 0;
-  }
+  qDeleteAll(_mergeItems);
+  _mergeItems.clear();
   emit valid(FALSE);
   _savedId = false; // was -1;
 
@@ -1567,39 +2690,54 @@ void XTreeWidget::sExport()
 
   if (!fi.filePath().isEmpty())
   {
-    QTextDocument       *doc = new QTextDocument();
-    QTextDocumentWriter writer;
     if (fi.suffix().isEmpty())
       fi.setFile(fi.filePath() += defaultSuffix);
     xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
-    writer.setFileName(fi.filePath());
 
-    if (fi.suffix() == "txt")
-    {
-      doc->setPlainText(toTxt());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "csv")
-    {
-      doc->setPlainText(toCsv());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "vcf")
+    // export every row, not just the ones paged in. a vcard holds only
+    // the selected contact
+    if (fi.suffix() != "vcf" && ! fetchAllRows())
+      return;
+
+    QFile file(fi.filePath());
+    if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
-      doc->setPlainText(toVcf());
-      writer.setFormat("plaintext");
+      QMessageBox::critical(this, tr("Export Failed"),
+                            tr("Could not open %1 for writing: %2")
+                            .arg(fi.filePath(), file.errorString()));
+      return;
     }
-    else if (fi.suffix() == "odt")
+
+    // rows are written straight to the file as they're formatted
+    bool    ok = true;
+    QString errmsg;
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    if (fi.suffix() == "vcf")
     {
-      doc->setHtml(toHtml());
-      writer.setFormat("odf");
+      ok     = file.write(toVcf().toUtf8()) >= 0;
+      errmsg = file.errorString();
     }
-    else if (fi.suffix() == "html")
+    else
     {
-      doc->setHtml(toHtml());
-      writer.setFormat("HTML");
+      XTreeWidgetExporter::Format format = XTreeWidgetExporter::Text;
+      if (fi.suffix() == "csv")
+        format = XTreeWidgetExporter::Csv;
+      else if (fi.suffix() == "odt")
+        format = XTreeWidgetExporter::Odt;
+      else if (fi.suffix() == "html")
+        format = XTreeWidgetExporter::Html;
+
+      XTreeWidgetExporter exporter(this);
+      ok     = exporter.write(&file, format);
+      errmsg = exporter.errorString();
     }
-    writer.write(doc);
+    file.close();
+    qApp->restoreOverrideCursor();
+
+    if (! ok)
+      QMessageBox::critical(this, tr("Export Failed"),
+                            tr("Could not write %1: %2")
+                            .arg(fi.filePath(), errmsg));
   }
 }
 
@@ -1797,6 +2935,9 @@ XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidget *ptree
   if (pid < 0)
     return 0;
 
+  if (ptree == this)
+    return indexedItem(pid, AllItems);
+
   for (int i = 0; i < ptree->topLevelItemCount(); i++)
   {
     XTreeWidgetItem *item = ptree->topLevelItem(i);
@@ -1818,6 +2959,9 @@ XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidgetItem *p
   if (pid < 0)
     return 0;
 
+  if (ptreeitem->treeWidget() == this)
+    return indexedItem(pid, AllItems, false, -1, ptreeitem);
+
   for (int i = 0; i < ptreeitem->childCount(); i++)
   {
     XTreeWidgetItem *item = ptreeitem->child(i);
@@ -1882,10 +3026,21 @@ XTreeWidgetItem::XTreeWidgetItem( XTreeWidgetItem *pParent, XTreeWidgetItem *itm
   constructor(pId, pAltId, v0, v1, v2, v3, v4, v5, v6, v7, v8, v9, v10);
 }
 
+void XTreeWidgetItem::setId(int pId)
+{
+  _id = pId;
+
+  // the tree indexes its items by id
+  XTreeWidget *tree = qobject_cast<XTreeWidget *>(treeWidget());
+  if (tree)
+    tree->_idIndexValid = false;
+}
+
 void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1, QVariant v2,QVariant v3, QVariant v4,QVariant v5, QVariant v6,QVariant v7, QVariant v8,QVariant v9, QVariant v10 )
 {
-  _id    = pId;
-  _altId = pAltId;
+  _id       = pId;
+  _altId    = pAltId;
+  _storeRow = -1;
 
   if (!v0.isNull())
     setText(0,  v0);
@@ -1962,6 +3117,14 @@ QVariant XTreeWidgetItem::rawValue(const QString pName)
     return data(colIdx, Xt::RawRole);
 }
 
+QVariant XTreeWidgetItem::data(int colidx, int role) const
+{
+  QVariant value = QTreeWidgetItem::data(colidx, role);
+  if (_store && ! value.isValid())
+    return _store->value(_storeRow, colidx, role);
+  return value;
+}
+
 /* Calculate the total for a particular XTreeWidgetItem, including any children.
    pcol is the column for which we want the total.
    prole is the value of xttotalrole for which we want the total.
@@ -1978,6 +3141,232 @@ double XTreeWidgetItem::totalForItem(const int pcol, const int pset) const
   return total;
 }
 
+// XTreeWidgetColumnStore ////////////////////////////////////////////////////
+
+XTreeWidgetColumnStore::XTreeWidgetColumnStore(int columns)
+  : _columns(columns),
+    _rows(0)
+{
+}
+
+int XTreeWidgetColumnStore::appendRow()
+{
+  return _rows++;
+}
+
+void XTreeWidgetColumnStore::setColumnAlignment(int col, const QVariant &alignment)
+{
+  _columns[col].alignment = alignment;
+}
+
+/* scale is the default number of decimal places for the column,
+   numeric is true if the column has an xtnumericrole,
+   showScale is true if Xt::ScaleRole should be reported for the column
+*/
+void XTreeWidgetColumnStore::setColumnFormat(int col, int scale, bool numeric, bool showScale)
+{
+  _columns[col].scale     = scale;
+  _columns[col].numeric   = numeric;
+  _columns[col].showScale = showScale;
+}
+
+void XTreeWidgetColumnStore::setRaw(int row, int col, const QVariant &value)
+{
+  Column &c = _columns[col];
+
+  ColumnType type;
+  switch (value.type())
+  {
+    case QVariant::Bool:      type = Bool;     break;
+    case QVariant::Int:
+    case QVariant::UInt:      type = Int;      break;
+    case QVariant::LongLong:
+    case QVariant::ULongLong: type = LongLong; break;
+    case QVariant::Double:    type = Double;   break;
+    case QVariant::Date:      type = Date;     break;
+    case QVariant::DateTime:  type = DateTime; break;
+    case QVariant::String:    type = String;   break;
+    default:                  type = Generic;
+  }
+
+  if (c.type == Unknown)
+  {
+    c.nullType = value.type();
+    if (! value.isNull())
+      c.type = type;
+  }
+  else if (c.type != Generic && type != c.type && ! value.isNull())
+    makeGeneric(col);
+
+  if (c.type == Generic)
+  {
+    if (c.variants.size() <= row)
+      c.variants.resize(row + 1);
+    c.variants[row] = value;
+    return;
+  }
+
+  if (value.isNull())
+  {
+    if (c.nulls.size() <= row)
+      c.nulls.resize(row + 1);
+    c.nulls.setBit(row);
+    return;
+  }
+
+  switch (c.type)
+  {
+    case Bool:
+    case Double:
+      if (c.numbers.size() <= row)
+        c.numbers.resize(row + 1);
+      c.numbers[row] = (c.type == Bool) ? (value.toBool() ? 1.0 : 0.0)
+                                        : value.toDouble();
+      break;
+    case Int:
+    case LongLong:
+      if (c.integers.size() <= row)
+        c.integers.resize(row + 1);
+      c.integers[row] = value.toLongLong();
+      break;
+    case Date:
+    case DateTime:
+      if (c.datetimes.size() <= row)
+        c.datetimes.resize(row + 1);
+      c.datetimes[row] = value.toDateTime();
+      break;
+    case String:
+      if (c.strings.size() <= row)
+        c.strings.resize(row + 1);
+      c.strings[row] = value.toString();
+      break;
+    default:
+      break;
+  }
+}
+
+/* the query returned different types for the same column (UNIONs can do
+   this), so fall back to storing the QVariants themselves
+*/
+void XTreeWidgetColumnStore::makeGeneric(int col)
+{
+  QVector<QVariant> variants(_rows);
+  for (int row = 0; row < _rows; row++)
+    variants[row] = raw(row, col);
+
+  Column &c = _columns[col];
+  c.variants = variants;
+  c.numbers.clear();
+  c.integers.clear();
+  c.datetimes.clear();
+  c.strings.clear();
+  c.nulls.clear();
+  c.type = Generic;
+}
+
+void XTreeWidgetColumnStore::setRole(int row, int col, int role, const QVariant &value)
+{
+  QVector<QVariant> &values = _columns[col].roles[role];
+  if (values.size() <= row)
+    values.resize(row + 1);
+  values[row] = value;
+}
+
+QVariant XTreeWidgetColumnStore::raw(int row, int col) const
+{
+  if (col < 0 || col >= _columns.size() || row < 0)
+    return QVariant();
+
+  const Column &c = _columns.at(col);
+  if (c.type == Generic)
+    return row < c.variants.size() ? c.variants.at(row) : QVariant();
+
+  if (c.type == Unknown || (row < c.nulls.size() && c.nulls.testBit(row)))
+    return QVariant(c.nullType);
+
+  switch (c.type)
+  {
+    case Bool:
+      return row < c.numbers.size() ? QVariant(c.numbers.at(row) != 0.0) : QVariant(c.nullType);
+    case Double:
+      return row < c.numbers.size() ? QVariant(c.numbers.at(row)) : QVariant(c.nullType);
+    case Int:
+      return row < c.integers.size() ? QVariant((int)c.integers.at(row)) : QVariant(c.nullType);
+    case LongLong:
+      return row < c.integers.size() ? QVariant(c.integers.at(row)) : QVariant(c.nullType);
+    case Date:
+      return row < c.datetimes.size() ? QVariant(c.datetimes.at(row).date()) : QVariant(c.nullType);
+    case DateTime:
+      return row < c.datetimes.size() ? QVariant(c.datetimes.at(row)) : QVariant(c.nullType);
+    case String:
+      return row < c.strings.size() ? QVariant(c.strings.at(row)) : QVariant(c.nullType);
+    default:
+      return QVariant();
+  }
+}
+
+QVariant XTreeWidgetColumnStore::value(int row, int col, int role) const
+{
+  if (col < 0 || col >= _columns.size() || row < 0)
+    return QVariant();
+
+  const Column &c = _columns.at(col);
+  QHash<int, QVector<QVariant> >::const_iterator it = c.roles.constFind(role);
+  if (it != c.roles.constEnd() && row < it.value().size() &&
+      it.value().at(row).isValid())
+    return it.value().at(row);
+
+  switch (role)
+  {
+    case Xt::RawRole:
+      return raw(row, col);
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+      return display(row, col);
+    case Qt::TextAlignmentRole:
+      return c.alignment;
+    case Xt::ScaleRole:
+      return c.showScale ? QVariant(c.scale) : QVariant();
+    default:
+      return QVariant();
+  }
+}
+
+// keep in sync with the display formatting in XTreeWidget::populateWorker()
+QVariant XTreeWidgetColumnStore::display(int row, int col) const
+{
+  const Column &c = _columns.at(col);
+
+  int scale = c.scale;
+  QVariant rowscale = value(row, col, Xt::ScaleRole);
+  if (rowscale.isValid())
+    scale = rowscale.toInt();
+
+  QVariant field = value(row, col, DisplayValueRole);
+  if (field.isValid() && ! field.isNull())
+  {
+    if (field.type() == QVariant::Int)
+      return QLocale().toString(field.toInt());
+    else if (field.type() == QVariant::Double)
+      return QLocale().toString(field.toDouble(), 'f', scale);
+    return field.toString();
+  }
+
+  QVariant rawValue = raw(row, col);
+  if (rawValue.isNull())
+    return value(row, col, NullTextRole).toString();
+
+  QString numericrole = value(row, col, NumericRoleRole).toString();
+  if (c.numeric && (numericrole == "percent" || numericrole == "scrap"))
+    return QLocale().toString(rawValue.toDouble() * 100.0, 'f', scale);
+  else if (c.numeric || rawValue.type() == QVariant::Double)
+    return QLocale().toString(round(rawValue.toDouble(), scale), 'f', scale);
+  else if (rawValue.type() == QVariant::Bool)
+    return rawValue.toBool() ? yesStr : noStr;
+
+  return rawValue;
+}
+
 QScriptValue XTreeWidgetItemtoScriptValue(QScriptEngine *engine, XTreeWidgetItem *const &item)
 {
   return engine->newQObject(item);
@@ -2131,6 +3520,7 @@ void setupXTreeWidget(QScriptEngine *engine)
 
   glob.setProperty("Replace", QScriptValue(engine, XTreeWidget::Replace), QScriptValue::ReadOnly | QScriptValue::Undeletable);
   glob.setProperty("Append",  QScriptValue(engine, XTreeWidget::Append), QScriptValue::ReadOnly | QScriptValue::Undeletable);
+  glob.setProperty("Merge",   QScriptValue(engine, XTreeWidget::Merge), QScriptValue::ReadOnly | QScriptValue::Undeletable);
 
   glob.setProperty("itemColumn",     QScriptValue(engine, _itemColumn),    QScriptValue::ReadOnly | QScriptValue::Undeletable);
   glob.setProperty("whsColumn",      QScriptValue(engine, _whsColumn),     QScriptValue::ReadOnly | QScriptValue::Undeletable);
@@ -2160,63 +3550,27 @@ Q_DECLARE_METATYPE(XTreeWidget *)
 
 void XTreeWidget::sCopyRowToClipboard()
 {
-  QMimeData         *mime      = new QMimeData();
-  QClipboard        *clipboard = QApplication::clipboard();
-  QTextDocument     *doc       = new QTextDocument();
-  QTextCursor       *cursor    = new QTextCursor(doc);
-  QTextTableFormat  tableFormat;
-  QTextTableCell    cell;
-  QTextCharFormat   format;
-  QString color;
-  QString font;
-  XTreeWidgetItem *item  = currentItem();
-  int     counter;
-  int     colcnt         = 0;
+  XTreeWidgetItem *item = currentItem();
+  if (! item)
+    return;
+
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  XTreeWidgetExporter exporter(this);
+  exporter.setIncludeHeader(false);
+  exporter.setItems(QList<QTreeWidgetItem *>() << item);
 
+  QClipboard *clipboard = QApplication::clipboard();
   if (_x_preferences->boolean("CopyListsPlainText"))
   {
-    QString line = "";
-    for (int counter = 0; counter < item->columnCount(); counter++)
-    {
-      if (!QTreeWidget::isColumnHidden(counter))
-        line = line + item->text(counter) + "\t";
-    }
-    clipboard->setText(line);
-    return;
+    exporter.write(&buffer, XTreeWidgetExporter::Text);
+    clipboard->setText(QString::fromUtf8(buffer.data()));
   }
-
-  cursor->insertTable(1, 1,tableFormat);
-  if (item)
+  else
   {
-    for (counter = 0; counter < item->columnCount(); counter++)
-    {
-      if (!QTreeWidget::isColumnHidden(counter))
-      {
-        colcnt++;
-        if (colcnt > 1)
-        {
-          cursor->currentTable()->appendColumns(1);
-          cursor->movePosition(QTextCursor::NextCell);
-        }
-        cell   = cursor->currentTable()->cellAt(cursor->position());
-        format = cell.format();
-        if (item->data(counter, Qt::BackgroundRole).isValid())
-          format.setBackground(item->data(counter, Qt::BackgroundRole).value<QColor>());
-        if (item->data(counter, Qt::ForegroundRole).isValid())
-          format.setForeground(item->data(counter, Qt::ForegroundRole).value<QColor>());
-
-        if (item->data(counter,Qt::FontRole).isValid())
-        {
-          font = item->data(counter,Qt::FontRole).toString();
-          if (!font.isEmpty())
-            format.setFont(QFont(font));
-        }
-
-        cell.setFormat(format);
-        cursor->insertText(item->text(counter));
-      }
-    }
-    mime->setHtml(doc->toHtml());
+    QMimeData *mime = new QMimeData();
+    exporter.write(&buffer, XTreeWidgetExporter::Html);
+    mime->setHtml(QString::fromUtf8(buffer.data()));
     clipboard->setMimeData(mime);
   }
 }
@@ -2254,28 +3608,72 @@ void XTreeWidget::sCopyCellToClipboard()
   }
 }
 
+/* the rows are written as UTF-8 straight into the buffer the clipboard
+   keeps, without building a QString of the whole list first
+*/
 void XTreeWidget::sCopyVisibleToClipboard()
 {
   QMimeData   *mime      = new QMimeData();
   QClipboard  *clipboard = QApplication::clipboard();
+  bool         plain     = _x_preferences->boolean("CopyListsPlainText");
 
-  if (_x_preferences->boolean("CopyListsPlainText"))
-    mime->setText(toTxt());
-  else
-    mime->setHtml(toHtml());
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  XTreeWidgetExporter exporter(this);
+  exporter.write(&buffer, plain ? XTreeWidgetExporter::Text
+                                : XTreeWidgetExporter::Html);
+  buffer.close();
+
+  mime->setData(plain ? "text/plain" : "text/html", buffer.data());
   clipboard->setMimeData(mime);
 }
 
+/* the case-folded text of the item's visible columns, worked out the first
+   time the item is searched and kept until the item changes
+*/
+QString XTreeWidget::searchText(QTreeWidgetItem *item)
+{
+  QHash<QTreeWidgetItem *, QString>::const_iterator it = _searchText.constFind(item);
+  if (it != _searchText.constEnd())
+    return it.value();
+
+  QStringList texts;
+  for (int i = 0; i < _searchColumns.size(); i++)
+    texts << item->text(_searchColumns.at(i)).toCaseFolded();
+  QString text = texts.join("\n");       // so a match can't span columns
+  _searchText.insert(item, text);
+  return text;
+}
+
 void XTreeWidget::sSearch(const QString &pTarget)
 {
   clearSelection();
-  int i;
-  for (i = 0; i < topLevelItemCount(); i++)
+
+  QList<int> columns;
+  for (int col = 0; col < columnCount(); col++)
+    if (! isColumnHidden(col))
+      columns.append(col);
+  if (columns != _searchColumns)
+  {
+    _searchColumns = columns;
+    _searchText.clear();
+    _lastSearch.clear();
+  }
+
+  /* a row that contains the target also contains the start of it, so as
+     the user types ahead the search can resume from the last match
+   */
+  QString target = pTarget.toCaseFolded();
+  int i = 0;
+  if (! _lastSearch.isEmpty() && target.startsWith(_lastSearch))
+    i = _lastSearchRow;
+  for (; i < topLevelItemCount(); i++)
   {
-    // Currently this only looks at the first column
-    if (topLevelItem(i)->text(0).contains(pTarget, Qt::CaseInsensitive))
+    if (searchText(QTreeWidget::topLevelItem(i)).contains(target))
       break;
   }
+  _lastSearch    = target;
+  _lastSearchRow = i;
 
   if (i < topLevelItemCount())
   {
@@ -2284,94 +3682,24 @@ void XTreeWidget::sSearch(const QString &pTarget)
   }
 }
 
-QString XTreeWidget::toTxt() const
+/* write the visible rows to memory with the same writer as sExport() */
+static QString exportToString(const XTreeWidget *tree, XTreeWidgetExporter::Format format)
 {
-  QString line;
-  QString opText;
-  int     counter;
-
-  QTreeWidgetItem *header = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-      line = line + header->text(counter).replace("\r\n"," ") + "\t";
-  }
-  opText = line + "\r\n";
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  XTreeWidgetExporter exporter(tree);
+  exporter.write(&buffer, format);
+  return QString::fromUtf8(buffer.data());
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    QModelIndex idx = indexFromItem(item);
-    while (idx.isValid())
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-            line = line + item->text(counter) + "\t";
-        }
-      }
-      opText = opText + line + "\r\n";
-      idx    = indexBelow(idx);
-    }
-  }
-  return opText;
+QString XTreeWidget::toTxt() const
+{
+  return exportToString(this, XTreeWidgetExporter::Text);
 }
 
 QString XTreeWidget::toCsv() const
 {
-  QString line;
-  QString opText;
-  int     counter;
-  int     colcount         = 0;
-
-  QTreeWidgetItem *header  = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      if (colcount)
-        line = line + ",";
-      line = line + header->text(counter).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
-      colcount++;
-    }
-  }
-  opText = line + "\r\n";
-
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    QModelIndex idx = indexFromItem(item);
-    while (idx.isValid())
-    {
-      colcount = 0;
-      item     = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            if (colcount)
-              line = line + ",";
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            line = line + item->text(counter).replace("\"","\"\"");
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            colcount++;
-          }
-        }
-      }
-      opText = opText + line + "\r\n";
-      idx    = indexBelow(idx);
-    }
-  }
-  return opText;
+  return exportToString(this, XTreeWidgetExporter::Csv);
 }
 
 QString XTreeWidget::toVcf() const
@@ -2477,87 +3805,7 @@ QString XTreeWidget::toVcf() const
 
 QString XTreeWidget::toHtml() const
 {
-  QTextDocument     *doc     = new QTextDocument();
-  QTextCursor       *cursor  = new QTextCursor(doc);
-  QTextTableFormat  tableFormat;
-  QTextTableCell    cell;
-  QTextCharFormat   format;
-  QString font;
-  int     colcnt = 0;
-  int     rowcnt = 0;
-
-  tableFormat.setHeaderRowCount(1);
-
-  QTreeWidgetItem *header = headerItem();
-  for (int i = 0; i < header->columnCount(); i++)
-    if (!QTreeWidget::isColumnHidden(i))
-      colcnt++;
-
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    QModelIndex idx = indexFromItem(item);
-    while (idx.isValid())
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-        rowcnt++;
-      idx = indexBelow(idx);
-    }
-  }
-
-  cursor->insertTable(rowcnt + 1, colcnt, tableFormat);
-
-  for (int counter = 0; counter < header->columnCount(); counter++)
-  {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      cell   = cursor->currentTable()->cellAt(cursor->position());
-      format = cell.format();
-      format.setBackground(Qt::lightGray);
-      cell.setFormat(format);
-      cursor->insertText(header->text(counter));
-      cursor->movePosition(QTextCursor::NextCell);
-    }
-  }
-
-  item = topLevelItem(0);
-  if (item)
-  {
-    QModelIndex idx = indexFromItem(item);
-    while (idx.isValid())
-    {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        for (int counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            cell   = cursor->currentTable()->cellAt(cursor->position());
-            format = cell.format();
-            if (item->data(counter, Qt::BackgroundRole).isValid())
-              format.setBackground(item->data(counter, Qt::BackgroundRole).value<QColor>());
-            if (item->data(counter, Qt::ForegroundRole).isValid())
-              format.setForeground(item->data(counter, Qt::ForegroundRole).value<QColor>());
-
-            if (item->data(counter,Qt::FontRole).isValid())
-            {
-              font = item->data(counter,Qt::FontRole).toString();
-              if (!font.isEmpty())
-                format.setFont(QFont(font));
-            }
-
-            cell.setFormat(format);
-            cursor->insertText(item->text(counter));
-            cursor->movePosition(QTextCursor::NextCell);
-          }
-        }
-      }
-      idx = indexBelow(idx);
-    }
-  }
-  return doc->toHtml();
+  return exportToString(this, XTreeWidgetExporter::Html);
 }
 
 QList<XTreeWidgetItem *> XTreeWidget::selectedItems() const
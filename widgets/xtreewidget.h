@@ -11,6 +11,13 @@
 #ifndef __XTREEWIDGET_H__
 #define __XTREEWIDGET_H__
 
+#include <QBitArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSqlRecord>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
 #include <QVariant>
@@ -62,11 +69,70 @@ class XTreeWidgetProgress;
 void  setupXTreeWidgetItem(QScriptEngine *engine);
 void  setupXTreeWidget(QScriptEngine *engine);
 
+/* XTreeWidgetColumnStore holds the cell data for the rows of one populate()
+   call in column-major, typed arrays instead of in per-cell QVariant
+   vectors inside each QTreeWidgetItem. Display strings are formatted
+   lazily when the view asks for them. XTreeWidgetItem::data() falls back
+   to the store for anything that wasn't set explicitly on the item.
+*/
+class XTUPLEWIDGETS_EXPORT XTreeWidgetColumnStore
+{
+  public:
+    enum StoreRole {
+      DisplayValueRole = (Qt::UserRole + 100), // value of qtdisplayrole
+      NullTextRole,                            // value of xtnullrole
+      NumericRoleRole                          // value of xtnumericrole
+    };
+
+    XTreeWidgetColumnStore(int columns);
+
+    int      appendRow();
+    int      columnCount() const { return _columns.size(); }
+    int      rowCount()    const { return _rows; }
+
+    void     setColumnAlignment(int col, const QVariant &alignment);
+    void     setColumnFormat(int col, int scale, bool numeric, bool showScale);
+    void     setRaw(int row, int col, const QVariant &value);
+    void     setRole(int row, int col, int role, const QVariant &value);
+
+    QVariant raw(int row, int col) const;
+    QVariant value(int row, int col, int role) const;
+
+  private:
+    enum ColumnType { Unknown, Bool, Int, LongLong, Double,
+                      Date, DateTime, String, Generic };
+
+    struct Column {
+      Column() : type(Unknown), nullType(QVariant::Invalid), scale(0),
+                 numeric(false), showScale(false) {}
+      ColumnType                      type;
+      QVariant::Type                  nullType;
+      QVector<double>                 numbers;
+      QVector<qlonglong>              integers;
+      QVector<QDateTime>              datetimes;
+      QVector<QString>                strings;
+      QVector<QVariant>               variants;
+      QBitArray                       nulls;
+      QHash<int, QVector<QVariant> >  roles;
+      QVariant                        alignment;
+      int                             scale;
+      bool                            numeric;
+      bool                            showScale;
+    };
+
+    void     makeGeneric(int col);
+    QVariant display(int row, int col) const;
+
+    QVector<Column> _columns;
+    int             _rows;
+};
+
 class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetItem
 {
   Q_OBJECT
 
   friend class XTreeWidget;
+  friend class XTreeWidgetTotals;
 
   public:
     XTreeWidgetItem(XTreeWidgetItem *, int, QVariant = QVariant(),
@@ -126,10 +192,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
 
     Q_INVOKABLE inline int              id() const        { return _id;    }
     Q_INVOKABLE inline int              altId() const     { return _altId; }
-    Q_INVOKABLE inline void             setId(int pId)    { _id = pId;     }
+    Q_INVOKABLE void                    setId(int pId);
     Q_INVOKABLE inline void             setAltId(int pId) { _altId = pId;  }
 
-    Q_INVOKABLE inline QVariant         data(int colidx,    int role) const { return QTreeWidgetItem::data(colidx, role); }
+    Q_INVOKABLE virtual QVariant        data(int colidx,    int role) const;
     Q_INVOKABLE inline void             setData(int colidx, int role, const QVariant &val) { QTreeWidgetItem::setData(colidx, role, val); }
     Q_INVOKABLE virtual QVariant        rawValue(const QString colname);
     Q_INVOKABLE virtual int             id(const QString);
@@ -155,23 +221,32 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
 
     int _id;
     int _altId;
+    QSharedPointer<XTreeWidgetColumnStore> _store;
+    int _storeRow;
 };
 
 Q_DECLARE_METATYPE(XTreeWidgetItem *)
 // Q_DECLARE_METATYPE(XTreeWidgetItem)
 
 class XTreeWidgetPopulateParams;
+class XTreeWidgetPopulatePlan;
+class XTreeWidgetRecordStream;
+class XTreeWidgetTotals;
 
 class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
 {
+  friend class XTreeWidgetExporter;
+  friend class XTreeWidgetItem;
+
   Q_OBJECT Q_PROPERTY(QString dragString READ dragString WRITE setDragString)
   Q_PROPERTY( QString altDragString READ altDragString WRITE setAltDragString)
   Q_PROPERTY( bool populateLinear READ populateLinear WRITE setPopulateLinear)
+  Q_PROPERTY( bool columnStore    READ columnStore    WRITE setColumnStore)
 
   Q_ENUMS(PopulateStyle)
 
   public :
-    enum PopulateStyle { Replace, Append };
+    enum PopulateStyle { Replace, Append, Merge };
     XTreeWidget(QWidget *);
     ~XTreeWidget();
 
@@ -179,6 +254,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE void  populate(XSqlQuery, int, bool = FALSE, PopulateStyle = Replace);
     void    populate(const QString&, bool = FALSE);
     void    populate(const QString&, int, bool = FALSE);
+    Q_INVOKABLE void  beginPopulate(int, bool = FALSE, PopulateStyle = Replace);
 
     QString dragString() const;
     void    setDragString(QString);
@@ -186,6 +262,8 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void    setAltDragString(QString);
     bool    populateLinear();
     void    setPopulateLinear(bool alwaysLinear = true);
+    bool    columnStore() const;
+    void    setColumnStore(bool useColumnStore = true);
 
     Q_INVOKABLE int   altId() const;
     Q_INVOKABLE int   id()    const;
@@ -204,6 +282,9 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid);
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid);
 
+    Q_INVOKABLE double      total(int column, int totalSet = 0) const;
+    Q_INVOKABLE QVariantMap totals(int column) const;
+
     Q_INVOKABLE QString toTxt() const;
     Q_INVOKABLE QString toCsv() const;
     Q_INVOKABLE QString toVcf() const;
@@ -262,6 +343,10 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sCopyRowToClipboard();
     void  sCopyCellToClipboard();
     void  sSearch(const QString&);
+    void  populateRecords(const QList<QSqlRecord> &);
+    void  populatePaused();
+    void  setPopulateTotals(const QVariantMap &);
+    void  endPopulate();
 
   signals:
     void  valid(bool);
@@ -282,6 +367,9 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  populateMenu(QMenu *, XTreeWidgetItem *, int);
     void  resorted();
     void  populated();
+    void  populateCancelled();
+    void  moreRowsWanted();
+    void  allRowsWanted();
 
   protected slots:
     void  sHeaderClicked(int);
@@ -328,17 +416,55 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     QTimer        _workingTimer;
     bool          _alwaysLinear;
     bool          _linear;
+    bool          _useColumnStore;
+    QSharedPointer<XTreeWidgetColumnStore> _store;
 
     QVector<int>    *_colIdx;
     QVector<int *>  *_colRole;
     int              _fieldCount;
+    XTreeWidgetPopulatePlan *_plan;
     XTreeWidgetItem *_last;
     int              _rowRole[ROWROLE_COUNT];
     void             cleanupAfterPopulate();
+    void             addPopulatedItems(const QList<XTreeWidgetItem *> &, PopulateStyle);
+    void             mergePopulatedItems();
+    void             updateTotals(const QModelIndex &, const QModelIndex &);
+    bool             sameRow(const QTreeWidgetItem *, const QTreeWidgetItem *) const;
+    QList<XTreeWidgetItem *> _mergeItems;
+    void             setCellData(int col, int role, const QVariant &value);
+    bool             rowsPending() const;
+    bool             fetchAllRows();
+    void             takeTotalRows();
+    bool             _moreRowsRequested;
+    QVariantMap      _populateTotals;
+    XTreeWidgetTotals *_totals;
+    bool             _keepTotals;
+
+    void             updateIdIndex();
+    void             indexItem(QTreeWidgetItem *);
+    void             unindexItem(QTreeWidgetItem *);
+    enum IndexScope { AllItems, ShownSubtrees, ShownRows };
+    XTreeWidgetItem *indexedItem(int pId, IndexScope pScope,
+                                 bool pUseAltId = false, int pAltId = -1,
+                                 const QTreeWidgetItem *pAncestor = 0);
+    QString          searchText(QTreeWidgetItem *);
+    bool                                 _idIndexValid;
+    QMultiHash<int, QTreeWidgetItem *>   _idIndex;     // id -> items
+    QHash<QTreeWidgetItem *, int>        _indexedIds;  // item -> id it's indexed by
+    QSet<QTreeWidgetItem *>              _unindexed;   // inserted since the last lookup
+    QHash<QTreeWidgetItem *, QString>    _searchText;  // case-folded visible columns
+    QList<int>                           _searchColumns;
+    QString                              _lastSearch;
+    int                                  _lastSearchRow;
     XTreeWidgetProgress *_progress;
-    QList<QMap<int, double> *> *_subtotals;
 
   private slots:
+    void  sPopulateCancelled();
+    void  sScrolled(int);
+    void  sRowsInserted(const QModelIndex &, int, int);
+    void  sRowsAboutToBeRemoved(const QModelIndex &, int, int);
+    void  sDataChanged(const QModelIndex &, const QModelIndex &);
+    void  sInvalidateIndex();
     void  sSelectionChanged();
     void  sItemSelected();
     void  sItemSelected(QTreeWidgetItem *, int);
@@ -354,10 +480,26 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  popupMenuActionTriggered(QAction *);
 };
 
+/* rows handed to the tree by populateRecords() between beginPopulate()
+   and endPopulate(), usually from a query running on another thread
+*/
+class XTreeWidgetRecordStream
+{
+  public:
+    XTreeWidgetRecordStream() : _base(0), _pos(-1), _finished(false) {}
+
+    QList<QSqlRecord> _records; // rows populateWorker() hasn't used yet
+    QSqlRecord        _first;   // the first row, for the field names
+    int               _base;    // the row number of _records.first()
+    int               _pos;
+    bool              _finished;
+};
+
 class XTreeWidgetPopulateParams
 {
   public:
     XSqlQuery _workingQuery;
+    QSharedPointer<XTreeWidgetRecordStream> _workingStream;
     int       _workingIndex;
     bool      _workingUseAlt;
     XTreeWidget::PopulateStyle _workingPopstyle;
@@ -0,0 +1,252 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetexport.h"
+
+#include <QColor>
+#include <QFont>
+#include <QIODevice>
+#include <QStringList>
+#include <QTextDocument>
+#include <QTextDocumentWriter>
+#include <QTextStream>
+
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+#define HEADERCOLOR "#c0c0c0"
+
+/* background, foreground, font family, bold, italic and strike-out of a
+   cell, or an empty list if the cell has none of them
+*/
+static QStringList cellProperties(const QTreeWidgetItem *item, int col)
+{
+  QStringList props;
+  for (int i = 0; i < 6; i++)
+    props << QString();
+
+  QVariant value = item->data(col, Qt::BackgroundRole);
+  if (value.isValid() && value.value<QColor>().isValid())
+    props[0] = value.value<QColor>().name();
+
+  value = item->data(col, Qt::ForegroundRole);
+  if (value.isValid() && value.value<QColor>().isValid())
+    props[1] = value.value<QColor>().name();
+
+  value = item->data(col, Qt::FontRole);
+  if (value.isValid())
+  {
+    QFont font;
+    if (value.type() == QVariant::Font)
+      font = value.value<QFont>();
+    else if (! font.fromString(value.toString()))
+      font.setFamily(value.toString());
+
+    props[2] = font.family();
+    props[3] = font.bold()      ? "b" : "";
+    props[4] = font.italic()    ? "i" : "";
+    props[5] = font.strikeOut() ? "s" : "";
+  }
+
+  if (props.join("").isEmpty())
+    props.clear();
+  return props;
+}
+
+static QString htmlStyle(const QTreeWidgetItem *item, int col)
+{
+  QStringList style;
+  QStringList props = cellProperties(item, col);
+  if (! props.isEmpty())
+  {
+    if (! props.at(0).isEmpty())
+      style << "background-color:" + props.at(0);
+    if (! props.at(1).isEmpty())
+      style << "color:" + props.at(1);
+    if (! props.at(2).isEmpty())
+      style << "font-family:'" + props.at(2) + "'";
+    if (! props.at(3).isEmpty())
+      style << "font-weight:bold";
+    if (! props.at(4).isEmpty())
+      style << "font-style:italic";
+    if (! props.at(5).isEmpty())
+      style << "text-decoration:line-through";
+  }
+  if (item->data(col, Qt::TextAlignmentRole).toInt() & Qt::AlignRight)
+    style << "text-align:right";
+
+  return style.join(";");
+}
+
+XTreeWidgetExporter::XTreeWidgetExporter(const XTreeWidget *tree)
+  : _tree(tree),
+    _includeHeader(true),
+    _useItems(false),
+    _itemPos(0)
+{
+}
+
+/*!
+  Write the column headings before the rows. This is on by default.
+*/
+void XTreeWidgetExporter::setIncludeHeader(bool include)
+{
+  _includeHeader = include;
+}
+
+/*!
+  Write only \a items instead of every visible row of the tree.
+*/
+void XTreeWidgetExporter::setItems(const QList<QTreeWidgetItem *> &items)
+{
+  _items    = items;
+  _useItems = true;
+}
+
+QString XTreeWidgetExporter::errorString() const
+{
+  return _error;
+}
+
+/*!
+  Write the rows to \a device, which must already be open for writing.
+  Text, CSV and HTML are written as UTF-8.
+  Returns false and sets errorString() if writing failed.
+*/
+bool XTreeWidgetExporter::write(QIODevice *device, Format format)
+{
+  _error.clear();
+  _columns.clear();
+
+  QTreeWidgetItem *header = _tree->headerItem();
+  for (int col = 0; col < header->columnCount(); col++)
+    if (! _tree->isColumnHidden(col))
+      _columns.append(col);
+
+  if (format == Odt)
+  {
+    /* QTextDocumentWriter builds the ODF package, so lay the rows out as
+       HTML in memory and let it convert them like it always has
+     */
+    QString html;
+    {
+      QTextStream out(&html);
+      writeText(out, Html);
+    }
+    QTextDocument doc;
+    doc.setHtml(html);
+    QTextDocumentWriter writer(device, "odf");
+    if (! writer.write(&doc))
+      _error = device->errorString();
+  }
+  else
+  {
+    QTextStream out(device);
+    out.setCodec("UTF-8");
+    writeText(out, format);
+    out.flush();
+    if (out.status() != QTextStream::Ok)
+      _error = device->errorString();
+  }
+
+  if (DEBUG)
+    qDebug("XTreeWidgetExporter::write() wrote %d columns, error: %s",
+           _columns.size(), qPrintable(_error));
+  return _error.isEmpty();
+}
+
+/* walk the rows in display order. the tree is walked by model index
+   because looking up each item's index from the item is slow.
+*/
+QTreeWidgetItem *XTreeWidgetExporter::firstRow()
+{
+  if (_useItems)
+  {
+    _itemPos = 0;
+    return _items.isEmpty() ? 0 : _items.first();
+  }
+
+  QTreeWidgetItem *item = _tree->topLevelItem(0);
+  _rowIndex = item ? _tree->indexFromItem(item) : QModelIndex();
+  return item;
+}
+
+QTreeWidgetItem *XTreeWidgetExporter::nextRow()
+{
+  if (_useItems)
+  {
+    _itemPos++;
+    return _itemPos < _items.size() ? _items.at(_itemPos) : 0;
+  }
+
+  _rowIndex = _tree->indexBelow(_rowIndex);
+  return _rowIndex.isValid() ? _tree->itemFromIndex(_rowIndex) : 0;
+}
+
+void XTreeWidgetExporter::writeText(QTextStream &out, Format format)
+{
+  QTreeWidgetItem *header = _tree->headerItem();
+
+  if (format == Html)
+    out << "<html>\n<head><meta http-equiv=\"Content-Type\" "
+           "content=\"text/html; charset=utf-8\"/></head>\n<body>\n"
+           "<table border=\"1\" cellspacing=\"0\" cellpadding=\"2\">\n";
+
+  if (_includeHeader)
+  {
+    if (format == Html)
+      out << "<tr>";
+    for (int i = 0; i < _columns.size(); i++)
+    {
+      QString text = header->text(_columns.at(i));
+      if (format == Text)
+        out << text.replace("\r\n", " ") << "\t";
+      else if (format == Csv)
+        out << (i ? "," : "")
+            << text.replace("\"", "\"\"").replace("\r\n", " ").replace("\n", " ");
+      else
+        out << "<th style=\"background-color:" HEADERCOLOR "\">"
+            << Qt::escape(text) << "</th>";
+    }
+    out << (format == Html ? "</tr>\n" : "\r\n");
+  }
+
+  for (QTreeWidgetItem *item = firstRow(); item; item = nextRow())
+  {
+    if (format == Html)
+      out << "<tr>";
+    for (int i = 0; i < _columns.size(); i++)
+    {
+      int col = _columns.at(i);
+      if (format == Text)
+        out << item->text(col) << "\t";
+      else if (format == Csv)
+      {
+        bool quote = (item->data(col, Qt::DisplayRole).type() == QVariant::String);
+        out << (i ? "," : "") << (quote ? "\"" : "")
+            << item->text(col).replace("\"", "\"\"") << (quote ? "\"" : "");
+      }
+      else
+      {
+        QString style = htmlStyle(item, col);
+        if (style.isEmpty())
+          out << "<td>";
+        else
+          out << "<td style=\"" << style << "\">";
+        out << Qt::escape(item->text(col)) << "</td>";
+      }
+    }
+    out << (format == Html ? "</tr>\n" : "\r\n");
+  }
+
+  if (format == Html)
+    out << "</table>\n</body>\n</html>\n";
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2014 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETEXPORT_H
+#define XTREEWIDGETEXPORT_H
+
+#include <QList>
+#include <QModelIndex>
+#include <QString>
+
+class QIODevice;
+class QTextStream;
+class QTreeWidgetItem;
+class XTreeWidget;
+
+/* XTreeWidgetExporter writes the visible rows and columns of an
+   XTreeWidget to a QIODevice. Text, CSV and HTML are written in one pass,
+   formatting each row as it goes, so sExport() streams them straight to
+   the file. An ODF text document is built as a QTextDocument and written
+   by QTextDocumentWriter. toTxt(), toCsv() and toHtml() use the same
+   writer but still build the whole document in memory, since they return
+   it as a QString. It also backs XTreeWidget's clipboard actions.
+*/
+class XTreeWidgetExporter
+{
+  public:
+    enum Format { Text, Csv, Html, Odt };
+
+    XTreeWidgetExporter(const XTreeWidget *tree);
+
+    void    setIncludeHeader(bool include);
+    void    setItems(const QList<QTreeWidgetItem *> &items);
+
+    bool    write(QIODevice *device, Format format);
+    QString errorString() const;
+
+  private:
+    QTreeWidgetItem *firstRow();
+    QTreeWidgetItem *nextRow();
+
+    void    writeText(QTextStream &out, Format format);
+
+    const XTreeWidget       *_tree;
+    bool                     _includeHeader;
+    bool                     _useItems;
+    QList<QTreeWidgetItem *> _items;
+    int                      _itemPos;
+    QModelIndex              _rowIndex;
+    QList<int>               _columns;
+    QString                  _error;
+};
+
+#endif